@@ -0,0 +1,135 @@
+#include "AllocationTracker.h"
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+AllocationTracker::Counters AllocationTracker::counters;
+uint32_t AllocationTracker::eventsChecked = 0;
+uint32_t AllocationTracker::eventsAllocated = 0;
+uint32_t AllocationTracker::lastEventAllocations = 0;
+size_t AllocationTracker::lastEventBytes = 0;
+
+#if defined(ARDUINO)
+
+// Heap region bounds from the Teensy 4 linker script and sbrk
+extern "C" unsigned long _heap_start;
+extern "C" unsigned long _heap_end;
+extern "C" char *__brkval;
+
+AllocationTracker::HeapStats AllocationTracker::Heap()
+{
+    HeapStats stats;
+    struct mallinfo info = mallinfo();
+    stats.arenaBytes = info.arena;
+    stats.usedBytes = info.uordblks;
+    // newlib counts the top chunk (keepcost) as free too; it is contiguous with the untouched rest of the region
+    stats.holeBytes = info.fordblks - info.keepcost;
+    stats.topFreeBytes = info.keepcost + ((char *)&_heap_end - __brkval);
+    size_t freeBytes = stats.holeBytes + stats.topFreeBytes;
+    stats.fragmentationPercent = freeBytes > 0 ? stats.holeBytes * 100 / freeBytes : 0;
+    return stats;
+}
+
+// Linked with -Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc: every call of e.g. malloc ends up in
+// __wrap_malloc, and __real_malloc is newlib's implementation.
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void __real_free(void *ptr);
+    void *__real_realloc(void *ptr, size_t size);
+    void *__real_calloc(size_t count, size_t size);
+
+    void *__wrap_malloc(size_t size)
+    {
+        void *ptr = __real_malloc(size);
+        if (ptr)
+            AllocationTracker::RecordAllocation(malloc_usable_size(ptr));
+        else
+            AllocationTracker::RecordFailedAllocation();
+        return ptr;
+    }
+
+    void __wrap_free(void *ptr)
+    {
+        if (ptr)
+            AllocationTracker::RecordFree(malloc_usable_size(ptr));
+        __real_free(ptr);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+        void *newPtr = __real_realloc(ptr, size);
+        if (!newPtr && size > 0)
+        {
+            AllocationTracker::RecordFailedAllocation();
+            return newPtr;
+        }
+        if (ptr)
+            AllocationTracker::RecordFree(oldSize);
+        if (newPtr)
+            AllocationTracker::RecordAllocation(malloc_usable_size(newPtr));
+        return newPtr;
+    }
+
+    void *__wrap_calloc(size_t count, size_t size)
+    {
+        void *ptr = __real_calloc(count, size);
+        if (ptr)
+            AllocationTracker::RecordAllocation(malloc_usable_size(ptr));
+        else
+            AllocationTracker::RecordFailedAllocation();
+        return ptr;
+    }
+}
+
+#else
+
+AllocationTracker::HeapStats AllocationTracker::Heap()
+{
+    HeapStats stats;
+    stats.usedBytes = counters.currentBytes;
+    return stats;
+}
+
+// The host C library cannot be wrapped at link time, so only C++ allocations are counted
+void *operator new(size_t size)
+{
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+    {
+        AllocationTracker::RecordFailedAllocation();
+        throw std::bad_alloc();
+    }
+    AllocationTracker::RecordAllocation(malloc_usable_size(ptr));
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr)
+        AllocationTracker::RecordFree(malloc_usable_size(ptr));
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counts heap allocations of the whole firmware.
+ *
+ * On the Teensy the malloc family is wrapped at link time (-Wl,--wrap=malloc, see platformio.ini), which also covers
+ * operator new, Arduino Strings and the standard containers. Host builds replace the global operator new/delete.
+ * Counting is a few increments per allocation, so it is always on.
+ *
+ * MIDI events must not allocate between entering the event handler and committing the frame. \ref EventScope checks
+ * that for each event; builds with PIANO_LED_ALLOCATION_CHECK report every event that allocated as a failure.
+ */
+class AllocationTracker
+{
+public:
+    struct Counters
+    {
+        uint32_t allocations = 0;
+        uint32_t frees = 0;
+        uint32_t failedAllocations = 0;
+        size_t allocatedBytes = 0; // total, including freed memory
+        size_t currentBytes = 0;
+        size_t peakBytes = 0;
+    };
+
+    /**
+     * Heap layout as seen by the allocator. Only filled on the Teensy; host builds report the counters only.
+     */
+    struct HeapStats
+    {
+        size_t arenaBytes = 0;   // memory the allocator took from the heap region so far
+        size_t usedBytes = 0;    // allocated blocks, including allocator overhead
+        size_t holeBytes = 0;    // free blocks inside the arena, between allocated blocks
+        size_t topFreeBytes = 0; // contiguous free memory at the end of the heap region
+        uint8_t fragmentationPercent = 0; // share of the free memory that is stuck in holes
+    };
+
+    /**
+     * Counts the allocations made while it exists.
+     */
+    class Scope
+    {
+    public:
+        Scope() : startAllocations(counters.allocations), startBytes(counters.allocatedBytes) {}
+
+        uint32_t Allocations() const { return counters.allocations - startAllocations; }
+        size_t Bytes() const { return counters.allocatedBytes - startBytes; }
+
+    private:
+        uint32_t startAllocations;
+        size_t startBytes;
+    };
+
+    /**
+     * Wraps the handling of one MIDI event. If the event allocated, it is recorded as a violation of the
+     * zero-allocation guarantee.
+     */
+    class EventScope
+    {
+    public:
+        ~EventScope() { EndEvent(scope); }
+
+    private:
+        Scope scope;
+    };
+
+    static const Counters &Totals() { return counters; }
+    static HeapStats Heap();
+
+    static uint32_t EventsChecked() { return eventsChecked; }
+    static uint32_t EventsAllocated() { return eventsAllocated; }
+
+    /**
+     * Allocations and bytes of the last event that allocated.
+     */
+    static uint32_t LastEventAllocations() { return lastEventAllocations; }
+    static size_t LastEventBytes() { return lastEventBytes; }
+
+    // Called by the allocation hooks
+    static void RecordAllocation(size_t usableBytes)
+    {
+        ++counters.allocations;
+        counters.allocatedBytes += usableBytes;
+        counters.currentBytes += usableBytes;
+        if (counters.currentBytes > counters.peakBytes)
+            counters.peakBytes = counters.currentBytes;
+    }
+    static void RecordFree(size_t usableBytes)
+    {
+        ++counters.frees;
+        counters.currentBytes -= usableBytes;
+    }
+    static void RecordFailedAllocation() { ++counters.failedAllocations; }
+
+private:
+    static Counters counters;
+    static uint32_t eventsChecked;
+    static uint32_t eventsAllocated;
+    static uint32_t lastEventAllocations;
+    static size_t lastEventBytes;
+
+    static void EndEvent(const Scope &scope)
+    {
+        ++eventsChecked;
+        if (scope.Allocations() != 0)
+        {
+            ++eventsAllocated;
+            lastEventAllocations = scope.Allocations();
+            lastEventBytes = scope.Bytes();
+        }
+    }
+};
+
+#endif // ALLOCATION_TRACKER_H
@@ -0,0 +1,139 @@
+#include "ColorCorrection.h"
+#include <cstring>
+
+namespace
+{
+    // constexpr replacements for std::log/std::exp/std::pow, which are not usable in constant expressions.
+    // Only ever evaluated by the compiler.
+
+    constexpr double Ln(double x)
+    {
+        // x = m * 2^e with m in [0.5, 1), then ln(m) = 2 * atanh((m - 1) / (m + 1))
+        int e = 0;
+        while (x >= 1.0)
+        {
+            x /= 2;
+            ++e;
+        }
+        while (x < 0.5)
+        {
+            x *= 2;
+            --e;
+        }
+        double z = (x - 1) / (x + 1);
+        double z2 = z * z;
+        double term = z;
+        double sum = 0;
+        for (int k = 1; k < 60; k += 2)
+        {
+            sum += term / k;
+            term *= z2;
+        }
+        return 2 * sum + e * 0.69314718055994530942;
+    }
+
+    constexpr double Exp(double y)
+    {
+        // exp(y) = exp(y / 2^n)^(2^n), with |y / 2^n| small enough for a short Taylor series
+        int n = 0;
+        while (y > 0.5 || y < -0.5)
+        {
+            y /= 2;
+            ++n;
+        }
+        double sum = 1;
+        double term = 1;
+        for (int k = 1; k < 20; ++k)
+        {
+            term *= y / k;
+            sum += term;
+        }
+        while (n-- > 0)
+        {
+            sum *= sum;
+        }
+        return sum;
+    }
+
+    constexpr double Pow(double base, double exponent)
+    {
+        return base <= 0 ? 0 : Exp(exponent * Ln(base));
+    }
+
+    constexpr ColorCorrection::ChannelTable BuildChannel(double gamma, int whiteBalance)
+    {
+        ColorCorrection::ChannelTable table{};
+        for (int i = 0; i < 256; ++i)
+        {
+            double level = Pow(i / 255.0, gamma) * whiteBalance; // 0..255
+            table[i] = static_cast<uint16_t>(level * 256 + 0.5);
+        }
+        return table;
+    }
+
+    constexpr ColorCorrection::Tables BuildTables(double gamma, int r, int g, int b)
+    {
+        return {{BuildChannel(gamma, r), BuildChannel(gamma, g), BuildChannel(gamma, b)}};
+    }
+
+    // White balance values are FastLED's typical color corrections (TypicalLEDStrip / TypicalPixelString)
+    constexpr ColorCorrection::Tables identityTables = BuildTables(1.0, 255, 255, 255);
+    constexpr ColorCorrection::Tables ledStripTables = BuildTables(2.8, 255, 176, 240);
+    constexpr ColorCorrection::Tables pixelStringTables = BuildTables(2.5, 255, 224, 140);
+
+    static_assert(identityTables.channel[0][200] == 200 * 256, "identity table must not change a channel");
+    static_assert(ledStripTables.channel[0][255] == 255 * 256, "full red must stay full red");
+    static_assert(ledStripTables.channel[1][128] < 128 * 256, "gamma must darken mid levels");
+}
+
+const ColorCorrection::Tables &ColorCorrection::ForLedType(PianoLedStrip::LedType ledType)
+{
+    switch (ledType)
+    {
+    case PianoLedStrip::LedType::WS2811:
+        return pixelStringTables;
+    case PianoLedStrip::LedType::WS2812B:
+    case PianoLedStrip::LedType::SK6812:
+    case PianoLedStrip::LedType::APA102:
+    case PianoLedStrip::LedType::SK9822:
+    default:
+        return ledStripTables;
+    }
+}
+
+const ColorCorrection::Tables &ColorCorrection::Identity()
+{
+    return identityTables;
+}
+
+void ColorCorrection::Apply(const Tables &tables, const uint8_t *in, uint8_t *out, size_t pixelCount, bool dither, uint8_t ditherPhase)
+{
+    if (&tables == &identityTables)
+    {
+        memcpy(out, in, pixelCount * 3);
+        return;
+    }
+
+    if (!dither)
+    {
+        for (size_t i = 0; i < pixelCount * 3; i += 3)
+        {
+            out[i + 0] = (tables.channel[0][in[i + 0]] + 128) >> 8;
+            out[i + 1] = (tables.channel[1][in[i + 1]] + 128) >> 8;
+            out[i + 2] = (tables.channel[2][in[i + 2]] + 128) >> 8;
+        }
+        return;
+    }
+
+    // Temporal dithering: the fraction decides in how many frames out of 256 a channel is rounded up.
+    // Offsetting the threshold per pixel keeps neighbouring LEDs from flickering in sync.
+    for (size_t i = 0, pixel = 0; i < pixelCount * 3; i += 3, ++pixel)
+    {
+        uint8_t threshold = ditherPhase + pixel * 97;
+        for (int c = 0; c < 3; ++c)
+        {
+            uint32_t level = tables.channel[c][in[i + c]] + threshold;
+            out[i + c] = level > 0xFFFF ? 255 : level >> 8;
+        }
+    }
+}
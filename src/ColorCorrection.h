@@ -0,0 +1,49 @@
+#ifndef COLOR_CORRECTION_H
+#define COLOR_CORRECTION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "PianoLedStrip.h"
+
+/**
+ * Gamma and white balance correction for the final output pass.
+ *
+ * The tables are generated at compile time (see ColorCorrection.cpp), so correcting a channel at runtime is a single
+ * table lookup without any floating point math. Entries are 8.8 fixed point: the high byte is the output level and
+ * the low byte the fraction that temporal dithering distributes over consecutive frames.
+ */
+class ColorCorrection
+{
+public:
+    using ChannelTable = std::array<uint16_t, 256>;
+
+    struct Tables
+    {
+        ChannelTable channel[3]; // r, g, b
+    };
+
+    /**
+     * Size of all built-in tables. They are constant data, which the Teensy 4 keeps in DTCM.
+     */
+    static constexpr size_t tableBytes = 3 * sizeof(Tables);
+
+    /**
+     * Gamma and white balance tables typical for \p ledType.
+     */
+    static const Tables &ForLedType(PianoLedStrip::LedType ledType);
+
+    /**
+     * Tables that leave every channel unchanged.
+     */
+    static const Tables &Identity();
+
+    /**
+     * Corrects \p pixelCount RGB pixels from \p in to \p out.
+     * @param dither Round the fractional part up or down depending on \p ditherPhase instead of to the nearest level.
+     * @param ditherPhase Changes every frame, so that over 256 frames every level averages out to its exact value.
+     */
+    static void Apply(const Tables &tables, const uint8_t *in, uint8_t *out, size_t pixelCount, bool dither, uint8_t ditherPhase);
+};
+
+#endif // COLOR_CORRECTION_H
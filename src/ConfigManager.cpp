@@ -1,14 +1,21 @@
 #include <Arduino.h>
 #include "ConfigManager.h"
 #include "PianoLedConfig.h"
+#include "VelocityCalibration.h"
+#include "MidiSources.h"
+#include "MemoryMap.h"
+#include "EventTrace.h"
+#include "LoopMonitor.h"
 #include <vector>
 #include <string>
+#include <algorithm>
 
 ConfigManager::ConfigManager()
-    : onConfigChanged(nullptr)
+    : onConfigChanged(nullptr), onRemoteCommand(nullptr)
 {
 }
 
+// Only touched by the UART interrupt and the config parser, so they can live in the slower OCRAM
 DMAMEM uint8_t rxBuf[4096];
 DMAMEM uint8_t txBuf[4096];
 
@@ -17,6 +24,8 @@ void ConfigManager::begin()
     Serial1.begin(115200);
     Serial1.addMemoryForRead(rxBuf, sizeof(rxBuf));  // enlarge RX ring buffer
     Serial1.addMemoryForWrite(txBuf, sizeof(txBuf)); // enlarge TX ring buffer
+    MemoryMap::Record("remote MCU UART RX", rxBuf, sizeof(rxBuf), sizeof(rxBuf));
+    MemoryMap::Record("remote MCU UART TX", txBuf, sizeof(txBuf), sizeof(txBuf));
     beginFS();
 
     Serial.println("Loading config from file...");
@@ -58,6 +67,7 @@ void ConfigManager::ReadRemoteMCU()
 {
     if (Serial1.available())
     {
+        EventTrace::Scope trace(EventTrace::Id::UartParse, Serial1.available());
         String cmd = Serial1.readStringUntil('\n');
         Serial.println("Received command: " + cmd);
         cmd.trim();
@@ -73,12 +83,24 @@ void ConfigManager::ReadRemoteMCU()
             PianoLedConfig newConfig;
             parseConfigFromStream(Serial1, newConfig);
             Serial.println("Config change received from remote MCU.");
-            saveConfigToFile("/config.txt", newConfig);
-            if (onConfigChanged)
-            {
-                onConfigChanged(newConfig, false);
-            }
+            // the velocity curve is learned on this device; keep it unless the change explicitly sets one
+            if (newConfig.velocityCurve.empty())
+                newConfig.velocityCurve = PianoLedConfig::globalConfig.velocityCurve;
+            applyConfig(newConfig);
         }
+        else if (onRemoteCommand)
+        {
+            onRemoteCommand(cmd, Serial1);
+        }
+    }
+}
+
+void ConfigManager::applyConfig(const PianoLedConfig &config)
+{
+    saveConfigToFile("/config.txt", config);
+    if (onConfigChanged)
+    {
+        onConfigChanged(config, false);
     }
 }
 
@@ -122,11 +144,13 @@ bool ConfigManager::saveConfigToFile(const char *path, const PianoLedConfig &con
     if (!beginFS())
         return false;
 
+    EventTrace::Begin(EventTrace::Id::FlashWrite);
     if (fs.exists(path))
         fs.remove(path);
     File f = fs.open(path, FILE_WRITE);
     if (!f)
     {
+        EventTrace::End(EventTrace::Id::FlashWrite);
         Serial.printf("open('%s') failed\n", path);
         return false;
     }
@@ -136,6 +160,7 @@ bool ConfigManager::saveConfigToFile(const char *path, const PianoLedConfig &con
     f.flush();
     uint32_t written = f.position() - before;
     f.close();
+    EventTrace::End(EventTrace::Id::FlashWrite, written);
 
     Serial.printf("saveConfigToFile: wrote %lu bytes to '%s'\n", (unsigned long)written, path);
     bool ok = written > 0;
@@ -150,6 +175,102 @@ bool ConfigManager::saveConfigToFile(const char *path, const PianoLedConfig &con
     return ok;
 }
 
+void ConfigManager::presetPath(uint8_t slot, char *out, size_t size)
+{
+    snprintf(out, size, "/preset%u.txt", slot);
+}
+
+bool ConfigManager::loadPresetFromFile(uint8_t slot, String &name, PianoLedConfig &out)
+{
+    char path[24];
+    presetPath(slot, path, sizeof(path));
+    if (!fsReady || !fs.exists(path))
+        return false;
+
+    File f = fs.open(path, FILE_READ);
+    if (!f)
+    {
+        Serial.printf("loadPresetFromFile: open('%s') failed\n", path);
+        return false;
+    }
+
+    // name = <name>, then the look in the format of the configuration
+    String line = f.readStringUntil('\n');
+    int eq = line.indexOf('=');
+    name = eq > 0 ? line.substring(eq + 1) : String();
+    name.trim();
+    bool ok = name.length() > 0 && parseConfigFromStream(f, out, 0);
+    f.close();
+    return ok;
+}
+
+bool ConfigManager::savePresetToFile(uint8_t slot, const char *name, const PianoLedConfig &look)
+{
+    if (!beginFS())
+        return false;
+
+    char path[24];
+    presetPath(slot, path, sizeof(path));
+    EventTrace::Begin(EventTrace::Id::FlashWrite);
+    if (fs.exists(path))
+        fs.remove(path);
+    File f = fs.open(path, FILE_WRITE);
+    if (!f)
+    {
+        EventTrace::End(EventTrace::Id::FlashWrite);
+        Serial.printf("open('%s') failed\n", path);
+        return false;
+    }
+
+    writePresetToStream(f, name, look);
+    f.flush();
+    uint32_t written = f.position();
+    f.close();
+    EventTrace::End(EventTrace::Id::FlashWrite, written);
+
+    Serial.printf("savePresetToFile: wrote %lu bytes to '%s'\n", (unsigned long)written, path);
+    return written > 0;
+}
+
+bool ConfigManager::removePresetFile(uint8_t slot)
+{
+    char path[24];
+    presetPath(slot, path, sizeof(path));
+    return beginFS() && fs.exists(path) && fs.remove(path);
+}
+
+// Example preset file:
+// name = Warm
+// colorPalette[0] = #FF8000
+// colorPalette[1] = #FF0000
+// colorLayout = NoteBased
+// colorInterpolation = OkLab
+// zone[0].notes = 0,59
+// zone[0].colorPalette = #FFFF00,#FF8000
+// noteOffColor = #201000
+// noteOffColorBrightness = 6
+// guideColor = #00FF00
+// guideColorBrightness = 64
+// End of Config
+void ConfigManager::writePresetToStream(Print &out, const char *name, const PianoLedConfig &look)
+{
+    out.printf("name = %s\n", name);
+    for (size_t i = 0; i < look.colorPalette.size(); ++i)
+    {
+        auto &c = look.colorPalette[i];
+        out.printf("colorPalette[%u] = #%02X%02X%02X\n", (unsigned)i, c.r, c.g, c.b);
+    }
+    out.printf("colorLayout = %s\n",
+               look.colorLayout == PianoLedConfig::LedStripColorLayout::VelocityBased ? "VelocityBased" : "NoteBased");
+    out.printf("colorInterpolation = %s\n", interpolationToString(look.colorInterpolation));
+    writeColorZones(out, look);
+    out.printf("noteOffColor = #%02X%02X%02X\n", look.noteOffColor.r, look.noteOffColor.g, look.noteOffColor.b);
+    out.printf("noteOffColorBrightness = %d\n", look.noteOffColorBrightness);
+    out.printf("guideColor = #%02X%02X%02X\n", look.guideColor.r, look.guideColor.g, look.guideColor.b);
+    out.printf("guideColorBrightness = %d\n", look.guideColorBrightness);
+    out.println("End of Config");
+}
+
 void ConfigManager::writeConfigToStream(Print &out, const PianoLedConfig &config)
 {
     // TODO
@@ -185,6 +306,59 @@ void ConfigManager::writeConfigToStream(Print &out, const PianoLedConfig &config
             out.println("StackedRightToLeft");
             break;
         }
+        out.print("maxMilliamps = ");
+        out.println(config.strips[i].maxMilliamps);
+        out.print("keySpanMode = ");
+        out.println(keySpanModeToString(config.strips[i].keySpanMode));
+        out.print("ledType = ");
+        out.println(ledTypeToString(config.strips[i].ledType));
+        if (config.strips[i].clockPin >= 0)
+        {
+            out.print("clockPin = ");
+            out.println(config.strips[i].clockPin);
+        }
+        if (config.strips[i].rgbw)
+        {
+            auto &w = config.strips[i].whiteLedColor;
+            char buf[8];
+            sprintf(buf, "%02X%02X%02X", w.r, w.g, w.b);
+            out.println("rgbw = true");
+            out.print("whiteLedColor = #");
+            out.println(buf);
+        }
+        out.print("colorCorrection = ");
+        out.println(config.strips[i].colorCorrection ? "true" : "false");
+        out.print("temporalDithering = ");
+        out.println(config.strips[i].temporalDithering ? "true" : "false");
+        auto &calibration = config.strips[i].keySpanCalibration;
+        for (size_t note = 0; note < calibration.size(); ++note)
+        {
+            if (calibration[note].ledCount == 0)
+                continue;
+            out.print("keySpan[");
+            out.print(note);
+            out.print("] = ");
+            out.print(calibration[note].startLed);
+            out.print(',');
+            out.println(calibration[note].ledCount);
+        }
+    }
+
+    for (size_t i = 0; i < config.topology.size(); ++i)
+    {
+        auto &segment = config.topology[i];
+        out.print("segment[");
+        out.print(i);
+        out.print("] = ");
+        out.print(segment.stripNumber);
+        out.print(',');
+        out.print(segment.startLed);
+        out.print(',');
+        out.print(segment.ledCount);
+        out.print(',');
+        out.print(segment.direction == LedSegment::Direction::LeftToRight ? "LeftToRight" : "RightToLeft");
+        out.print(',');
+        out.println(segment.row);
     }
 
     for (size_t i = 0; i < config.colorPalette.size(); ++i)
@@ -202,6 +376,11 @@ void ConfigManager::writeConfigToStream(Print &out, const PianoLedConfig &config
     out.println(config.colorLayout == PianoLedConfig::LedStripColorLayout::VelocityBased
                     ? "VelocityBased"
                     : "NoteBased");
+    out.print("colorInterpolation = ");
+    out.println(interpolationToString(config.colorInterpolation));
+    writeColorZones(out, config);
+    writeSourceRoutes(out, config);
+    writeCurve(out, "velocityCurve", config.velocityCurve);
     {
         auto &c = config.noteOffColor;
         char buf[8];
@@ -223,6 +402,44 @@ void ConfigManager::writeConfigToStream(Print &out, const PianoLedConfig &config
     out.println();
     out.print("lowestKey = ");
     out.println(config.lowestKey.c_str());
+    out.print("powerBudgetMilliamps = ");
+    out.println(config.powerBudgetMilliamps);
+    out.print("recordControlCc = ");
+    out.println(config.recordControlCc);
+    out.print("guideLookaheadMs = ");
+    out.println(config.guideLookaheadMs);
+    {
+        auto &c = config.guideColor;
+        char buf[8];
+        sprintf(buf, "%02X%02X%02X", c.r, c.g, c.b);
+        out.print("guideColor = #");
+        out.println(buf);
+    }
+    out.print("guideColorBrightness = ");
+    out.println(config.guideColorBrightness);
+    out.print("stallThresholdMs = ");
+    out.println(config.stallThresholdMs);
+    out.print("watchdogTimeoutMs = ");
+    out.println(config.watchdogTimeoutMs);
+    out.print("ledStreamIntervalMs = ");
+    out.println(config.ledStreamIntervalMs);
+    out.print("minNoteOnMs = ");
+    out.println(config.minNoteOnMs);
+    out.print("thruTranspose = ");
+    out.println(config.thruTranspose);
+    out.print("thruChannel = ");
+    out.println(config.thruChannel);
+    out.print("thruSplitNote = ");
+    out.println(config.thruSplitNote);
+    out.print("thruSplitChannel = ");
+    out.println(config.thruSplitChannel);
+    out.print("thruSplitTranspose = ");
+    out.println(config.thruSplitTranspose);
+    writeCurve(out, "thruVelocityCurve", config.thruVelocityCurve);
+    out.print("ledFollowsThru = ");
+    out.println(config.ledFollowsThru ? "true" : "false");
+    out.print("presetChannel = ");
+    out.println(config.presetChannel);
     out.println("End of Config");
 }
 
@@ -234,20 +451,62 @@ void ConfigManager::writeConfigToStream(Print &out, const PianoLedConfig &config
 // ledsPerMeter = 148
 // stripToPianoLengthScale = 1.68
 // stripOrientation = StackedLeftToRight
+// keySpanMode = Calibrated
+// ledType = WS2812B
+// clockPin = 13 (only for APA102 / SK9822)
+// rgbw = true
+// whiteLedColor = #FFB46B
+// colorCorrection = true
+// temporalDithering = false
+// keySpan[21] = 0,2
+// segment[0] = 0,0,74,LeftToRight,0
+// segment[1] = 0,74,74,RightToLeft,1
 // colorPalette[0] = #0000FF
 // colorPalette[1] = #FF0000
 // colorLayout = VelocityBased
+// colorInterpolation = OkLab
+// zone[0].notes = 0,59
+// zone[0].channels = 1
+// zone[0].colorPalette = #00FF00,#FFFF00
+// zone[0].colorLayout = NoteBased
+// zone[0].colorInterpolation = OkLab
+// source[0].strips = 0
+// source[1].strips = 1
+// source[1].zones = 0
+// velocityCurve = 0,1,1,2,...,127 (128 entries)
 // noteOffColor = #FFFFFF
 // noteOffColorBrightness = 6
 // midiChannelsToListen = 1,2
 // lowestKey = A0
-bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, uint32_t quietMs = 1500)
+// powerBudgetMilliamps = 4000
+// recordControlCc = 20
+// guideLookaheadMs = 500
+// guideColor = #00FF00
+// guideColorBrightness = 64
+// stallThresholdMs = 20
+// watchdogTimeoutMs = 8000
+// ledStreamIntervalMs = 50
+// minNoteOnMs = 30
+// thruTranspose = 0
+// thruChannel = 0
+// thruSplitNote = 60
+// thruSplitChannel = 2
+// thruSplitTranspose = -12
+// thruVelocityCurve = 1,1,2,3,...,127 (128 entries)
+// ledFollowsThru = false
+// presetChannel = 16
+bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, uint32_t quietMs)
 {
     // TODO color curve
 
     config.colorPalette.clear();
     config.midiChannelsToListen.clear();
     config.strips.clear();
+    config.topology.clear();
+    config.colorZones.clear();
+    config.sourceRoutes.clear();
+    config.velocityCurve.clear();
+    config.thruVelocityCurve.clear();
 
     int currentStripIndex = -1;
     int colorPaletteIndex = -1;
@@ -268,6 +527,7 @@ bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, ui
         }
 
         lastByteMs = millis();
+        LoopMonitor::feedWatchdog(); // a long config transfer is still progress
         line.trim();
 
         if (line == "Sending Config")
@@ -307,7 +567,7 @@ bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, ui
                           { s.ledPin = v.toInt(); });
         else if (k == "totalLeds")
             setStripField([&](auto &s)
-                          { s.totalLeds = v.toInt(); });
+                          { s.totalLeds = std::min(std::max((int)v.toInt(), 0), PianoLedConfig::maxLedsPerStrip); });
         else if (k == "ledsPerMeter")
             setStripField([&](auto &s)
                           { s.ledsPerMeter = v.toFloat(); });
@@ -327,6 +587,121 @@ bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, ui
                                 else if (v.toInt() >= 0 && v.toInt() < 4) {
                                     s.stripOrientation = static_cast<PianoLedStrip::StripOrientation>(v.toInt());
                                 } });
+        else if (k == "maxMilliamps")
+            setStripField([&](auto &s)
+                          { s.maxMilliamps = v.toInt(); });
+        else if (k == "keySpanMode")
+            setStripField([&](auto &s)
+                          { keySpanModeFromString(v, s.keySpanMode); });
+        else if (k == "ledType")
+            setStripField([&](auto &s)
+                          { ledTypeFromString(v, s.ledType); });
+        else if (k == "clockPin")
+            setStripField([&](auto &s)
+                          { s.clockPin = v.toInt(); });
+        else if (k == "rgbw")
+            setStripField([&](auto &s)
+                          { s.rgbw = v == "true" || v == "1"; });
+        else if (k == "whiteLedColor")
+            setStripField([&](auto &s)
+                          { parseHexColor(v, s.whiteLedColor); });
+        else if (k == "colorCorrection")
+            setStripField([&](auto &s)
+                          { s.colorCorrection = v == "true" || v == "1"; });
+        else if (k == "temporalDithering")
+            setStripField([&](auto &s)
+                          { s.temporalDithering = v == "true" || v == "1"; });
+        else if (k.startsWith("keySpan["))
+            setStripField([&](auto &s)
+                          {
+                              int note = k.substring(8, k.indexOf(']')).toInt();
+                              int comma = v.indexOf(',');
+                              if (note < 0 || note >= 128 || comma < 0)
+                                  return;
+                              if (s.keySpanCalibration.empty())
+                                  s.keySpanCalibration.resize(128, KeySpan{0, 0});
+                              s.keySpanCalibration[note].startLed = v.substring(0, comma).toInt();
+                              s.keySpanCalibration[note].ledCount = v.substring(comma + 1).toInt(); });
+        else if (k.startsWith("segment["))
+        {
+            // segment[i] = strip,startLed,ledCount,direction[,row]
+            int segmentIndex = k.substring(8, k.indexOf(']')).toInt();
+            LedSegment segment;
+            if (segmentIndex >= 0 && segmentIndex < PianoLedConfig::maxSegments && parseSegment(v, segment))
+            {
+                if ((int)config.topology.size() <= segmentIndex)
+                    config.topology.resize(segmentIndex + 1, LedSegment{0, 0, 0, LedSegment::Direction::LeftToRight});
+                config.topology[segmentIndex] = segment;
+            }
+        }
+        else if (k.startsWith("zone["))
+        {
+            // zone[i].field = value
+            int zoneIndex = k.substring(5, k.indexOf(']')).toInt();
+            String field = k.substring(k.indexOf("].") + 2);
+            if (zoneIndex < 0 || zoneIndex >= PianoLedConfig::maxColorZones || k.indexOf("].") < 0)
+                continue;
+            if ((int)config.colorZones.size() <= zoneIndex)
+                config.colorZones.resize(zoneIndex + 1);
+            auto &zone = config.colorZones[zoneIndex];
+
+            if (field == "notes")
+            {
+                // lowest,highest MIDI note number
+                int comma = v.indexOf(',');
+                if (comma > 0)
+                {
+                    zone.lowestNote = v.substring(0, comma).toInt();
+                    zone.highestNote = v.substring(comma + 1).toInt();
+                }
+            }
+            else if (field == "channels")
+            {
+                zone.midiChannels.clear();
+                forEachListItem(v, [&](const String &item)
+                                { zone.midiChannels.push_back(item.toInt()); });
+            }
+            else if (field == "colorPalette")
+            {
+                zone.colorPalette.clear();
+                forEachListItem(v, [&](const String &item)
+                                {
+                                    LedColor c;
+                                    if (zone.colorPalette.size() < PianoLedConfig::maxColorPaletteSize && parseHexColor(item, c))
+                                        zone.colorPalette.push_back(c); });
+            }
+            else if (field == "colorLayout")
+            {
+                if (v == "VelocityBased")
+                    zone.colorLayout = PianoLedConfig::LedStripColorLayout::VelocityBased;
+                else if (v == "NoteBased")
+                    zone.colorLayout = PianoLedConfig::LedStripColorLayout::NoteBased;
+            }
+            else if (field == "colorInterpolation")
+                interpolationFromString(v, zone.colorInterpolation);
+        }
+        else if (k.startsWith("source["))
+        {
+            // source[i].strips = 0,1 / source[i].zones = 0,2
+            int sourceIndex = k.substring(7, k.indexOf(']')).toInt();
+            String field = k.substring(k.indexOf("].") + 2);
+            if (sourceIndex < 0 || sourceIndex >= MidiSources::count || k.indexOf("].") < 0 || (field != "strips" && field != "zones"))
+                continue;
+            if ((int)config.sourceRoutes.size() <= sourceIndex)
+                config.sourceRoutes.resize(sourceIndex + 1);
+            auto &route = config.sourceRoutes[sourceIndex];
+            auto &list = field == "strips" ? route.strips : route.zones;
+            list.clear();
+            forEachListItem(v, [&](const String &item)
+                            { list.push_back(item.toInt()); });
+        }
+        else if (k == "velocityCurve")
+        {
+            forEachListItem(v, [&](const String &item)
+                            { config.velocityCurve.push_back(std::min(std::max((int)item.toInt(), 0), 127)); });
+            if (config.velocityCurve.size() != VelocityCalibration::velocityCount)
+                config.velocityCurve.clear();
+        }
         else if (k.startsWith("colorPalette["))
         {
             colorPaletteIndex = line.substring(13, line.indexOf(']')).toInt();
@@ -344,6 +719,8 @@ bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, ui
             else if (v == "NoteBased")
                 config.colorLayout = PianoLedConfig::LedStripColorLayout::NoteBased;
         }
+        else if (k == "colorInterpolation")
+            interpolationFromString(v, config.colorInterpolation);
         else if (k == "noteOffColor")
         {
             LedColor c;
@@ -355,21 +732,54 @@ bool ConfigManager::parseConfigFromStream(Stream &in, PianoLedConfig &config, ui
         else if (k == "midiChannelsToListen")
         {
             config.midiChannelsToListen.clear();
-            int start = 0;
-            while (start < v.length())
-            {
-                int comma = v.indexOf(',', start);
-                String s = (comma < 0) ? v.substring(start) : v.substring(start, comma);
-                s.trim();
-                if (s.length())
-                    config.midiChannelsToListen.push_back(s.toInt());
-                if (comma < 0)
-                    break;
-                start = comma + 1;
-            }
+            forEachListItem(v, [&](const String &item)
+                            { config.midiChannelsToListen.push_back(item.toInt()); });
         }
         else if (k == "lowestKey")
             config.lowestKey = std::string(v.c_str());
+        else if (k == "powerBudgetMilliamps")
+            config.powerBudgetMilliamps = v.toInt();
+        else if (k == "recordControlCc")
+            config.recordControlCc = v.toInt();
+        else if (k == "guideLookaheadMs")
+            config.guideLookaheadMs = v.toInt();
+        else if (k == "guideColor")
+        {
+            LedColor c;
+            if (parseHexColor(v, c))
+                config.guideColor = c;
+        }
+        else if (k == "guideColorBrightness")
+            config.guideColorBrightness = v.toInt();
+        else if (k == "stallThresholdMs")
+            config.stallThresholdMs = v.toInt();
+        else if (k == "watchdogTimeoutMs")
+            config.watchdogTimeoutMs = v.toInt();
+        else if (k == "ledStreamIntervalMs")
+            config.ledStreamIntervalMs = v.toInt();
+        else if (k == "minNoteOnMs")
+            config.minNoteOnMs = v.toInt();
+        else if (k == "thruTranspose")
+            config.thruTranspose = v.toInt();
+        else if (k == "thruChannel")
+            config.thruChannel = v.toInt();
+        else if (k == "thruSplitNote")
+            config.thruSplitNote = v.toInt();
+        else if (k == "thruSplitChannel")
+            config.thruSplitChannel = v.toInt();
+        else if (k == "thruSplitTranspose")
+            config.thruSplitTranspose = v.toInt();
+        else if (k == "thruVelocityCurve")
+        {
+            forEachListItem(v, [&](const String &item)
+                            { config.thruVelocityCurve.push_back(std::min(std::max((int)item.toInt(), 0), 127)); });
+            if (config.thruVelocityCurve.size() != VelocityCalibration::velocityCount)
+                config.thruVelocityCurve.clear();
+        }
+        else if (k == "ledFollowsThru")
+            config.ledFollowsThru = v == "true" || v == "1";
+        else if (k == "presetChannel")
+            config.presetChannel = v.toInt();
     }
 
     // choose a default mapping if none was specified
@@ -413,6 +823,39 @@ void ConfigManager::printConfig(const PianoLedConfig &config)
             Serial.println("Unknown");
             break;
         }
+        Serial.print("  maxMilliamps = ");
+        Serial.println(config.strips[i].maxMilliamps);
+        Serial.print("  keySpanMode = ");
+        Serial.println(keySpanModeToString(config.strips[i].keySpanMode));
+        Serial.print("  ledType = ");
+        Serial.println(ledTypeToString(config.strips[i].ledType));
+        Serial.print("  clockPin = ");
+        Serial.println(config.strips[i].clockPin);
+        Serial.print("  rgbw = ");
+        Serial.println(config.strips[i].rgbw ? "true" : "false");
+        if (config.strips[i].rgbw)
+        {
+            auto &w = config.strips[i].whiteLedColor;
+            Serial.printf("  whiteLedColor = #%02X%02X%02X\n", w.r, w.g, w.b);
+        }
+        Serial.print("  colorCorrection = ");
+        Serial.println(config.strips[i].colorCorrection ? "true" : "false");
+        Serial.print("  temporalDithering = ");
+        Serial.println(config.strips[i].temporalDithering ? "true" : "false");
+        size_t calibratedKeys = 0;
+        for (auto &span : config.strips[i].keySpanCalibration)
+            calibratedKeys += span.ledCount > 0 ? 1 : 0;
+        Serial.print("  calibrated keys = ");
+        Serial.println(calibratedKeys);
+    }
+
+    // Print topology
+    for (size_t i = 0; i < config.topology.size(); ++i)
+    {
+        auto &segment = config.topology[i];
+        Serial.printf("segment[%u] = strip %d, LEDs %d-%d, %s, row %d\n", (unsigned)i, segment.stripNumber, segment.startLed,
+                      segment.startLed + segment.ledCount - 1,
+                      segment.direction == LedSegment::Direction::LeftToRight ? "LeftToRight" : "RightToLeft", segment.row);
     }
 
     // Print colorPalette
@@ -442,6 +885,19 @@ void ConfigManager::printConfig(const PianoLedConfig &config)
         break;
     }
 
+    // Print colorInterpolation
+    Serial.print("colorInterpolation = ");
+    Serial.println(interpolationToString(config.colorInterpolation));
+
+    // Print color zones
+    writeColorZones(Serial, config);
+
+    // Print MIDI source routes
+    writeSourceRoutes(Serial, config);
+
+    // Print velocityCurve
+    writeCurve(Serial, "velocityCurve", config.velocityCurve);
+
     // Print noteOffColor
     {
         auto &c = config.noteOffColor;
@@ -468,6 +924,58 @@ void ConfigManager::printConfig(const PianoLedConfig &config)
     // Print lowestKey
     Serial.print("lowestKey = ");
     Serial.println(config.lowestKey.c_str());
+
+    // Print powerBudgetMilliamps
+    Serial.print("powerBudgetMilliamps = ");
+    Serial.println(config.powerBudgetMilliamps);
+
+    // Print recordControlCc
+    Serial.print("recordControlCc = ");
+    Serial.println(config.recordControlCc);
+
+    // Print playback guide settings
+    Serial.print("guideLookaheadMs = ");
+    Serial.println(config.guideLookaheadMs);
+    {
+        auto &c = config.guideColor;
+        char buf[8];
+        sprintf(buf, "%02X%02X%02X", c.r, c.g, c.b);
+        Serial.print("guideColor = #");
+        Serial.println(buf);
+    }
+    Serial.print("guideColorBrightness = ");
+    Serial.println(config.guideColorBrightness);
+
+    // Print main loop monitoring
+    Serial.print("stallThresholdMs = ");
+    Serial.println(config.stallThresholdMs);
+    Serial.print("watchdogTimeoutMs = ");
+    Serial.println(config.watchdogTimeoutMs);
+
+    // Print ledStreamIntervalMs
+    Serial.print("ledStreamIntervalMs = ");
+    Serial.println(config.ledStreamIntervalMs);
+
+    // Print minNoteOnMs
+    Serial.print("minNoteOnMs = ");
+    Serial.println(config.minNoteOnMs);
+
+    // Print MIDI thru routing
+    Serial.print("thruTranspose = ");
+    Serial.println(config.thruTranspose);
+    Serial.print("thruChannel = ");
+    Serial.println(config.thruChannel);
+    Serial.print("thruSplitNote = ");
+    Serial.println(config.thruSplitNote);
+    Serial.print("thruSplitChannel = ");
+    Serial.println(config.thruSplitChannel);
+    Serial.print("thruSplitTranspose = ");
+    Serial.println(config.thruSplitTranspose);
+    writeCurve(Serial, "thruVelocityCurve", config.thruVelocityCurve);
+    Serial.print("ledFollowsThru = ");
+    Serial.println(config.ledFollowsThru ? "true" : "false");
+    Serial.print("presetChannel = ");
+    Serial.println(config.presetChannel);
 }
 
 // helper: "#RRGGBB" → LedColor
@@ -488,6 +996,220 @@ bool ConfigManager::parseHexColor(const String &v, LedColor &out)
     return true;
 }
 
+// helper: "strip,startLed,ledCount,direction[,row]" → LedSegment
+bool ConfigManager::parseSegment(const String &v, LedSegment &out)
+{
+    String fields[5];
+    int fieldCount = 0;
+    int start = 0;
+    while (fieldCount < 5)
+    {
+        int comma = v.indexOf(',', start);
+        fields[fieldCount] = (comma < 0) ? v.substring(start) : v.substring(start, comma);
+        fields[fieldCount].trim();
+        ++fieldCount;
+        if (comma < 0)
+            break;
+        start = comma + 1;
+    }
+    if (fieldCount < 4)
+        return false;
+
+    out.stripNumber = fields[0].toInt();
+    out.startLed = fields[1].toInt();
+    out.ledCount = fields[2].toInt();
+    if (fields[3] == "LeftToRight")
+        out.direction = LedSegment::Direction::LeftToRight;
+    else if (fields[3] == "RightToLeft")
+        out.direction = LedSegment::Direction::RightToLeft;
+    else
+        return false;
+    out.row = fieldCount == 5 ? fields[4].toInt() : 0;
+
+    return out.stripNumber >= 0 && out.stripNumber < PianoLedConfig::maxStrips && out.startLed >= 0 && out.ledCount > 0 && out.row >= 0;
+}
+
+const char *ConfigManager::keySpanModeToString(PianoLedStrip::KeySpanMode mode)
+{
+    switch (mode)
+    {
+    case PianoLedStrip::KeySpanMode::SingleLed:
+        return "SingleLed";
+    case PianoLedStrip::KeySpanMode::Calibrated:
+        return "Calibrated";
+    case PianoLedStrip::KeySpanMode::KeyGeometry:
+    default:
+        return "KeyGeometry";
+    }
+}
+
+bool ConfigManager::keySpanModeFromString(const String &v, PianoLedStrip::KeySpanMode &out)
+{
+    if (v == "SingleLed")
+        out = PianoLedStrip::KeySpanMode::SingleLed;
+    else if (v == "KeyGeometry")
+        out = PianoLedStrip::KeySpanMode::KeyGeometry;
+    else if (v == "Calibrated")
+        out = PianoLedStrip::KeySpanMode::Calibrated;
+    else
+        return false;
+    return true;
+}
+
+const char *ConfigManager::ledTypeToString(PianoLedStrip::LedType ledType)
+{
+    switch (ledType)
+    {
+    case PianoLedStrip::LedType::SK6812:
+        return "SK6812";
+    case PianoLedStrip::LedType::WS2811:
+        return "WS2811";
+    case PianoLedStrip::LedType::APA102:
+        return "APA102";
+    case PianoLedStrip::LedType::SK9822:
+        return "SK9822";
+    case PianoLedStrip::LedType::WS2812B:
+    default:
+        return "WS2812B";
+    }
+}
+
+bool ConfigManager::ledTypeFromString(const String &v, PianoLedStrip::LedType &out)
+{
+    if (v == "WS2812B")
+        out = PianoLedStrip::LedType::WS2812B;
+    else if (v == "SK6812")
+        out = PianoLedStrip::LedType::SK6812;
+    else if (v == "WS2811")
+        out = PianoLedStrip::LedType::WS2811;
+    else if (v == "APA102")
+        out = PianoLedStrip::LedType::APA102;
+    else if (v == "SK9822")
+        out = PianoLedStrip::LedType::SK9822;
+    else
+        return false;
+    return true;
+}
+
+const char *ConfigManager::interpolationToString(GradientColorMapping::Interpolation interpolation)
+{
+    switch (interpolation)
+    {
+    case GradientColorMapping::Interpolation::HsvShortHue:
+        return "HsvShortHue";
+    case GradientColorMapping::Interpolation::HsvLongHue:
+        return "HsvLongHue";
+    case GradientColorMapping::Interpolation::OkLab:
+        return "OkLab";
+    case GradientColorMapping::Interpolation::Rgb:
+    default:
+        return "Rgb";
+    }
+}
+
+bool ConfigManager::interpolationFromString(const String &v, GradientColorMapping::Interpolation &out)
+{
+    if (v == "Rgb")
+        out = GradientColorMapping::Interpolation::Rgb;
+    else if (v == "HsvShortHue")
+        out = GradientColorMapping::Interpolation::HsvShortHue;
+    else if (v == "HsvLongHue")
+        out = GradientColorMapping::Interpolation::HsvLongHue;
+    else if (v == "OkLab")
+        out = GradientColorMapping::Interpolation::OkLab;
+    else
+        return false;
+    return true;
+}
+
+void ConfigManager::writeColorZones(Print &out, const PianoLedConfig &config)
+{
+    for (size_t i = 0; i < config.colorZones.size(); ++i)
+    {
+        auto &zone = config.colorZones[i];
+        out.printf("zone[%u].notes = %d,%d\n", (unsigned)i, zone.lowestNote, zone.highestNote);
+        if (!zone.midiChannels.empty())
+        {
+            out.printf("zone[%u].channels = ", (unsigned)i);
+            for (size_t c = 0; c < zone.midiChannels.size(); ++c)
+            {
+                out.print(zone.midiChannels[c]);
+                if (c + 1 < zone.midiChannels.size())
+                    out.print(',');
+            }
+            out.println();
+        }
+        if (!zone.colorPalette.empty())
+        {
+            out.printf("zone[%u].colorPalette = ", (unsigned)i);
+            for (size_t c = 0; c < zone.colorPalette.size(); ++c)
+            {
+                auto &color = zone.colorPalette[c];
+                out.printf("#%02X%02X%02X", color.r, color.g, color.b);
+                if (c + 1 < zone.colorPalette.size())
+                    out.print(',');
+            }
+            out.println();
+        }
+        out.printf("zone[%u].colorLayout = %s\n", (unsigned)i,
+                   zone.colorLayout == PianoLedConfig::LedStripColorLayout::VelocityBased ? "VelocityBased" : "NoteBased");
+        out.printf("zone[%u].colorInterpolation = %s\n", (unsigned)i, interpolationToString(zone.colorInterpolation));
+    }
+}
+
+void ConfigManager::writeSourceRoutes(Print &out, const PianoLedConfig &config)
+{
+    auto writeList = [&](size_t source, const char *field, const std::vector<uint8_t> &list)
+    {
+        if (list.empty())
+            return;
+        out.printf("source[%u].%s = ", (unsigned)source, field);
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            out.print(list[i]);
+            if (i + 1 < list.size())
+                out.print(',');
+        }
+        out.println();
+    };
+    for (size_t i = 0; i < config.sourceRoutes.size(); ++i)
+    {
+        writeList(i, "strips", config.sourceRoutes[i].strips);
+        writeList(i, "zones", config.sourceRoutes[i].zones);
+    }
+}
+
+void ConfigManager::writeCurve(Print &out, const char *key, const std::vector<uint8_t> &curve)
+{
+    if (curve.empty())
+        return;
+    out.print(key);
+    out.print(" = ");
+    for (size_t i = 0; i < curve.size(); ++i)
+    {
+        out.print(curve[i]);
+        if (i + 1 < curve.size())
+            out.print(',');
+    }
+    out.println();
+}
+
+void ConfigManager::forEachListItem(const String &v, const std::function<void(const String &)> &callback)
+{
+    unsigned int start = 0;
+    while (start < v.length())
+    {
+        int comma = v.indexOf(',', start);
+        String item = (comma < 0) ? v.substring(start) : v.substring(start, comma);
+        item.trim();
+        if (item.length())
+            callback(item);
+        if (comma < 0)
+            break;
+        start = comma + 1;
+    }
+}
+
 bool ConfigManager::beginFS()
 {
     if (fsReady)
@@ -9,23 +9,59 @@ class ConfigManager
 public:
     std::function<void(const PianoLedConfig &, bool)> onConfigChanged;
 
+    /**
+     * Called with commands from the remote MCU that are not about the configuration. Replies go to \p reply.
+     */
+    std::function<void(const String &command, Print &reply)> onRemoteCommand;
+
     ConfigManager();
 
     void begin();
     void loop();
 
+    /**
+     * Saves \p config and makes it the active configuration, like a config change from the remote MCU.
+     */
+    void applyConfig(const PianoLedConfig &config);
+
+    /**
+     * The LittleFS the configuration is stored on, for other files. nullptr if it could not be mounted.
+     */
+    FS *fileSystem() { return beginFS() ? &fs : nullptr; }
+
     bool loadConfigFromFile(const char *path, PianoLedConfig &out, bool *configExists);
     bool saveConfigToFile(const char *path, const PianoLedConfig &config);
 
+    /**
+     * Presets (see PresetBank.h) are stored as /preset<slot>.txt: a name line followed by the keys of the look in
+     * the format of the configuration. Loading starts from \p out, so it should be a copy of the current configuration.
+     */
+    bool loadPresetFromFile(uint8_t slot, String &name, PianoLedConfig &out);
+    bool savePresetToFile(uint8_t slot, const char *name, const PianoLedConfig &look);
+    bool removePresetFile(uint8_t slot);
+
 private:
     LittleFS_Program fs;
     bool fsReady = false;
 
     void ReadRemoteMCU();
     void writeConfigToStream(Print &out, const PianoLedConfig &config);
+    void writePresetToStream(Print &out, const char *name, const PianoLedConfig &look);
+    static void presetPath(uint8_t slot, char *out, size_t size);
     bool parseConfigFromStream(Stream &in, PianoLedConfig &config, uint32_t quietMs = 1500);
     void printConfig(const PianoLedConfig &config);
+    void writeColorZones(Print &out, const PianoLedConfig &config);
+    void writeSourceRoutes(Print &out, const PianoLedConfig &config);
+    void writeCurve(Print &out, const char *key, const std::vector<uint8_t> &curve);
     bool parseHexColor(const String &v, LedColor &out);
+    bool parseSegment(const String &v, LedSegment &out);
+    static void forEachListItem(const String &v, const std::function<void(const String &)> &callback);
+    static const char *keySpanModeToString(PianoLedStrip::KeySpanMode mode);
+    static bool keySpanModeFromString(const String &v, PianoLedStrip::KeySpanMode &out);
+    static const char *ledTypeToString(PianoLedStrip::LedType ledType);
+    static bool ledTypeFromString(const String &v, PianoLedStrip::LedType &out);
+    static const char *interpolationToString(GradientColorMapping::Interpolation interpolation);
+    static bool interpolationFromString(const String &v, GradientColorMapping::Interpolation &out);
     bool beginFS();
 };
 
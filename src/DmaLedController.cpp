@@ -0,0 +1,36 @@
+#include "DmaLedController.h"
+#include "PianoLedConfig.h"
+
+DmaLedController::DmaLedController(ILedDmaEngine *engine)
+    : engine(engine), engineReady(false), framePending(false), framesTransmitted(0), framesDeferred(0)
+{
+    AllocateFrame();
+
+    std::vector<uint8_t> pins;
+    for (auto &strip : PianoLedConfig::globalConfig.strips)
+    {
+        pins.push_back(strip.ledPin);
+    }
+    engineReady = engine->Begin(ledsPerStrip, pins);
+}
+
+void DmaLedController::Update()
+{
+    if (framePending && engineReady && !engine->Busy())
+    {
+        framePending = false;
+        engine->Transmit(RenderOutput(), OutputBrightness());
+        ++framesTransmitted;
+    }
+}
+
+void DmaLedController::Flush()
+{
+    if (framePending)
+    {
+        // the engine has not picked up the previous frame yet; this change rides along with it
+        ++framesDeferred;
+    }
+    framePending = true;
+    Update();
+}
@@ -0,0 +1,44 @@
+#ifndef DMA_LED_CONTROLLER_H
+#define DMA_LED_CONTROLLER_H
+
+#include <cstdint>
+#include "FrameBufferLedController.h"
+#include "LedDmaEngine.h"
+
+/**
+ * Non-blocking LED controller. Renders into the CPU side frame and hands it to an \ref ILedDmaEngine, which streams
+ * it to the strips in the background while interrupts stay enabled.
+ *
+ * If the engine is still busy with the previous frame, the new frame is only marked as pending and handed over by
+ * \ref Update once the engine reports completion. Several changes made while the engine is busy are therefore
+ * coalesced into a single frame.
+ */
+class DmaLedController : public FrameBufferLedController
+{
+public:
+    explicit DmaLedController(ILedDmaEngine *engine);
+
+    void Update() override;
+
+    /**
+     * Frames that were handed to the engine.
+     */
+    uint32_t FramesTransmitted() const { return framesTransmitted; }
+
+    /**
+     * Commits that found the engine busy and were merged into a later frame.
+     */
+    uint32_t FramesDeferred() const { return framesDeferred; }
+
+protected:
+    void Flush() override;
+
+private:
+    ILedDmaEngine *engine;
+    bool engineReady;
+    bool framePending;
+    uint32_t framesTransmitted;
+    uint32_t framesDeferred;
+};
+
+#endif // DMA_LED_CONTROLLER_H
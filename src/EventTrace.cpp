@@ -0,0 +1,76 @@
+#include "EventTrace.h"
+#include "MemoryMap.h"
+
+#if defined(PIANO_LED_TRACE)
+// Only appended to and dumped in bulk, so it can live in the slower OCRAM
+#if defined(ARDUINO)
+DMAMEM static EventTrace::Record ring[EventTrace::capacity];
+#else
+static EventTrace::Record ring[EventTrace::capacity];
+#endif
+
+EventTrace::Record *EventTrace::records = ring;
+uint32_t EventTrace::head = 0;
+uint32_t EventTrace::lastCycles = 0;
+
+namespace
+{
+    // the ring exists for the whole run, so it is in the memory report from startup on, not only after a dump
+    struct RingRecord
+    {
+        RingRecord() { MemoryMap::Record("event trace", ring, sizeof(ring), sizeof(ring)); }
+    } ringRecord;
+}
+#endif
+
+const char *EventTrace::IdName(Id id)
+{
+    switch (id)
+    {
+    case Id::Clock:
+        return "clock";
+    case Id::MidiIn:
+        return "MIDI in";
+    case Id::Mapping:
+        return "mapping";
+    case Id::FrameCommit:
+        return "frame commit";
+    case Id::Show:
+        return "show";
+    case Id::UartParse:
+        return "UART parse";
+    case Id::FlashWrite:
+        return "flash write";
+    default:
+        return "unknown";
+    }
+}
+
+void EventTrace::Clear()
+{
+#if defined(PIANO_LED_TRACE)
+    head = 0;
+#endif
+}
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+
+void EventTrace::Dump(Print &out)
+{
+#if defined(PIANO_LED_TRACE)
+    uint32_t count = head < capacity ? head : capacity;
+    out.printf("trace begin %lu %lu\n", (unsigned long)F_CPU_ACTUAL, (unsigned long)count);
+    for (uint32_t i = head - count; i != head; ++i)
+    {
+        const Record &record = records[i & (capacity - 1)];
+        out.printf("%08lx%02x%02x%04x\n", (unsigned long)record.cycles, static_cast<unsigned>(record.id),
+                   static_cast<unsigned>(record.phase), record.arg);
+    }
+    out.println("trace end");
+#else
+    out.println("Tracing is not compiled in, use the environment teensy41_trace.");
+#endif
+}
+#endif // ARDUINO
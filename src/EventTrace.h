@@ -0,0 +1,138 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(PIANO_LED_TRACE) && defined(ARDUINO)
+#include <Arduino.h>
+#elif defined(PIANO_LED_TRACE)
+#include <chrono>
+#endif
+
+class Print;
+
+/**
+ * Timeline of what the firmware spends its time on: MIDI input, key mapping, frame commits, LED output, UART config
+ * parsing and flash writes, e.g. to see a config save overlapping a fast run.
+ *
+ * Each event is an 8-byte record with the cycle counter, an \ref Id and a 16-bit argument, appended to a ring buffer
+ * that keeps the last \ref capacity records. Appending is a handful of stores, so the trace can stay enabled while
+ * playing. The `trace` console command dumps the ring as hex lines, and tools/TraceToChrome.cpp converts a capture
+ * of them into Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Only compiled in with PIANO_LED_TRACE (environment teensy41_trace); otherwise every call is an empty inline
+ * function and no ring buffer exists. Records are appended from the main loop only, not from interrupts.
+ */
+class EventTrace
+{
+public:
+    enum class Id : uint8_t
+    {
+        Clock,       // keeps the 32-bit cycle counter unambiguous during idle periods, see Poll
+        MidiIn,      // arg: status << 8 | data1
+        Mapping,     // arg: note
+        FrameCommit, // arg: frame bytes
+        Show,        // arg: output brightness
+        UartParse,   // arg: bytes available when the slice started
+        FlashWrite,  // arg: bytes written
+        Count,
+    };
+
+    enum class Phase : uint8_t
+    {
+        Instant,
+        Begin,
+        End,
+    };
+
+    struct Record
+    {
+        uint32_t cycles;
+        Id id;
+        Phase phase;
+        uint16_t arg;
+    };
+
+    static constexpr size_t capacity = 4096; // records, power of two
+
+    static const char *IdName(Id id);
+
+#if defined(PIANO_LED_TRACE)
+    static void Instant(Id id, uint16_t arg = 0) { Append(id, Phase::Instant, arg); }
+    static void Begin(Id id, uint16_t arg = 0) { Append(id, Phase::Begin, arg); }
+    static void End(Id id, uint16_t arg = 0) { Append(id, Phase::End, arg); }
+
+    /**
+     * Call once per main loop iteration. The cycle counter wraps every few seconds (7 s at 600 MHz), so while nothing
+     * else is traced a \ref Id::Clock record is added every quarter wrap; the converter can then unwrap all timestamps.
+     */
+    static void Poll()
+    {
+        if (Now() - lastCycles >= 1u << 30)
+            Instant(Id::Clock);
+    }
+
+    /**
+     * Traces the lifetime of the scope as a Begin/End pair.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(Id id, uint16_t arg = 0) : id(id), arg(arg) { Begin(id, arg); }
+        ~Scope() { End(id, arg); }
+
+    private:
+        Id id;
+        uint16_t arg;
+    };
+#else
+    static void Instant(Id, uint16_t = 0) {}
+    static void Begin(Id, uint16_t = 0) {}
+    static void End(Id, uint16_t = 0) {}
+    static void Poll() {}
+
+    class Scope
+    {
+    public:
+        explicit Scope(Id, uint16_t = 0) {}
+    };
+#endif
+
+    /**
+     * Prints the ring, oldest record first, between "trace begin <cycles per second> <records>" and "trace end"
+     * lines, one record per line as 16 hex digits (cycles, id, phase, arg). Prints a note if tracing is disabled.
+     * Only available in Arduino builds.
+     */
+    static void Dump(Print &out);
+
+    static void Clear();
+
+private:
+#if defined(PIANO_LED_TRACE)
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    static Record *records;
+    static uint32_t head;
+    static uint32_t lastCycles;
+
+    static uint32_t Now()
+    {
+#if defined(ARDUINO)
+        return ARM_DWT_CYCCNT;
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+#endif
+    }
+
+    static void Append(Id id, Phase phase, uint16_t arg)
+    {
+        lastCycles = Now();
+        records[head++ & (capacity - 1)] = {lastCycles, id, phase, arg};
+    }
+#endif
+};
+
+#endif // EVENT_TRACE_H
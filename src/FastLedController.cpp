@@ -1,32 +1,37 @@
 #include <Arduino.h>
 #include "FastLedController.h"
+#include "EventTrace.h"
+#include "LoopMonitor.h"
 #include "PianoLedConfig.h"
 
 void FastLedController::InitializeFastLed()
 {
-    size_t numStrips = PianoLedConfig::globalConfig.strips.size();
-    strips.resize(numStrips);
+    AllocateFrame();
     delay(1000); // power-up safety delay
-    for (size_t i = 0; i < numStrips; ++i)
+
+    // FastLED cannot remove controllers; detach the ones of a previous configuration from the old frame
+    for (int i = 0; i < FastLED.count(); ++i)
+    {
+        FastLED[i].setLeds(nullptr, 0);
+    }
+
+    for (size_t i = 0; i < stripCount; ++i)
     {
-        strips[i].resize(PianoLedConfig::globalConfig.strips[i].totalLeds);
-        switch (PianoLedConfig::globalConfig.strips[i].ledPin)
+        auto &strip = PianoLedConfig::globalConfig.strips[i];
+        FastLedRegistry::AddLedsFunction addLeds = FastLedRegistry::Find(strip);
+        if (!addLeds)
         {
-        case 2:
-            FastLED.addLeds<WS2812B, 2, GRB>(strips[i].data(), PianoLedConfig::globalConfig.strips[i].totalLeds);
-            break;
-        case 3:
-            FastLED.addLeds<WS2812B, 3, GRB>(strips[i].data(), PianoLedConfig::globalConfig.strips[i].totalLeds);
-            break;
-        case 4:
-            FastLED.addLeds<WS2812B, 4, GRB>(strips[i].data(), PianoLedConfig::globalConfig.strips[i].totalLeds);
-            break;
-        case 5:
-            FastLED.addLeds<WS2812B, 5, GRB>(strips[i].data(), PianoLedConfig::globalConfig.strips[i].totalLeds);
-            break;
-        case 6:
-            FastLED.addLeds<WS2812B, 6, GRB>(strips[i].data(), PianoLedConfig::globalConfig.strips[i].totalLeds);
+            Serial.printf("strip[%u]: LED type not supported on pin %d (clock pin %d)\n", (unsigned)i, strip.ledPin, strip.clockPin);
+            continue;
         }
+        if (strip.rgbw)
+        {
+            // FastLED has no RGBW output: send the G, R, B, W bytes as if they were RGB pixels
+            addLeds(reinterpret_cast<CRGB *>(RgbwOutputStrip(i)), RgbwCrgbCount(strip.totalLeds));
+            continue;
+        }
+        // the output buffer stores strips as consecutive CRGB arrays, so FastLED can read them in place
+        addLeds(reinterpret_cast<CRGB *>(OutputStrip(i)), strip.totalLeds);
     }
 }
 
@@ -38,6 +43,7 @@ void FastLedController::InitializeLeds()
         {
             ChangeIndividualLedColors({NeoPixelColor(stripNumber, i, PianoLedConfig::globalConfig.noteOffColor, PianoLedConfig::globalConfig.noteOffColorBrightness)});
             delay(10);
+            LoopMonitor::feedWatchdog(); // slow on purpose, not hung
         }
     }
 }
@@ -50,29 +56,16 @@ void FastLedController::ShutdownLeds()
         {
             ChangeIndividualLedColors({NeoPixelColor(stripNumber, i, LedColor(0, 0, 0), 0)});
             delay(10);
+            LoopMonitor::feedWatchdog(); // slow on purpose, not hung
         }
     }
 }
 
-void FastLedController::ChangeIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel)
-{
-    for (auto &color : colorsPerPixel)
-    {
-        CRGB ledColor(color.ledColor.r, color.ledColor.g, color.ledColor.b);
-        ledColor.nscale8_video(color.brightness);
-        strips[color.stripNumber][color.ledNumber] = ledColor;
-    }
-    FastLED.show();
-}
-
-void FastLedController::BulkChangeLedColors(int startLed, int endLed, int stripNumber, const LedColor &color, int brightness)
+void FastLedController::Flush()
 {
-    CRGB ledColor(color.r, color.g, color.b);
-    ledColor.nscale8_video(brightness);
-
-    for (int i = startLed; i < endLed; ++i)
-    {
-        strips[stripNumber][i] = ledColor;
-    }
-    FastLED.show();
+    RenderOutput();
+    // FastLED applies the brightness while clocking out, so power limiting costs nothing extra
+    const uint8_t brightness = OutputBrightness();
+    EventTrace::Scope trace(EventTrace::Id::Show, brightness);
+    FastLED.show(brightness);
 }
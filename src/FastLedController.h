@@ -1,12 +1,11 @@
 #ifndef FAST_LED_CONTROLLER_H
 #define FAST_LED_CONTROLLER_H
 
-#define FASTLED_ALLOW_INTERRUPTS 0 // Fixes LED flickering issues
-#include <FastLED.h>
+#include "FastLedRegistry.h"
 #include "PianoLedConfig.h"
-#include "LedController.h"
+#include "FrameBufferLedController.h"
 
-class FastLedController : public ILedController
+class FastLedController : public FrameBufferLedController
 {
 public:
     FastLedController()
@@ -16,12 +15,12 @@ public:
 
     void InitializeLeds() override;
     void ShutdownLeds() override;
-    void ChangeIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel) override;
-    void BulkChangeLedColors(int startLed, int endLed, int stripNumber, const LedColor &color, int brightness) override;
+
+protected:
+    void Flush() override;
 
 private:
-    std::vector<std::vector<CRGB>> strips;
     void InitializeFastLed();
 };
 
-#endif
\ No newline at end of file
+#endif
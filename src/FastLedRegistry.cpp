@@ -0,0 +1,94 @@
+#include "FastLedRegistry.h"
+#include <array>
+#include <utility>
+
+namespace
+{
+    constexpr uint8_t maxPin = 41;
+    constexpr uint32_t clockedDataRate = DATA_RATE_MHZ(12);
+
+    using PinTable = std::array<FastLedRegistry::AddLedsFunction, maxPin + 1>;
+
+    // 0/1 are Serial1 (ESP32 connection), 13 is LED_BUILTIN
+    using ClocklessPins = std::integer_sequence<uint8_t, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+                                                21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+                                                40, 41>;
+
+    template <template <uint8_t, EOrder> class Chipset, uint8_t Pin, EOrder Order>
+    CLEDController &AddClockless(CRGB *leds, int ledCount)
+    {
+        return FastLED.addLeds<Chipset, Pin, Order>(leds, ledCount);
+    }
+
+    template <ESPIChipsets Chipset, uint8_t DataPin, uint8_t ClockPin, EOrder Order>
+    CLEDController &AddClocked(CRGB *leds, int ledCount)
+    {
+        return FastLED.addLeds<Chipset, DataPin, ClockPin, Order, clockedDataRate>(leds, ledCount);
+    }
+
+    template <template <uint8_t, EOrder> class Chipset, EOrder Order, uint8_t... Pins>
+    constexpr PinTable MakePinTable(std::integer_sequence<uint8_t, Pins...>)
+    {
+        PinTable table{};
+        ((table[Pins] = &AddClockless<Chipset, Pins, Order>), ...);
+        return table;
+    }
+
+    struct ClockedEntry
+    {
+        uint8_t dataPin;
+        uint8_t clockPin;
+        FastLedRegistry::AddLedsFunction addLeds;
+    };
+
+    template <ESPIChipsets Chipset, EOrder Order>
+    constexpr std::array<ClockedEntry, 2> MakeClockedTable()
+    {
+        return {{{11, 13, &AddClocked<Chipset, 11, 13, Order>},
+                 {26, 27, &AddClocked<Chipset, 26, 27, Order>}}};
+    }
+
+    constexpr PinTable ws2812bTable = MakePinTable<WS2812B, GRB>(ClocklessPins{});
+    constexpr PinTable sk6812Table = MakePinTable<SK6812, GRB>(ClocklessPins{});
+    constexpr PinTable ws2811Table = MakePinTable<WS2811, RGB>(ClocklessPins{});
+    // RGBW data is already in wire order, so it must go out unswizzled
+    constexpr PinTable sk6812RgbwTable = MakePinTable<SK6812, RGB>(ClocklessPins{});
+    constexpr auto apa102Table = MakeClockedTable<APA102, BGR>();
+    constexpr auto sk9822Table = MakeClockedTable<SK9822, BGR>();
+
+    // indexed by PianoLedStrip::LedType
+    constexpr const PinTable *clocklessTables[] = {&ws2812bTable, &sk6812Table, &ws2811Table};
+    constexpr const std::array<ClockedEntry, 2> *clockedTables[] = {&apa102Table, &sk9822Table};
+    constexpr size_t firstClockedType = static_cast<size_t>(PianoLedStrip::LedType::APA102);
+    static_assert(static_cast<size_t>(PianoLedStrip::LedType::SK9822) == firstClockedType + 1, "clockedTables order");
+
+    FastLedRegistry::AddLedsFunction FindClocked(const std::array<ClockedEntry, 2> &table, int dataPin, int clockPin)
+    {
+        for (auto &entry : table)
+        {
+            if (entry.dataPin == dataPin && entry.clockPin == clockPin)
+                return entry.addLeds;
+        }
+        return nullptr;
+    }
+}
+
+FastLedRegistry::AddLedsFunction FastLedRegistry::Find(const PianoLedStrip &strip)
+{
+    size_t type = static_cast<size_t>(strip.ledType);
+    if (IsClocked(strip.ledType))
+    {
+        return FindClocked(*clockedTables[type - firstClockedType], strip.ledPin, strip.clockPin);
+    }
+
+    if (type >= firstClockedType || strip.ledPin < 0 || strip.ledPin > maxPin)
+        return nullptr;
+    if (strip.rgbw)
+        return strip.ledType == PianoLedStrip::LedType::SK6812 ? sk6812RgbwTable[strip.ledPin] : nullptr;
+    return (*clocklessTables[type])[strip.ledPin];
+}
+
+bool FastLedRegistry::IsClocked(PianoLedStrip::LedType ledType)
+{
+    return ledType == PianoLedStrip::LedType::APA102 || ledType == PianoLedStrip::LedType::SK9822;
+}
@@ -0,0 +1,34 @@
+#ifndef FAST_LED_REGISTRY_H
+#define FAST_LED_REGISTRY_H
+
+#define FASTLED_ALLOW_INTERRUPTS 0 // Fixes LED flickering issues
+#include <FastLED.h>
+#include "PianoLedStrip.h"
+
+/**
+ * FastLED only takes the chipset and the pins as template arguments. This registry instantiates
+ * FastLED.addLeds for every supported chipset on every usable Teensy 4.1 pin at compile time and looks the
+ * configured combination up in a table at runtime.
+ *
+ * Clockless chipsets (WS2812B, SK6812, WS2811) work on any digital pin except 0/1 (Serial1, used for the ESP32)
+ * and 13 (LED_BUILTIN); RGBW strips have to be SK6812. Clocked chipsets (APA102, SK9822) are available on the hardware SPI pin pairs
+ * 11/13 (SPI) and 26/27 (SPI1).
+ */
+class FastLedRegistry
+{
+public:
+    using AddLedsFunction = CLEDController &(*)(CRGB *leds, int ledCount);
+
+    /**
+     * The FastLED.addLeds instantiation for \p strip's ledType, ledPin, clockPin and rgbw, or nullptr if the
+     * combination is not supported.
+     */
+    static AddLedsFunction Find(const PianoLedStrip &strip);
+
+    /**
+     * True if \p ledType needs a clock pin.
+     */
+    static bool IsClocked(PianoLedStrip::LedType ledType);
+};
+
+#endif // FAST_LED_REGISTRY_H
@@ -0,0 +1,208 @@
+#include "FrameBufferLedController.h"
+#include "EventTrace.h"
+#include "MemoryMap.h"
+#include "PianoLedConfig.h"
+#include "PixelKernels.h"
+#include <algorithm>
+#include <cstring>
+
+// Rendered by the CPU on every change and read by FastLED while clocking out, so they are kept in DTCM
+static uint8_t frameMemory[FrameBufferLedController::maxFrameBytes];
+static uint8_t outputMemory[FrameBufferLedController::maxFrameBytes];
+static uint8_t rgbwOutputMemory[FrameBufferLedController::maxRgbwBytes];
+
+FrameBufferLedController::FrameBufferLedController()
+    : frame(frameMemory), output(outputMemory), stripCount(0), ledsPerStrip(0), rgbwStripCount(0),
+      rgbwOutput(rgbwOutputMemory), ditheringEnabled(false), ditherFrame(0)
+{
+    rgbwStripIndex.fill(-1);
+}
+
+void FrameBufferLedController::AllocateFrame()
+{
+    // the configuration parser keeps strips and LEDs within the static buffers
+    stripCount = std::min(PianoLedConfig::globalConfig.strips.size(), static_cast<size_t>(PianoLedConfig::maxStrips));
+    ledsPerStrip = 0;
+    for (size_t i = 0; i < stripCount; ++i)
+    {
+        ledsPerStrip = std::max(ledsPerStrip, static_cast<size_t>(PianoLedConfig::globalConfig.strips[i].totalLeds));
+    }
+    ledsPerStrip = std::min(ledsPerStrip, static_cast<size_t>(PianoLedConfig::maxLedsPerStrip));
+    memset(frame, 0, FrameBytes());
+    memset(output, 0, FrameBytes());
+
+    rgbwStripCount = 0;
+    rgbwStripIndex.fill(-1);
+    size_t rgbwBytes = 0;
+    for (size_t i = 0; i < stripCount; ++i)
+    {
+        auto &strip = PianoLedConfig::globalConfig.strips[i];
+        if (strip.rgbw)
+        {
+            size_t ledCount = std::min(static_cast<size_t>(strip.totalLeds), ledsPerStrip);
+            rgbwStripIndex[i] = rgbwStripCount;
+            rgbwStrips[rgbwStripCount++] = {rgbwBytes, ledCount, RgbwConverter()};
+            rgbwBytes += RgbwCrgbCount(ledCount) * 3;
+        }
+    }
+    memset(rgbwOutput, 0, rgbwBytes);
+
+    MemoryMap::Record("LED frame", frame, maxFrameBytes, FrameBytes());
+    MemoryMap::Record("LED output", output, maxFrameBytes, FrameBytes());
+    MemoryMap::Record("LED RGBW output", rgbwOutput, maxRgbwBytes, rgbwBytes);
+
+    std::vector<int> leds;
+    for (auto &strip : PianoLedConfig::globalConfig.strips)
+    {
+        leds.push_back(strip.totalLeds);
+    }
+    powerLimiter.Reset(leds);
+    ConfigurePowerBudgets();
+    ConfigureColorCorrection();
+}
+
+void FrameBufferLedController::ConfigurePowerBudgets()
+{
+    std::vector<int> budgets;
+    for (auto &strip : PianoLedConfig::globalConfig.strips)
+    {
+        budgets.push_back(strip.maxMilliamps);
+    }
+    powerLimiter.SetBudgets(budgets, PianoLedConfig::globalConfig.powerBudgetMilliamps);
+}
+
+void FrameBufferLedController::ConfigureColorCorrection()
+{
+    ditheringEnabled = false;
+    for (size_t i = 0; i < stripCount; ++i)
+    {
+        auto &strip = PianoLedConfig::globalConfig.strips[i];
+        if (strip.colorCorrection)
+        {
+            stripCorrections[i] = {&ColorCorrection::ForLedType(strip.ledType), strip.temporalDithering};
+            ditheringEnabled = ditheringEnabled || strip.temporalDithering;
+        }
+        else
+        {
+            stripCorrections[i] = {&ColorCorrection::Identity(), false};
+        }
+    }
+    MemoryMap::Record("color correction LUTs", &ColorCorrection::Identity(), ColorCorrection::tableBytes, ColorCorrection::tableBytes);
+
+    for (size_t i = 0; i < stripCount && i < PianoLedConfig::globalConfig.strips.size(); ++i)
+    {
+        if (rgbwStripIndex[i] >= 0)
+            rgbwStrips[rgbwStripIndex[i]].converter.SetWhiteLedColor(PianoLedConfig::globalConfig.strips[i].whiteLedColor);
+    }
+}
+
+const uint8_t *FrameBufferLedController::RenderOutput()
+{
+    EventTrace::Scope trace(EventTrace::Id::FrameCommit, FrameBytes());
+    // bit-reversing the frame counter spreads consecutive dither thresholds over the whole range
+    uint8_t phase = ditherFrame++;
+    phase = (phase & 0xF0) >> 4 | (phase & 0x0F) << 4;
+    phase = (phase & 0xCC) >> 2 | (phase & 0x33) << 2;
+    phase = (phase & 0xAA) >> 1 | (phase & 0x55) << 1;
+
+    for (size_t stripNumber = 0; stripNumber < stripCount; ++stripNumber)
+    {
+        const StripCorrection &correction = stripCorrections[stripNumber];
+        ColorCorrection::Apply(*correction.tables, Strip(stripNumber), OutputStrip(stripNumber), ledsPerStrip,
+                               correction.dither, phase);
+        if (rgbwStripIndex[stripNumber] >= 0)
+        {
+            const RgbwStrip &rgbw = rgbwStrips[rgbwStripIndex[stripNumber]];
+            rgbw.converter.Convert(OutputStrip(stripNumber), rgbwOutput + rgbw.offset, rgbw.ledCount);
+        }
+    }
+    return output;
+}
+
+void FrameBufferLedController::InitializeLeds()
+{
+    FillAll(PianoLedConfig::globalConfig.noteOffColor, PianoLedConfig::globalConfig.noteOffColorBrightness);
+}
+
+void FrameBufferLedController::ShutdownLeds()
+{
+    FillAll(LedColor(0, 0, 0), 0);
+}
+
+void FrameBufferLedController::ChangeIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel)
+{
+    StageIndividualLedColors(colorsPerPixel);
+    Flush();
+}
+
+void FrameBufferLedController::StageIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel)
+{
+    for (auto &color : colorsPerPixel)
+    {
+        WriteRun(color.stripNumber, color.ledNumber, color.ledCount, color.ledColor, color.brightness);
+    }
+}
+
+void FrameBufferLedController::BulkChangeLedColors(int startLed, int endLed, int stripNumber, const LedColor &color, int brightness)
+{
+    WriteRun(stripNumber, startLed, endLed - startLed, color, brightness);
+    Flush();
+}
+
+void FrameBufferLedController::FillAll(const LedColor &color, int brightness)
+{
+    for (size_t stripNumber = 0; stripNumber < stripCount; ++stripNumber)
+    {
+        WriteRun(stripNumber, 0, PianoLedConfig::globalConfig.strips[stripNumber].totalLeds, color, brightness);
+    }
+    Flush();
+}
+
+void FrameBufferLedController::WriteRun(int stripNumber, int startLed, int ledCount, const LedColor &color, int brightness)
+{
+    uint8_t *start = Pixel(stripNumber, startLed);
+    if (!start || ledCount <= 0)
+        return;
+
+    uint8_t rgb[3] = {static_cast<uint8_t>(color.r), static_cast<uint8_t>(color.g), static_cast<uint8_t>(color.b)};
+    PixelKernels::ScaleVideo(rgb, 3, brightness);
+    size_t count = std::min(static_cast<size_t>(startLed + ledCount), ledsPerStrip) - startLed;
+
+    // keep the running current estimate up to date with just the pixels that are overwritten
+    uint32_t oldSum = PowerLimiter::ChannelSum(start, count * 3);
+    PixelKernels::Fill(start, count, rgb[0], rgb[1], rgb[2]);
+    powerLimiter.PixelsChanged(stripNumber, oldSum, count * (rgb[0] + rgb[1] + rgb[2]));
+}
+
+uint8_t *FrameBufferLedController::Strip(int stripNumber)
+{
+    return Pixel(stripNumber, 0);
+}
+
+uint8_t *FrameBufferLedController::Pixel(int stripNumber, int ledNumber)
+{
+    if (stripNumber < 0 || static_cast<size_t>(stripNumber) >= stripCount ||
+        ledNumber < 0 || static_cast<size_t>(ledNumber) >= ledsPerStrip)
+    {
+        return nullptr;
+    }
+    return frame + (stripNumber * ledsPerStrip + ledNumber) * 3;
+}
+
+uint8_t *FrameBufferLedController::OutputStrip(int stripNumber)
+{
+    if (stripNumber < 0 || static_cast<size_t>(stripNumber) >= stripCount)
+    {
+        return nullptr;
+    }
+    return output + stripNumber * ledsPerStrip * 3;
+}
+
+uint8_t *FrameBufferLedController::RgbwOutputStrip(int stripNumber)
+{
+    if (stripNumber < 0 || static_cast<size_t>(stripNumber) >= stripCount || rgbwStripIndex[stripNumber] < 0)
+    {
+        return nullptr;
+    }
+    return rgbwOutput + rgbwStrips[rgbwStripIndex[stripNumber]].offset;
+}
@@ -0,0 +1,145 @@
+#ifndef FRAME_BUFFER_LED_CONTROLLER_H
+#define FRAME_BUFFER_LED_CONTROLLER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "ColorCorrection.h"
+#include "LedController.h"
+#include "PianoLedConfig.h"
+#include "PowerLimiter.h"
+#include "RgbwConverter.h"
+
+/**
+ * Common base of the LED controllers: keeps one contiguous RGB frame for all strips and implements the
+ * \ref ILedController drawing operations on it. Derived classes only decide how a finished frame gets out,
+ * by implementing \ref Flush.
+ *
+ * Strips are laid out one after another, each occupying \ref LedsPerStrip pixels of 3 bytes, which is the memory
+ * layout of a FastLED CRGB array. The output buffer has the same layout and holds the frame after the per strip color
+ * correction, see \ref RenderOutput. RGBW strips additionally get a 4-byte per pixel buffer, filled from the output
+ * buffer by white extraction.
+ *
+ * The buffers are statically sized for PianoLedConfig::maxStrips strips of PianoLedConfig::maxLedsPerStrip LEDs and
+ * placed in DTCM (see MemoryMap.h), so they are shared by all controller instances: only one may be in use at a time.
+ */
+class FrameBufferLedController : public ILedController
+{
+public:
+    static constexpr size_t maxFrameBytes = PianoLedConfig::maxStrips * PianoLedConfig::maxLedsPerStrip * 3;
+    static constexpr size_t maxRgbwBytes = PianoLedConfig::maxStrips * ((PianoLedConfig::maxLedsPerStrip * 4 + 2) / 3) * 3;
+
+    void InitializeLeds() override;
+    void ShutdownLeds() override;
+    void ChangeIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel) override;
+    void BulkChangeLedColors(int startLed, int endLed, int stripNumber, const LedColor &color, int brightness) override;
+
+    /**
+     * Draws like \ref ChangeIndividualLedColors, but leaves the output to \ref Commit, so that the changes of several
+     * note events go out as one frame.
+     */
+    void StageIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel);
+
+    /**
+     * Outputs the changes drawn by \ref StageIndividualLedColors.
+     */
+    void Commit() { Flush(); }
+
+    size_t StripCount() const { return stripCount; }
+    size_t LedsPerStrip() const { return ledsPerStrip; }
+    const uint8_t *FrameData() const { return frame; }
+    size_t FrameBytes() const { return stripCount * ledsPerStrip * 3; }
+    const PowerLimiter &Power() const { return powerLimiter; }
+
+    /**
+     * Applies the current budgets from PianoLedConfig::globalConfig to the power limiter.
+     */
+    void ConfigurePowerBudgets();
+
+    /**
+     * Applies the color correction settings of the strips in PianoLedConfig::globalConfig.
+     */
+    void ConfigureColorCorrection();
+
+    /**
+     * True if any strip is temporally dithered and therefore needs \ref RefreshOutput to be called continuously.
+     */
+    bool DitheringEnabled() const { return ditheringEnabled; }
+
+    /**
+     * Outputs the current frame again, with the next dither phase.
+     */
+    void RefreshOutput() { Flush(); }
+
+protected:
+    FrameBufferLedController();
+
+    /**
+     * (Re-)allocates the frame for the strips in PianoLedConfig::globalConfig. All pixels start out black.
+     */
+    void AllocateFrame();
+
+    /**
+     * Outputs the current frame. Called after every drawing operation.
+     * Implementations must output the buffer returned by RenderOutput() and apply OutputBrightness() to it.
+     */
+    virtual void Flush() = 0;
+
+    /**
+     * Global brightness scale for the frame about to be output, as decided by the power limiter.
+     */
+    uint8_t OutputBrightness() { return powerLimiter.BeginFrame(); }
+
+    /**
+     * Runs the color correction of every strip from the frame into the output buffer, followed by the white
+     * extraction of RGBW strips, and returns the output buffer.
+     */
+    const uint8_t *RenderOutput();
+
+    /**
+     * The 4-byte per pixel (G, R, B, W) buffer of an RGBW strip, or nullptr for RGB strips.
+     * It is padded to a multiple of 3 bytes, so it can be sent as \ref RgbwCrgbCount CRGB pixels.
+     */
+    uint8_t *RgbwOutputStrip(int stripNumber);
+
+    /**
+     * Number of 3-byte pixels the RGBW data of \p ledCount LEDs takes up.
+     */
+    static size_t RgbwCrgbCount(size_t ledCount) { return (ledCount * 4 + 2) / 3; }
+
+    void FillAll(const LedColor &color, int brightness);
+    void WriteRun(int stripNumber, int startLed, int ledCount, const LedColor &color, int brightness);
+    uint8_t *Strip(int stripNumber);
+    uint8_t *Pixel(int stripNumber, int ledNumber);
+    uint8_t *OutputStrip(int stripNumber);
+
+    uint8_t *frame;
+    uint8_t *output;
+    size_t stripCount;
+    size_t ledsPerStrip;
+    PowerLimiter powerLimiter;
+
+private:
+    struct StripCorrection
+    {
+        const ColorCorrection::Tables *tables;
+        bool dither;
+    };
+
+    struct RgbwStrip
+    {
+        size_t offset; // into rgbwOutput
+        size_t ledCount;
+        RgbwConverter converter;
+    };
+
+    std::array<StripCorrection, PianoLedConfig::maxStrips> stripCorrections;
+    std::array<RgbwStrip, PianoLedConfig::maxStrips> rgbwStrips;
+    size_t rgbwStripCount;
+    std::array<int8_t, PianoLedConfig::maxStrips> rgbwStripIndex; // per strip, -1 for RGB strips
+    uint8_t *rgbwOutput;
+    bool ditheringEnabled;
+    uint8_t ditherFrame;
+};
+
+#endif // FRAME_BUFFER_LED_CONTROLLER_H
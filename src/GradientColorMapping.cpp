@@ -1,11 +1,127 @@
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 
 #include "GradientColorMapping.h"
 #include "LedColor.h"
 #include <sstream>
 #include <iomanip>
 
-LedColor GradientColorMapping::Map(int number, double upperBound, std::function<double(double)> func, const std::vector<LedColor>& colors) {
+namespace {
+    struct Triple {
+        double a, b, c;
+    };
+
+    int ToChannel(double value) {
+        return static_cast<int>(std::lround(std::max(0.0, std::min(1.0, value)) * 255));
+    }
+
+    Triple ToHsv(const LedColor& color) {
+        double r = color.r / 255.0, g = color.g / 255.0, b = color.b / 255.0;
+        double max = std::max({r, g, b});
+        double delta = max - std::min({r, g, b});
+        double h = 0;
+        if (delta > 0) {
+            if (max == r)
+                h = std::fmod((g - b) / delta + 6, 6);
+            else if (max == g)
+                h = (b - r) / delta + 2;
+            else
+                h = (r - g) / delta + 4;
+        }
+        return {h / 6, max > 0 ? delta / max : 0, max}; // hue in turns
+    }
+
+    LedColor FromHsv(const Triple& hsv) {
+        double h = (hsv.a - std::floor(hsv.a)) * 6;
+        double c = hsv.c * hsv.b;
+        double x = c * (1 - std::fabs(std::fmod(h, 2) - 1));
+        double m = hsv.c - c;
+        double r = 0, g = 0, b = 0;
+        switch (static_cast<int>(h) % 6) {
+        case 0: r = c; g = x; break;
+        case 1: r = x; g = c; break;
+        case 2: g = c; b = x; break;
+        case 3: g = x; b = c; break;
+        case 4: r = x; b = c; break;
+        default: r = c; b = x; break;
+        }
+        return LedColor(ToChannel(r + m), ToChannel(g + m), ToChannel(b + m));
+    }
+
+    double SrgbToLinear(int channel) {
+        double c = channel / 255.0;
+        return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+    }
+
+    double LinearToSrgb(double c) {
+        return c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1 / 2.4) - 0.055;
+    }
+
+    // https://bottosson.github.io/posts/oklab/
+    Triple ToOkLab(const LedColor& color) {
+        double r = SrgbToLinear(color.r), g = SrgbToLinear(color.g), b = SrgbToLinear(color.b);
+        double l = std::cbrt(0.4122214708 * r + 0.5363325363 * g + 0.0514459929 * b);
+        double m = std::cbrt(0.2119034982 * r + 0.6806995451 * g + 0.1073969566 * b);
+        double s = std::cbrt(0.0883024619 * r + 0.2817188376 * g + 0.6299787005 * b);
+        return {0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s,
+                1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s,
+                0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s};
+    }
+
+    LedColor FromOkLab(const Triple& lab) {
+        double l = lab.a + 0.3963377774 * lab.b + 0.2158037573 * lab.c;
+        double m = lab.a - 0.1055613458 * lab.b - 0.0638541728 * lab.c;
+        double s = lab.a - 0.0894841775 * lab.b - 1.2914855480 * lab.c;
+        l = l * l * l;
+        m = m * m * m;
+        s = s * s * s;
+        return LedColor(ToChannel(LinearToSrgb(4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s)),
+                        ToChannel(LinearToSrgb(-1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s)),
+                        ToChannel(LinearToSrgb(-0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s)));
+    }
+
+    double Lerp(double a, double b, double t) {
+        return a + (b - a) * t;
+    }
+}
+
+LedColor GradientColorMapping::Interpolate(const LedColor& start, const LedColor& end, double t, Interpolation interpolation) {
+    switch (interpolation) {
+    case Interpolation::HsvShortHue:
+    case Interpolation::HsvLongHue: {
+        Triple a = ToHsv(start);
+        Triple b = ToHsv(end);
+        // grays have no hue of their own: keep the hue of the other color so the gradient only fades saturation
+        if (a.b == 0)
+            a.a = b.a;
+        if (b.b == 0)
+            b.a = a.a;
+        double hueDelta = b.a - a.a;
+        bool isShort = std::fabs(hueDelta) <= 0.5;
+        if (hueDelta != 0 && isShort != (interpolation == Interpolation::HsvShortHue))
+            hueDelta += hueDelta > 0 ? -1 : 1;
+        return FromHsv({a.a + hueDelta * t, Lerp(a.b, b.b, t), Lerp(a.c, b.c, t)});
+    }
+    case Interpolation::OkLab: {
+        Triple a = ToOkLab(start);
+        Triple b = ToOkLab(end);
+        return FromOkLab({Lerp(a.a, b.a, t), Lerp(a.b, b.b, t), Lerp(a.c, b.c, t)});
+    }
+    case Interpolation::Rgb:
+    default:
+        return LedColor(static_cast<int>(std::lround(Lerp(start.r, end.r, t))),
+                        static_cast<int>(std::lround(Lerp(start.g, end.g, t))),
+                        static_cast<int>(std::lround(Lerp(start.b, end.b, t))));
+    }
+}
+
+LedColor GradientColorMapping::Map(int number, double upperBound, std::function<double(double)> func, const std::vector<LedColor>& colors,
+                                   Interpolation interpolation) {
+    if (colors.empty()) {
+        return LedColor::Black;
+    }
+
     double normalized = (number - 1) / (upperBound - 1);  // Normalize input to range 0-1
     double transformed = func(normalized);  // Apply custom mathematical function
 
@@ -27,9 +143,5 @@ LedColor GradientColorMapping::Map(int number, double upperBound, std::function<
     const LedColor& end = colors[index + 1];
 
     // Interpolate between the two colors
-    int r = static_cast<int>(start.r + (end.r - start.r) * localT);
-    int g = static_cast<int>(start.g + (end.g - start.g) * localT);
-    int b = static_cast<int>(start.b + (end.b - start.b) * localT);
-    LedColor ledColor(r, g, b);
-    return ledColor;
+    return Interpolate(start, end, localT, interpolation);
 }
@@ -9,6 +9,30 @@
 
 class GradientColorMapping {
 public:
+    /**
+     * @enum Interpolation
+     * @brief The color space gradients between two palette colors are interpolated in.
+     */
+    enum class Interpolation
+    {
+        /**
+         * Straight lines between the RGB values. A blue to red gradient passes through dark purple.
+         */
+        Rgb,
+        /**
+         * Hue, saturation and value, taking the shorter way around the hue circle.
+         */
+        HsvShortHue,
+        /**
+         * Hue, saturation and value, taking the longer way around the hue circle (e.g. blue to red via green and yellow).
+         */
+        HsvLongHue,
+        /**
+         * The perceptual OKLab color space: brightness and saturation stay even across the gradient.
+         */
+        OkLab
+    };
+
     static double Linear(double x) { return x; }
     static double Quadratic(double x) { return x * x; }
     static double SquareRoot(double x) { return std::sqrt(x); }
@@ -17,7 +41,18 @@ public:
     static double Exponential(double x) { return std::pow(2, x) - 1; }
     static double HardTransition(double x, double y) { return (x < y) ? 0 : 1; }
 
-    static LedColor Map(int number, double upperBound, std::function<double(double)> func, const std::vector<LedColor>& colors);
+    /**
+     * Maps \p number in [1, upperBound] through \p func onto the gradient between \p colors.
+     * This does the color space conversions in double precision, so it is meant for building color tables,
+     * not for the per note event path.
+     */
+    static LedColor Map(int number, double upperBound, std::function<double(double)> func, const std::vector<LedColor>& colors,
+                        Interpolation interpolation = Interpolation::Rgb);
+
+    /**
+     * Color at \p t in [0, 1] between \p start and \p end.
+     */
+    static LedColor Interpolate(const LedColor& start, const LedColor& end, double t, Interpolation interpolation);
 };
 
 #endif
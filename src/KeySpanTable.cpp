@@ -0,0 +1,121 @@
+#include "KeySpanTable.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // index of each pitch class among the 7 white keys of an octave; black keys share the index of the white key left of them
+    const int whiteKeyIndex[12] = {0, 0, 1, 1, 2, 3, 3, 4, 4, 5, 5, 6};
+    const bool blackKey[12] = {false, true, false, true, false, false, true, false, true, false, true, false};
+}
+
+KeySpanTable::Table KeySpanTable::Build(PianoLedStrip::KeySpanMode mode, double ledsPerSemitone, int logicalLeds, int lowestKeyMidi,
+                                        const std::vector<KeySpan> &calibration)
+{
+    switch (mode)
+    {
+    case PianoLedStrip::KeySpanMode::SingleLed:
+        return SingleLed(ledsPerSemitone, logicalLeds, lowestKeyMidi);
+    case PianoLedStrip::KeySpanMode::Calibrated:
+    {
+        Table table = KeyGeometry(ledsPerSemitone, logicalLeds, lowestKeyMidi);
+        for (size_t note = 0; note < calibration.size() && note < noteCount; ++note)
+        {
+            const KeySpan &span = calibration[note];
+            if (span.ledCount > 0 && span.startLed < logicalLeds)
+            {
+                table[note].startLed = span.startLed;
+                table[note].ledCount = std::min<int>(span.ledCount, logicalLeds - span.startLed);
+            }
+        }
+        return table;
+    }
+    case PianoLedStrip::KeySpanMode::KeyGeometry:
+    default:
+        return KeyGeometry(ledsPerSemitone, logicalLeds, lowestKeyMidi);
+    }
+}
+
+KeySpanTable::Table KeySpanTable::SingleLed(double ledsPerSemitone, int logicalLeds, int lowestKeyMidi)
+{
+    Table table{};
+    for (int note = std::max(lowestKeyMidi, 0); note < noteCount; ++note)
+    {
+        int led = static_cast<int>(std::round((note - lowestKeyMidi) * ledsPerSemitone));
+        if (led < logicalLeds)
+        {
+            table[note] = {static_cast<uint16_t>(led), 1};
+        }
+    }
+    return table;
+}
+
+KeySpanTable::Table KeySpanTable::KeyGeometry(double ledsPerSemitone, int logicalLeds, int lowestKeyMidi)
+{
+    Table table{};
+    if (lowestKeyMidi < 0 || lowestKeyMidi >= noteCount || ledsPerSemitone <= 0)
+        return table;
+
+    // An octave is 12 semitones wide and 7 white keys wide
+    const double ledsPerWhiteKey = ledsPerSemitone * 12.0 / 7.0;
+    const double lowestKeyLeft = IsBlackKey(lowestKeyMidi)
+                                     ? WhiteKeyPosition(lowestKeyMidi) + 1.0 - blackKeyWidthRatio / 2
+                                     : WhiteKeyPosition(lowestKeyMidi);
+    const double lowestKeyWidth = IsBlackKey(lowestKeyMidi) ? blackKeyWidthRatio : 1.0;
+    // LED 0 sits above the middle of the lowest key, like in SingleLed mode
+    const double origin = lowestKeyLeft + lowestKeyWidth / 2;
+
+    // Assign every LED to the key below it. At the back of the keyboard, where the strip is mounted, a black key
+    // covers the edges of its white neighbours, so every position belongs to exactly one key.
+    for (int led = 0; led < logicalLeds; ++led)
+    {
+        int note = NoteAtPosition(origin + led / ledsPerWhiteKey);
+        if (note < lowestKeyMidi || note >= noteCount)
+            continue;
+        KeySpan &span = table[note];
+        if (span.ledCount == 0)
+            span.startLed = led;
+        span.ledCount = led - span.startLed + 1;
+    }
+
+    // Keys narrower than the LED spacing may not own any LED; give them the one closest to their center
+    for (int note = lowestKeyMidi; note < noteCount; ++note)
+    {
+        if (table[note].ledCount > 0)
+            continue;
+        double center = IsBlackKey(note) ? WhiteKeyPosition(note) + 1.0 : WhiteKeyPosition(note) + 0.5;
+        int led = static_cast<int>(std::round((center - origin) * ledsPerWhiteKey));
+        if (led >= 0 && led < logicalLeds)
+            table[note] = {static_cast<uint16_t>(led), 1};
+    }
+    return table;
+}
+
+bool KeySpanTable::IsBlackKey(int midiNote)
+{
+    return blackKey[midiNote % 12];
+}
+
+double KeySpanTable::WhiteKeyPosition(int midiNote)
+{
+    return (midiNote / 12) * 7 + whiteKeyIndex[midiNote % 12];
+}
+
+int KeySpanTable::NoteAtPosition(double whiteKeyPosition)
+{
+    if (whiteKeyPosition < 0)
+        return -1;
+
+    int whiteKey = static_cast<int>(std::floor(whiteKeyPosition));
+    double withinKey = whiteKeyPosition - whiteKey;
+    int octave = whiteKey / 7;
+    static const int whiteKeyNote[7] = {0, 2, 4, 5, 7, 9, 11};
+    int note = octave * 12 + whiteKeyNote[whiteKey % 7];
+
+    // black keys are centered on the boundary between two white keys
+    if (withinKey >= 1.0 - blackKeyWidthRatio / 2 && note + 1 < 128 && IsBlackKey(note + 1))
+        return note + 1;
+    if (withinKey < blackKeyWidthRatio / 2 && note > 0 && IsBlackKey(note - 1))
+        return note - 1;
+    return note;
+}
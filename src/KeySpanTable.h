@@ -0,0 +1,39 @@
+#ifndef KEY_SPAN_TABLE_H
+#define KEY_SPAN_TABLE_H
+
+#include <array>
+#include <vector>
+#include "PianoLedStrip.h"
+
+/**
+ * Generates the LED span of every MIDI note, in logical LED positions from 0 to logicalLeds - 1.
+ * Notes that fall outside the LEDs get a ledCount of 0.
+ */
+class KeySpanTable
+{
+public:
+    static const int noteCount = 128;
+    using Table = std::array<KeySpan, noteCount>;
+
+    /**
+     * Width of a black key relative to a white key (13.7 mm vs. 23.5 mm on a standard keyboard).
+     */
+    static constexpr double blackKeyWidthRatio = 13.7 / 23.5;
+
+    /**
+     * @param ledsPerSemitone the strip's stripToPianoLengthScale.
+     * @param lowestKeyMidi MIDI note number of the key above logical LED 0.
+     */
+    static Table Build(PianoLedStrip::KeySpanMode mode, double ledsPerSemitone, int logicalLeds, int lowestKeyMidi,
+                       const std::vector<KeySpan> &calibration);
+
+private:
+    static Table SingleLed(double ledsPerSemitone, int logicalLeds, int lowestKeyMidi);
+    static Table KeyGeometry(double ledsPerSemitone, int logicalLeds, int lowestKeyMidi);
+
+    static bool IsBlackKey(int midiNote);
+    static double WhiteKeyPosition(int midiNote);
+    static int NoteAtPosition(double whiteKeyPosition);
+};
+
+#endif // KEY_SPAN_TABLE_H
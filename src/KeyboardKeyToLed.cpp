@@ -1,118 +1,263 @@
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 #include "KeyboardKeyToLed.h"
+#include "EventTrace.h"
+#include "KeySpanTable.h"
+#include "MemoryMap.h"
 #include "NoteEvent.h"
+#include <algorithm>
 #include <functional>
 
-std::vector<NeoPixelColor> KeyboardKeyToLed::HandleNoteOn(uint8_t note, uint8_t velocity)
+void KeyboardKeyToLed::RebuildKeyMap()
 {
-    std::vector<NeoPixelColor> neoPixelColors;
+    lowestKeyOffset = PianoLedConfig::NoteToMidi(PianoLedConfig::globalConfig.lowestKey);
 
-    NoteEvent noteEvent(note, velocity, NoteEvent::MidiCommandCode::NoteOn);
-    for (auto &strip : PianoLedConfig::globalConfig.strips)
+    // Either one keyboard spanning the configured segments, or one keyboard per strip
+    auto &strips = PianoLedConfig::globalConfig.strips;
+    auto &segments = PianoLedConfig::globalConfig.topology;
+    std::vector<LedTopology> topologies;
+    std::vector<const PianoLedStrip *> spanSources;
+    if (!segments.empty())
     {
-        NeoPixelColor neoPixelColor = Handle(noteEvent, strip);
-
-        strip.litLedsTable[neoPixelColor]++;
-
-        if (strip.litLedsTable[neoPixelColor] > 1)
+        int first = segments.front().stripNumber;
+        if (first >= 0 && first < (int)strips.size())
         {
-            continue;
+            topologies.emplace_back(segments);
+            spanSources.push_back(&strips[first]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < strips.size(); ++i)
+        {
+            topologies.emplace_back(LedTopology::FromOrientation(i, strips[i]));
+            spanSources.push_back(&strips[i]);
         }
-
-        neoPixelColors.push_back(neoPixelColor);
     }
 
-    return neoPixelColors;
-}
-
-std::vector<NeoPixelColor> KeyboardKeyToLed::HandleNoteOff(uint8_t note, uint8_t velocity)
-{
-    std::vector<NeoPixelColor> neoPixelColors;
-
-    NoteEvent noteEvent(note, velocity, NoteEvent::MidiCommandCode::NoteOff);
-    for (auto &strip : PianoLedConfig::globalConfig.strips)
+    std::vector<KeySpanTable::Table> tables;
+    for (size_t k = 0; k < topologies.size(); ++k)
     {
-        NeoPixelColor neoPixelColor = Handle(noteEvent, strip);
+        const PianoLedStrip &source = *spanSources[k];
+        tables.push_back(KeySpanTable::Build(source.keySpanMode, source.stripToPianoLengthScale, topologies[k].LogicalLeds(),
+                                             lowestKeyOffset, source.keySpanCalibration));
+    }
 
-        if (strip.litLedsTable[neoPixelColor] == 0)
+    runCount = 0;
+    for (int note = 0; note < KeySpanTable::noteCount; ++note)
+    {
+        noteRuns[note] = runCount;
+        for (size_t k = 0; k < topologies.size(); ++k)
         {
-            continue; // No LEDs lit for this color
+            AddRuns(topologies[k], tables[k][note]);
         }
+    }
+    noteRuns[KeySpanTable::noteCount] = runCount;
 
-        strip.litLedsTable[neoPixelColor]--;
-
-        if (strip.litLedsTable[neoPixelColor] > 0)
+    // A run emits at most one changed LED range per two LEDs (held neighbours split it), so this is enough for any note
+    size_t maxChangedLeds = 0;
+    for (int note = 0; note < KeySpanTable::noteCount; ++note)
+    {
+        size_t changed = 0;
+        for (uint16_t r = noteRuns[note]; r < noteRuns[note + 1]; ++r)
         {
-            continue;
+            changed += (runs[r].ledCount + 1) / 2;
         }
+        maxChangedLeds = std::max(maxChangedLeds, changed);
+    }
+    maxChangedLeds = std::max(maxChangedLeds, static_cast<size_t>(repaintChunkLeds + 1) / 2);
+    changedLeds.clear();
+    changedLeds.reserve(maxChangedLeds);
+    MemoryMap::Record("key map runs", runs.data(), sizeof(runs), runCount * sizeof(LedRun));
+    MemoryMap::Record("lit LED counts", litLedCounts.data(), sizeof(litLedCounts), sizeof(litLedCounts));
+    MemoryMap::Record("changed LED buffer", changedLeds.data(), changedLeds.capacity() * sizeof(NeoPixelColor),
+                      changedLeds.capacity() * sizeof(NeoPixelColor));
+
+    // The gradients (color curve and color space conversions) are only evaluated here, not per note event
+    lowestMappedNote = 0;
+    highestMappedNote = KeySpanTable::noteCount - 1;
+    while (lowestMappedNote < highestMappedNote && noteRuns[lowestMappedNote] == noteRuns[lowestMappedNote + 1])
+        ++lowestMappedNote;
+    while (highestMappedNote > lowestMappedNote && noteRuns[highestMappedNote] == noteRuns[highestMappedNote + 1])
+        --highestMappedNote;
+    colorTable.Build(PianoLedConfig::globalConfig, lowestMappedNote, highestMappedNote);
 
-        neoPixelColors.push_back(neoPixelColor);
+    sourceStrips.fill(0xFF);
+    auto &routes = PianoLedConfig::globalConfig.sourceRoutes;
+    for (size_t source = 0; source < routes.size() && source < sourceStrips.size(); ++source)
+    {
+        if (routes[source].strips.empty())
+            continue;
+        sourceStrips[source] = 0;
+        for (uint8_t strip : routes[source].strips)
+            sourceStrips[source] |= strip < 8 ? 1 << strip : 0;
     }
+    MemoryMap::Record("note color table", &colorTable, sizeof(colorTable), sizeof(colorTable));
 
-    return neoPixelColors;
+    ResetLitLeds();
 }
 
-NeoPixelColor KeyboardKeyToLed::Handle(const NoteEvent &noteEvent, PianoLedStrip &strip)
+void KeyboardKeyToLed::ResetLitLeds()
 {
-    int led = static_cast<int>(std::round((noteEvent.noteNumber - lowestKeyOffset) * strip.stripToPianoLengthScale));
-    int finalLed = led;
-
-    switch (strip.stripOrientation)
+    for (auto &counts : litLedCounts)
     {
-    case PianoLedStrip::StripOrientation::LeftToRight:
-    {
-        break;
+        counts.fill(0);
     }
-    case PianoLedStrip::StripOrientation::RightToLeft:
+    guidedNotes.fill(false);
+}
+
+void KeyboardKeyToLed::AddRuns(const LedTopology &topology, const KeySpan &span)
+{
+    auto &strips = PianoLedConfig::globalConfig.strips;
+
+    // Depending on the topology, logically consecutive LEDs need not be physically consecutive
+    std::vector<std::pair<int, int>> physical; // strip, physical LED
+    for (int logical = span.startLed; logical < span.startLed + span.ledCount; ++logical)
     {
-        finalLed = strip.totalLeds - led - 1;
-        break;
+        LedTopology::PhysicalLed led = topology.Map(logical);
+        if (led.stripNumber < strips.size() && led.ledNumber < strips[led.stripNumber].totalLeds)
+            physical.push_back({led.stripNumber, led.ledNumber});
     }
-    case PianoLedStrip::StripOrientation::StackedLeftToRight:
+    std::sort(physical.begin(), physical.end());
+
+    for (size_t i = 0; i < physical.size(); ++i)
     {
-        int topOrBottomStackLtr = led % 2;
-        if (topOrBottomStackLtr == 0)
-        {
-            finalLed = led / 2;
-        }
-        else
+        if (i > 0 && physical[i].first == physical[i - 1].first && physical[i].second == physical[i - 1].second + 1)
         {
-            finalLed = strip.totalLeds - led / 2 - 1;
+            runs[runCount - 1].ledCount++;
+            continue;
         }
-        break;
+        if (runCount == maxRuns)
+            return;
+        runs[runCount++] = {static_cast<uint8_t>(physical[i].first), static_cast<uint16_t>(physical[i].second), 1};
     }
-    case PianoLedStrip::StripOrientation::StackedRightToLeft:
+}
+
+const std::vector<NeoPixelColor> &KeyboardKeyToLed::HandleNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    EventTrace::Scope trace(EventTrace::Id::Mapping, note);
+    changedLeds.clear();
+    if (note >= KeySpanTable::noteCount)
+        return changedLeds;
+
+    if (velocity == 0)
+        return HandleNoteOff(source, note, velocity);
+
+    guidedNotes[note] = false;
+    const LedColor color = activeColors->NoteOnColor(source, channel, note, velocity);
+    const uint8_t strips = source < sourceStrips.size() ? sourceStrips[source] : 0xFF;
+    for (uint16_t r = noteRuns[note]; r < noteRuns[note + 1]; ++r)
     {
-        // TODO
-        break;
-    }
+        if (strips & 1 << runs[r].stripNumber)
+            UpdateRun(changedLeds, runs[r], RunUpdate::Press, color, 255);
     }
 
-    int stripNumber = 0;
-    for (size_t i = 0; i < PianoLedConfig::globalConfig.strips.size(); ++i)
+    return changedLeds;
+}
+
+const std::vector<NeoPixelColor> &KeyboardKeyToLed::HandleNoteOff(uint8_t source, uint8_t note, uint8_t velocity)
+{
+    EventTrace::Scope trace(EventTrace::Id::Mapping, note);
+    changedLeds.clear();
+    if (note >= KeySpanTable::noteCount)
+        return changedLeds;
+
+    const NoteColorTable &colors = *activeColors;
+    const uint8_t strips = source < sourceStrips.size() ? sourceStrips[source] : 0xFF;
+    for (uint16_t r = noteRuns[note]; r < noteRuns[note + 1]; ++r)
     {
-        if (PianoLedConfig::globalConfig.strips[i] == strip)
-        {
-            stripNumber = i;
-            break;
-        }
+        if (!(strips & 1 << runs[r].stripNumber))
+            continue;
+        if (guidedNotes[note])
+            UpdateRun(changedLeds, runs[r], RunUpdate::Release, colors.GuideColor(), colors.GuideBrightness());
+        else
+            UpdateRun(changedLeds, runs[r], RunUpdate::Release, colors.NoteOffColor(), colors.NoteOffBrightness());
     }
 
-    if (noteEvent.commandCode == NoteEvent::MidiCommandCode::NoteOff || noteEvent.velocity == 0)
+    return changedLeds;
+}
+
+const std::vector<NeoPixelColor> &KeyboardKeyToLed::HandleGuideOn(uint8_t note)
+{
+    changedLeds.clear();
+    if (note >= KeySpanTable::noteCount)
+        return changedLeds;
+
+    guidedNotes[note] = true;
+    for (uint16_t r = noteRuns[note]; r < noteRuns[note + 1]; ++r)
     {
-        return NeoPixelColor(stripNumber, finalLed, PianoLedConfig::globalConfig.noteOffColor, PianoLedConfig::globalConfig.noteOffColorBrightness);
+        if (sourceStrips[MidiSources::player] & 1 << runs[r].stripNumber)
+            UpdateRun(changedLeds, runs[r], RunUpdate::PaintUnlit, activeColors->GuideColor(), activeColors->GuideBrightness());
     }
 
-    LedColor color(0, 0, 0);
-    switch (PianoLedConfig::globalConfig.colorLayout)
+    return changedLeds;
+}
+
+const std::vector<NeoPixelColor> &KeyboardKeyToLed::HandleGuideOff(uint8_t note)
+{
+    changedLeds.clear();
+    if (note >= KeySpanTable::noteCount || !guidedNotes[note])
+        return changedLeds;
+
+    guidedNotes[note] = false;
+    for (uint16_t r = noteRuns[note]; r < noteRuns[note + 1]; ++r)
     {
-    case PianoLedConfig::LedStripColorLayout::VelocityBased:
-        color = GradientColorMapping::Map(noteEvent.velocity, 128, PianoLedConfig::globalConfig.colorCurve, PianoLedConfig::globalConfig.colorPalette);
-        break;
-    case PianoLedConfig::LedStripColorLayout::NoteBased:
-        color = GradientColorMapping::Map(led, strip.totalLeds, PianoLedConfig::globalConfig.colorCurve, PianoLedConfig::globalConfig.colorPalette);
-        break;
+        if (sourceStrips[MidiSources::player] & 1 << runs[r].stripNumber)
+            UpdateRun(changedLeds, runs[r], RunUpdate::PaintUnlit, activeColors->NoteOffColor(), activeColors->NoteOffBrightness());
     }
 
-    return NeoPixelColor(stripNumber, finalLed, color, 255);
+    return changedLeds;
+}
+
+const std::vector<NeoPixelColor> &KeyboardKeyToLed::RepaintUnlit(uint8_t strip, int startLed, int ledCount)
+{
+    changedLeds.clear();
+    if (strip >= PianoLedConfig::maxStrips || startLed < 0)
+        return changedLeds;
+
+    const int end = std::min(startLed + std::min(ledCount, repaintChunkLeds), PianoLedConfig::maxLedsPerStrip);
+    if (end > startLed)
+        UpdateRun(changedLeds, LedRun{strip, static_cast<uint16_t>(startLed), static_cast<uint16_t>(end - startLed)},
+                  RunUpdate::PaintUnlit, activeColors->NoteOffColor(), activeColors->NoteOffBrightness());
+    return changedLeds;
+}
+
+void KeyboardKeyToLed::UpdateRun(std::vector<NeoPixelColor> &out, const LedRun &run, RunUpdate update, const LedColor &color, int brightness)
+{
+    auto &litCounts = litLedCounts[run.stripNumber];
+    const int end = run.startLed + run.ledCount;
+
+    // Only LEDs that no other held key lights up change color. They are emitted as consecutive runs
+    // so the LED controller can fill them in bulk.
+    int changedStart = -1;
+    for (int led = run.startLed; led <= end; ++led)
+    {
+        bool changed = false;
+        if (led < end)
+        {
+            switch (update)
+            {
+            case RunUpdate::Press:
+                changed = litCounts[led]++ == 0;
+                break;
+            case RunUpdate::Release:
+                changed = litCounts[led] > 0 && --litCounts[led] == 0;
+                break;
+            case RunUpdate::PaintUnlit:
+                changed = litCounts[led] == 0;
+                break;
+            }
+        }
+
+        if (changed && changedStart < 0)
+        {
+            changedStart = led;
+        }
+        else if (!changed && changedStart >= 0)
+        {
+            out.emplace_back(run.stripNumber, changedStart, color, brightness, led - changedStart);
+            changedStart = -1;
+        }
+    }
 }
@@ -3,30 +3,138 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <functional>
-#include <unordered_map>
 #include <cmath>
 #include "NeoPixelColor.h"
 #include "PianoLedStrip.h"
 #include "GradientColorMapping.h"
 #include "NoteEvent.h"
 #include "PianoLedConfig.h"
+#include "LedTopology.h"
+#include "NoteColorTable.h"
+#include "KeySpanTable.h"
+#include "MidiSources.h"
 
 class KeyboardKeyToLed
 {
 public:
+    /**
+     * LEDs per call of \ref RepaintUnlit.
+     */
+    static constexpr int repaintChunkLeds = 64;
+
     KeyboardKeyToLed()
+        : runCount(0), activeColors(&colorTable)
     {
-        lowestKeyOffset = PianoLedConfig::NoteToMidi(PianoLedConfig::globalConfig.lowestKey);
+        RebuildKeyMap();
     }
 
-    std::vector<NeoPixelColor> HandleNoteOn(uint8_t note, uint8_t velocity);
-    std::vector<NeoPixelColor> HandleNoteOff(uint8_t note, uint8_t velocity);
+    /**
+     * Returns the LED runs that change color. The result lives in a buffer that is reused by the next call; it is
+     * sized in RebuildKeyMap so note events do not allocate.
+     * @param source MIDI source ID (see MidiSources.h); only the strips and zones routed to it are used.
+     * @param channel MIDI channel (1-16) the note was played on; selects the color zone together with the note.
+     */
+    const std::vector<NeoPixelColor> &HandleNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity);
+    const std::vector<NeoPixelColor> &HandleNoteOff(uint8_t source, uint8_t note, uint8_t velocity);
+
+    /**
+     * Lights the LEDs of \p note that no held key lights in the guide color, to show that it is about to be played.
+     * The guide ends with \ref HandleGuideOff or when the note is played; a guided key that is released returns to
+     * the guide color. Guides are shown on the strips of the MIDI file player source.
+     */
+    const std::vector<NeoPixelColor> &HandleGuideOn(uint8_t note);
+    const std::vector<NeoPixelColor> &HandleGuideOff(uint8_t note);
+
+    /**
+     * Paints the LEDs \p startLed up to \p startLed + \p ledCount (at most \ref repaintChunkLeds) of \p strip that no
+     * held key lights in the note off color, e.g. after switching to a preset with another note off color. Guided
+     * notes have to be repainted with \ref HandleGuideOn afterwards.
+     */
+    const std::vector<NeoPixelColor> &RepaintUnlit(uint8_t strip, int startLed, int ledCount);
+
+    /**
+     * Makes note events use \p table instead of the color table compiled from the configuration (nullptr). Held keys
+     * keep their color until they are released. \p table must stay valid until it is replaced.
+     */
+    void SelectColorTable(const NoteColorTable *table) { activeColors = table ? table : &colorTable; }
+    const NoteColorTable &Colors() const { return *activeColors; }
+
+    /**
+     * Compiles \p config into \p table for the current key map, like the table of the configuration.
+     */
+    void BuildColorTable(NoteColorTable &table, const PianoLedConfig &config) const
+    {
+        table.Build(config, lowestMappedNote, highestMappedNote);
+    }
+
+    bool Guided(uint8_t note) const { return note < KeySpanTable::noteCount && guidedNotes[note]; }
+
+    /**
+     * Regenerates the per-key LED spans from PianoLedConfig::globalConfig and forgets which LEDs are lit.
+     * Used after calibration edits; the LED controller does not need to be restarted for this.
+     */
+    void RebuildKeyMap();
+
+    /**
+     * Forgets which LEDs are lit and guided, e.g. after all LEDs were reset to the note off color.
+     */
+    void ResetLitLeds();
 
 private:
+    /**
+     * What \ref UpdateRun does to the lit counts of a run, and which of its LEDs it reports as changed.
+     */
+    enum class RunUpdate
+    {
+        Press,      // LEDs that no held key lit before change color
+        Release,    // LEDs that no held key lights anymore change color
+        PaintUnlit, // LEDs that no held key lights change color, without changing the held keys
+    };
+
+    /**
+     * Physically consecutive LEDs of one strip that belong to a key.
+     */
+    struct LedRun
+    {
+        uint8_t stripNumber;
+        uint16_t startLed;
+        uint16_t ledCount;
+    };
+
+    /**
+     * Capacity of the run table: one run per note on every strip, plus runs split at segment boundaries.
+     */
+    static constexpr size_t maxRuns = 1024;
+
     int lowestKeyOffset;
 
-    NeoPixelColor Handle(const NoteEvent &noteEvent, PianoLedStrip &strip);
+    // The runs of note n are runs[noteRuns[n]] up to (excluding) runs[noteRuns[n + 1]]. The tables are statically sized
+    // so that everything a note event touches sits in DTCM next to the owning object.
+    std::array<LedRun, maxRuns> runs;
+    size_t runCount;
+    std::array<uint16_t, 129> noteRuns;
+
+    NoteColorTable colorTable;
+    const NoteColorTable *activeColors; // colorTable or the table of a preset
+    // the notes that have LEDs, NoteBased gradients are spread over these
+    int lowestMappedNote;
+    int highestMappedNote;
+
+    // Bit n is set if the source lights up strip n
+    std::array<uint8_t, MidiSources::count> sourceStrips;
+
+    // How many held keys light up each LED, per strip
+    std::array<std::array<uint8_t, PianoLedConfig::maxLedsPerStrip>, PianoLedConfig::maxStrips> litLedCounts;
+
+    std::array<bool, KeySpanTable::noteCount> guidedNotes;
+
+    // Result buffer of HandleNoteOn/HandleNoteOff
+    std::vector<NeoPixelColor> changedLeds;
+
+    void AddRuns(const LedTopology &topology, const KeySpan &span);
+    void UpdateRun(std::vector<NeoPixelColor> &out, const LedRun &run, RunUpdate update, const LedColor &color, int brightness);
 };
 
 #endif
@@ -17,6 +17,12 @@ public:
     virtual void ShutdownLeds() = 0;
     virtual void ChangeIndividualLedColors(const std::vector<NeoPixelColor> &colorsPerPixel) = 0;
     virtual void BulkChangeLedColors(int startLed, int endLed, int segmentNumber, const LedColor &color, int brightness) = 0;
+
+    /**
+     * Called once per main loop iteration. Controllers that output asynchronously use it to hand over frames
+     * that could not be sent right away.
+     */
+    virtual void Update() {}
 };
 
 #endif
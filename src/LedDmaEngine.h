@@ -0,0 +1,40 @@
+#ifndef LED_DMA_ENGINE_H
+#define LED_DMA_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hardware side of \ref DmaLedController: something that can clock a frame out to the strips in the background.
+ *
+ * The engine owns the buffer the DMA reads from. \ref ILedDmaEngine::Transmit copies (and encodes) the caller's frame
+ * into that buffer, starts the transfer and returns immediately. The caller's frame is free to be modified again as
+ * soon as Transmit returns, which together with the engine buffer forms the double buffer.
+ */
+class ILedDmaEngine
+{
+public:
+    virtual ~ILedDmaEngine() {}
+
+    /**
+     * Prepares the engine for frames of \p pins.size() strips with \p ledsPerStrip LEDs each.
+     * @return false if the engine cannot drive this configuration.
+     */
+    virtual bool Begin(size_t ledsPerStrip, const std::vector<uint8_t> &pins) = 0;
+
+    /**
+     * True while a transfer (including the WS2812 latch time) is still in progress.
+     * A new frame may only be handed over once this returns false.
+     */
+    virtual bool Busy() = 0;
+
+    /**
+     * Hands over a frame of RGB pixels laid out strip after strip, \p ledsPerStrip pixels per strip.
+     * Every channel is scaled by \p brightness (255 = unchanged) on the way into the DMA buffer.
+     * Must only be called while \ref Busy returns false.
+     */
+    virtual void Transmit(const uint8_t *rgbFrame, uint8_t brightness) = 0;
+};
+
+#endif // LED_DMA_ENGINE_H
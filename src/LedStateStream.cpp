@@ -0,0 +1,213 @@
+#include "LedStateStream.h"
+#include "MemoryMap.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+// Only compared and copied in bulk, so it can live in the slower OCRAM
+DMAMEM static uint8_t sentFrameMemory[PianoLedConfig::maxStrips * PianoLedConfig::maxLedsPerStrip * 3];
+#else
+static uint8_t sentFrameMemory[PianoLedConfig::maxStrips * PianoLedConfig::maxLedsPerStrip * 3];
+#endif
+
+namespace
+{
+    const char linePrefix[] = "LedState ";
+
+    size_t WriteVarint(uint8_t *out, uint32_t value)
+    {
+        size_t length = 0;
+        do
+        {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            out[length++] = byte | (value ? 0x80 : 0);
+        } while (value);
+        return length;
+    }
+
+    size_t WriteBase64(const uint8_t *data, size_t length, char *out)
+    {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        size_t written = 0;
+        for (size_t i = 0; i < length; i += 3)
+        {
+            uint32_t group = data[i] << 16 | (i + 1 < length ? data[i + 1] << 8 : 0) | (i + 2 < length ? data[i + 2] : 0);
+            out[written++] = alphabet[group >> 18 & 0x3F];
+            out[written++] = alphabet[group >> 12 & 0x3F];
+            out[written++] = i + 1 < length ? alphabet[group >> 6 & 0x3F] : '=';
+            out[written++] = i + 2 < length ? alphabet[group & 0x3F] : '=';
+        }
+        return written;
+    }
+}
+
+LedStateStream::LedStateStream()
+    : active(false), keyframe(true), updateInProgress(false), keyframeCursor(0), scanPosition(0), updateStartMs(0),
+      currentIntervalMs(0), updatesSinceKeyframe(0), sequence(0), sentStripCount(0), sentLedsPerStrip(0),
+      sentFrame(sentFrameMemory)
+{
+    keys.fill(0);
+    sentKeys.fill(0);
+    lineBuffer[0] = '\0';
+}
+
+void LedStateStream::start()
+{
+    active = true;
+    requestKeyframe();
+    updateInProgress = false;
+    currentIntervalMs = 0; // the first update is due right away
+}
+
+void LedStateStream::requestKeyframe()
+{
+    keyframe = true;
+    keyframeCursor = 0;
+}
+
+bool LedStateStream::changed(uint32_t led, const uint8_t *frame) const
+{
+    return (keyframe && led >= keyframeCursor) || memcmp(frame + led * 3, sentFrame + led * 3, 3) != 0;
+}
+
+size_t LedStateStream::nextLine(uint32_t nowMs, size_t writableBytes, const uint8_t *frame, size_t stripCount, size_t ledsPerStrip)
+{
+    const int baseIntervalMs = PianoLedConfig::globalConfig.ledStreamIntervalMs;
+    if (!active || baseIntervalMs <= 0 || !frame)
+        return 0;
+
+    if (stripCount != sentStripCount || ledsPerStrip != sentLedsPerStrip)
+    {
+        // the LED layout changed, what the receiver has is meaningless now
+        sentStripCount = std::min(stripCount, static_cast<size_t>(PianoLedConfig::maxStrips));
+        sentLedsPerStrip = std::min(ledsPerStrip, static_cast<size_t>(PianoLedConfig::maxLedsPerStrip));
+        requestKeyframe();
+        updateInProgress = false;
+        MemoryMap::Record("LED state stream", sentFrame, maxFrameBytes, sentStripCount * sentLedsPerStrip * 3);
+    }
+
+    bool firstLine = !updateInProgress;
+    if (firstLine)
+    {
+        if (nowMs - updateStartMs < currentIntervalMs)
+            return 0;
+        if (updatesSinceKeyframe >= keyframeInterval)
+            requestKeyframe();
+        updateStartMs = nowMs;
+        scanPosition = 0;
+        currentIntervalMs = std::max(currentIntervalMs, static_cast<uint32_t>(baseIntervalMs));
+    }
+
+    if (writableBytes < maxLineLength)
+    {
+        // the UART cannot keep up: stop this update and slow down
+        if (!firstLine)
+            ++counters.cutShort;
+        updateInProgress = false;
+        currentIntervalMs = std::min(currentIntervalMs * 2, maxIntervalMs);
+        return 0;
+    }
+
+    uint8_t payload[maxPayloadBytes];
+    size_t payloadLength = encodePayload(payload, frame, firstLine);
+    if (payloadLength == 0)
+    {
+        updateInProgress = false;
+        return 0;
+    }
+
+    memcpy(lineBuffer, linePrefix, sizeof(linePrefix) - 1);
+    size_t length = sizeof(linePrefix) - 1;
+    length += WriteBase64(payload, payloadLength, lineBuffer + length);
+    lineBuffer[length++] = '\n';
+    lineBuffer[length] = '\0';
+    ++counters.lines;
+    counters.bytes += length;
+    return length;
+}
+
+size_t LedStateStream::encodePayload(uint8_t *payload, const uint8_t *frame, bool firstLine)
+{
+    uint8_t flags = 0;
+    size_t length = 2;
+
+    if (firstLine)
+    {
+        bool keysChanged = false;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            payload[length + i] = keyframe ? keys[i] : keys[i] ^ sentKeys[i];
+            keysChanged = keysChanged || payload[length + i] != 0;
+        }
+        if (keyframe || keysChanged)
+        {
+            flags |= keyframe ? flagKeyframe | flagKeys : flagKeys;
+            length += keys.size();
+            sentKeys = keys;
+        }
+    }
+
+    const uint32_t ledCount = sentStripCount * sentLedsPerStrip;
+    while (scanPosition < ledCount)
+    {
+        if (!changed(scanPosition, frame))
+        {
+            ++scanPosition;
+            continue;
+        }
+
+        // extend the run over all following LEDs of the strip with the same color, changed or not
+        uint32_t firstLed = scanPosition % sentLedsPerStrip;
+        const uint8_t *color = frame + scanPosition * 3;
+        uint32_t count = 1;
+        while (firstLed + count < sentLedsPerStrip && memcmp(color + count * 3, color, 3) == 0)
+            ++count;
+
+        uint8_t run[1 + 3 + 3 + 3];
+        size_t runLength = 0;
+        run[runLength++] = scanPosition / sentLedsPerStrip;
+        runLength += WriteVarint(run + runLength, firstLed);
+        runLength += WriteVarint(run + runLength, count);
+        memcpy(run + runLength, color, 3);
+        runLength += 3;
+        if (length + runLength > maxPayloadBytes)
+            break;
+
+        memcpy(payload + length, run, runLength);
+        length += runLength;
+        memcpy(sentFrame + scanPosition * 3, color, count * 3);
+        scanPosition += count;
+        if (keyframe)
+            keyframeCursor = scanPosition;
+    }
+
+    if (scanPosition >= ledCount)
+    {
+        flags |= flagEnd;
+        if (firstLine && flags == flagEnd && length == 2)
+            return 0; // nothing changed at all
+        updateInProgress = false;
+        ++counters.updates;
+        if (keyframe)
+        {
+            keyframe = false;
+            ++counters.keyframes;
+            updatesSinceKeyframe = 0;
+        }
+        else
+        {
+            ++updatesSinceKeyframe;
+        }
+        currentIntervalMs = std::max(currentIntervalMs / 2, static_cast<uint32_t>(PianoLedConfig::globalConfig.ledStreamIntervalMs));
+    }
+    else
+    {
+        updateInProgress = true;
+    }
+
+    payload[0] = flags;
+    payload[1] = sequence++;
+    return length;
+}
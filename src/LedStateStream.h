@@ -0,0 +1,97 @@
+#ifndef LED_STATE_STREAM_H
+#define LED_STATE_STREAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "PianoLedConfig.h"
+
+/**
+ * Streams which keys are pressed and what the LEDs show to the ESP32, for a live keyboard view in the web configurator.
+ *
+ * Updates are sent as text lines "LedState <base64>" on the config UART. Each line decodes to
+ *
+ *     flags (1 byte): flagKeyframe, flagKeys, flagEnd
+ *     sequence (1 byte): increments with every line, so the receiver can detect lost lines
+ *     keys (16 bytes, if flagKeys): bitset of MIDI notes 0-127; with flagKeyframe the pressed keys, otherwise the keys
+ *         that changed since the last update
+ *     runs until the end of the line: strip (1 byte), first LED and LED count (LEB128 varints), color (3 bytes RGB)
+ *
+ * and an update ends with the line that has flagEnd. Runs are absolute, so every line can be applied on its own. A
+ * keyframe sends all LEDs; other updates only the runs that differ from what was sent before, with neighbours of the
+ * same color merged into the run. On a sequence gap the receiver sends "LedStream keyframe".
+ *
+ * \ref nextLine never blocks: it only produces a line if the UART buffer can take it. When the buffer is too full,
+ * the update is cut short and the interval between updates is doubled (up to \ref maxIntervalMs); every complete
+ * update halves it again, down to PianoLedConfig::ledStreamIntervalMs. Changes that were not sent are simply part of
+ * the next update, which is never larger than a keyframe.
+ */
+class LedStateStream
+{
+public:
+    static constexpr uint8_t flagKeyframe = 0x01;
+    static constexpr uint8_t flagKeys = 0x02;
+    static constexpr uint8_t flagEnd = 0x04;
+
+    static constexpr size_t maxPayloadBytes = 96;
+    static constexpr size_t maxLineLength = 9 + (maxPayloadBytes + 2) / 3 * 4 + 1; // "LedState " + base64 + '\n'
+    static constexpr uint32_t maxIntervalMs = 1000;
+    static constexpr size_t keyframeInterval = 200; // updates
+
+    struct Stats
+    {
+        uint32_t updates = 0;
+        uint32_t keyframes = 0;
+        uint32_t lines = 0;
+        uint32_t bytes = 0;
+        uint32_t cutShort = 0; // updates stopped because the UART buffer was full
+    };
+
+    LedStateStream();
+
+    void start();
+    void stop() { active = false; }
+    bool streaming() const { return active; }
+    void requestKeyframe();
+
+    void noteOn(uint8_t note) { keys[note >> 3 & 15] |= 1 << (note & 7); }
+    void noteOff(uint8_t note) { keys[note >> 3 & 15] &= ~(1 << (note & 7)); }
+    void releaseAllKeys() { keys.fill(0); }
+
+    /**
+     * Produces the next line to send, if an update is due and \p writableBytes can take a whole line.
+     * @param frame RGB frame buffer, \p stripCount strips of \p ledsPerStrip LEDs.
+     * @return the length of \ref line, 0 if there is nothing to send now.
+     */
+    size_t nextLine(uint32_t nowMs, size_t writableBytes, const uint8_t *frame, size_t stripCount, size_t ledsPerStrip);
+
+    const char *line() const { return lineBuffer; }
+    uint32_t intervalMs() const { return currentIntervalMs; }
+    const Stats &stats() const { return counters; }
+
+private:
+    static constexpr size_t maxFrameBytes = PianoLedConfig::maxStrips * PianoLedConfig::maxLedsPerStrip * 3;
+
+    bool active;
+    bool keyframe;
+    bool updateInProgress;
+    uint32_t keyframeCursor;  // LEDs before it were sent in the current keyframe
+    uint32_t scanPosition;    // LED the current update continues at
+    uint32_t updateStartMs;
+    uint32_t currentIntervalMs;
+    size_t updatesSinceKeyframe;
+    uint8_t sequence;
+    size_t sentStripCount;
+    size_t sentLedsPerStrip;
+
+    std::array<uint8_t, 16> keys;
+    std::array<uint8_t, 16> sentKeys;
+    uint8_t *sentFrame; // what the receiver has
+    char lineBuffer[maxLineLength + 1];
+    Stats counters;
+
+    size_t encodePayload(uint8_t *payload, const uint8_t *frame, bool firstLine);
+    bool changed(uint32_t led, const uint8_t *frame) const;
+};
+
+#endif // LED_STATE_STREAM_H
@@ -0,0 +1,71 @@
+#include "LedTopology.h"
+#include <algorithm>
+
+LedTopology::LedTopology(const std::vector<LedSegment> &segments)
+{
+    int rows = 1;
+    for (auto &segment : segments)
+    {
+        rows = std::max(rows, segment.row + 1);
+    }
+
+    // Lay out every row on its own, then interleave the rows
+    std::vector<std::vector<PhysicalLed>> rowLeds(rows);
+    for (auto &segment : segments)
+    {
+        if (segment.row < 0 || segment.stripNumber < 0 || segment.stripNumber >= unmapped)
+            continue;
+        for (int i = 0; i < segment.ledCount; ++i)
+        {
+            int led = segment.direction == LedSegment::Direction::LeftToRight
+                          ? segment.startLed + i
+                          : segment.startLed + segment.ledCount - 1 - i;
+            rowLeds[segment.row].push_back({static_cast<uint8_t>(segment.stripNumber), static_cast<uint16_t>(led)});
+        }
+    }
+
+    size_t longestRow = 0;
+    for (auto &row : rowLeds)
+    {
+        longestRow = std::max(longestRow, row.size());
+    }
+
+    lookup.assign(longestRow * rows, PhysicalLed{unmapped, 0});
+    for (int row = 0; row < rows; ++row)
+    {
+        for (size_t i = 0; i < rowLeds[row].size(); ++i)
+        {
+            lookup[i * rows + row] = rowLeds[row][i];
+        }
+    }
+
+    // trailing positions of shorter rows
+    while (!lookup.empty() && lookup.back().stripNumber == unmapped)
+    {
+        lookup.pop_back();
+    }
+}
+
+std::vector<LedSegment> LedTopology::FromOrientation(int stripNumber, const PianoLedStrip &strip)
+{
+    const int n = std::max(strip.totalLeds, 0);
+    // Stacked strips run along the keyboard and back; the first row gets the extra LED of an odd count
+    const int firstRow = (n + 1) / 2;
+    const int secondRow = n / 2;
+
+    using Direction = LedSegment::Direction;
+    switch (strip.stripOrientation)
+    {
+    case PianoLedStrip::StripOrientation::RightToLeft:
+        return {{stripNumber, 0, n, Direction::RightToLeft}};
+    case PianoLedStrip::StripOrientation::StackedLeftToRight:
+        return {{stripNumber, 0, firstRow, Direction::LeftToRight, 0},
+                {stripNumber, firstRow, secondRow, Direction::RightToLeft, 1}};
+    case PianoLedStrip::StripOrientation::StackedRightToLeft:
+        return {{stripNumber, 0, firstRow, Direction::RightToLeft, 0},
+                {stripNumber, firstRow, secondRow, Direction::LeftToRight, 1}};
+    case PianoLedStrip::StripOrientation::LeftToRight:
+    default:
+        return {{stripNumber, 0, n, Direction::LeftToRight}};
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef LED_TOPOLOGY_H
+#define LED_TOPOLOGY_H
+
+#include <cstdint>
+#include <vector>
+#include "PianoLedStrip.h"
+
+/**
+ * A piece of a physical LED strip that is part of one logical keyboard.
+ */
+struct LedSegment
+{
+    enum class Direction
+    {
+        /**
+         * Physical LED startLed sits above the left end of this segment.
+         */
+        LeftToRight,
+        /**
+         * Physical LED startLed sits above the right end of this segment.
+         */
+        RightToLeft
+    };
+
+    /**
+     * Index into PianoLedConfig::strips.
+     */
+    int stripNumber;
+    int startLed;
+    int ledCount;
+    Direction direction;
+
+    /**
+     * Stacked layouts put several rows of LEDs above the same keys. Logical positions alternate between the rows,
+     * e.g. with two rows the even positions are on row 0 and the odd positions on row 1. Segments of the same row
+     * are concatenated in order.
+     */
+    int row = 0;
+};
+
+/**
+ * Compiled mapping from logical LED positions of one keyboard (0 = leftmost) to physical LEDs.
+ *
+ * A keyboard is described by an ordered list of \ref LedSegment, which covers serpentine and stacked layouts in both
+ * directions as well as keyboards spanning several strips. The stripOrientation of a single strip is just a
+ * predefined segment list, see \ref FromOrientation.
+ */
+class LedTopology
+{
+public:
+    struct PhysicalLed
+    {
+        uint8_t stripNumber;
+        uint16_t ledNumber;
+    };
+
+    static const uint8_t unmapped = 0xFF;
+
+    explicit LedTopology(const std::vector<LedSegment> &segments);
+
+    /**
+     * Segments equivalent to \p strip's stripOrientation, for a strip that forms a keyboard on its own.
+     */
+    static std::vector<LedSegment> FromOrientation(int stripNumber, const PianoLedStrip &strip);
+
+    int LogicalLeds() const { return static_cast<int>(lookup.size()); }
+
+    /**
+     * Physical LED at \p logicalLed. stripNumber is \ref unmapped for positions no segment covers.
+     */
+    PhysicalLed Map(int logicalLed) const
+    {
+        if (logicalLed < 0 || logicalLed >= LogicalLeds())
+            return {unmapped, 0};
+        return lookup[logicalLed];
+    }
+
+private:
+    std::vector<PhysicalLed> lookup;
+};
+
+#endif // LED_TOPOLOGY_H
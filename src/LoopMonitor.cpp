@@ -0,0 +1,104 @@
+#include "LoopMonitor.h"
+#include "PianoLedConfig.h"
+#include <algorithm>
+
+uint32_t LoopMonitor::watchdogTimeoutMs = 0;
+bool LoopMonitor::resetByWatchdog = false;
+
+LoopMonitor::LoopMonitor()
+    : stallThresholdUs(0), iterationStartUs(0), iterations(0), maxIterationUs(0), stalls(0)
+{
+#if defined(__IMXRT1062__)
+    // the reset status bits survive a watchdog reset and are cleared by writing ones
+    resetByWatchdog = SRC_SRSR & SRC_SRSR_WDOG_RST_B;
+    SRC_SRSR = SRC_SRSR_WDOG_RST_B;
+#endif
+}
+
+void LoopMonitor::configure()
+{
+    stallThresholdUs = std::max(PianoLedConfig::globalConfig.stallThresholdMs, 0) * 1000u;
+
+    int timeoutMs = PianoLedConfig::globalConfig.watchdogTimeoutMs;
+    if (timeoutMs <= 0)
+        return;
+#if defined(__IMXRT1062__)
+    // timeout in steps of 0.5 s, up to 128 s
+    uint16_t timeoutSteps = std::min(std::max(timeoutMs, minWatchdogTimeoutMs) / 500, 256) - 1;
+    watchdogTimeoutMs = (timeoutSteps + 1) * 500u;
+    if (!(WDOG1_WCR & WDOG_WCR_WDE))
+    {
+        CCM_CCGR3 |= CCM_CCGR3_WDOG1(CCM_CCGR_ON);
+        WDOG1_WMCR = 0; // disable the power-down counter, which would reset the device after 16 s otherwise
+        // SRS and WDA set: no software reset and no WDOG_B assertion, only the timeout resets the device
+        WDOG1_WCR = WDOG_WCR_WT(timeoutSteps) | WDOG_WCR_SRS | WDOG_WCR_WDA | WDOG_WCR_WDE;
+    }
+    else
+    {
+        // the timeout can be changed while the watchdog runs, enabling it cannot be undone
+        WDOG1_WCR = (WDOG1_WCR & ~WDOG_WCR_WT(0xFF)) | WDOG_WCR_WT(timeoutSteps);
+    }
+    feedWatchdog();
+#endif
+}
+
+void LoopMonitor::feedWatchdog()
+{
+#if defined(__IMXRT1062__)
+    if (watchdogTimeoutMs > 0)
+    {
+        WDOG1_WSR = 0x5555;
+        WDOG1_WSR = 0xAAAA;
+    }
+#endif
+}
+
+void LoopMonitor::beginIteration()
+{
+    uint32_t now = micros();
+    if (iterations > 0)
+        maxIterationUs = std::max(maxIterationUs, now - iterationStartUs);
+    iterationStartUs = now;
+    ++iterations;
+    feedWatchdog();
+}
+
+void LoopMonitor::record(const char *name, uint32_t durationUs)
+{
+    if (stallThresholdUs == 0 || durationUs <= stallThresholdUs)
+        return;
+
+    ++stalls;
+    lastStall = {name, durationUs, millis()};
+    if (durationUs > worstStall.durationUs)
+        worstStall = lastStall;
+}
+
+void LoopMonitor::printStats(Print &out) const
+{
+    out.printf("loop: %lu iterations, longest %lu us, %lu stalls over %lu ms\n", (unsigned long)iterations,
+               (unsigned long)maxIterationUs, (unsigned long)stalls, (unsigned long)(stallThresholdUs / 1000));
+    if (lastStall.name)
+    {
+        out.printf("last stall: %s took %lu us (%lu us over), %lu ms ago\n", lastStall.name,
+                   (unsigned long)lastStall.durationUs, (unsigned long)(lastStall.durationUs - stallThresholdUs),
+                   (unsigned long)(millis() - lastStall.atMs));
+        out.printf("worst stall: %s took %lu us, %lu ms ago\n", worstStall.name, (unsigned long)worstStall.durationUs,
+                   (unsigned long)(millis() - worstStall.atMs));
+    }
+    if (watchdogTimeoutMs > 0)
+        out.printf("watchdog: resets after %lu ms without progress\n", (unsigned long)watchdogTimeoutMs);
+    else
+        out.println("watchdog: off");
+    if (resetByWatchdog)
+        out.println("the last reset was caused by the watchdog");
+}
+
+void LoopMonitor::resetStats()
+{
+    iterations = 0;
+    maxIterationUs = 0;
+    stalls = 0;
+    lastStall = Stall();
+    worstStall = Stall();
+}
@@ -0,0 +1,70 @@
+#ifndef LOOP_MONITOR_H
+#define LOOP_MONITOR_H
+
+#include <Arduino.h>
+#include <cstdint>
+
+/**
+ * Detects stalls of the main loop and keeps the hardware watchdog fed.
+ *
+ * Several paths block on purpose (the LED wipes, the quiet timeout of the config parser), so a long task run is not
+ * necessarily a hang. Every run of a TaskScheduler task longer than PianoLedConfig::stallThresholdMs is counted as a
+ * stall, remembering which task overran and by how much, for the `stats` command. The watchdog (WDOG1 of the
+ * i.MX RT1062) is only reset by \ref feedWatchdog, which the main loop calls every iteration and the intentionally
+ * long operations call while they make progress, so it only resets the device if the firmware stops making progress
+ * for PianoLedConfig::watchdogTimeoutMs.
+ */
+class LoopMonitor
+{
+public:
+    LoopMonitor();
+
+    /**
+     * Applies the stall threshold and watchdog timeout of the global config. The watchdog cannot be turned off
+     * again once it runs; a timeout of 0 then only takes effect after a reset.
+     */
+    void configure();
+
+    /**
+     * Call at the start of every main loop iteration: completes the timing of the previous iteration and feeds the
+     * watchdog.
+     */
+    void beginIteration();
+
+    /**
+     * Records a run of the task \p name (a string literal) that took \p durationUs.
+     */
+    void record(const char *name, uint32_t durationUs);
+
+    static void feedWatchdog();
+
+    /**
+     * Shortest watchdog timeout \ref configure accepts. Above the longest delay that does not feed the watchdog: the
+     * 1.5 s wait for host devices in MidiHostManager::begin, and the 1 s power-up delay of the FastLED output.
+     */
+    static constexpr int minWatchdogTimeoutMs = 2000;
+
+    void printStats(Print &out) const;
+    void resetStats();
+
+private:
+    struct Stall
+    {
+        const char *name = nullptr;
+        uint32_t durationUs = 0;
+        uint32_t atMs = 0;
+    };
+
+    uint32_t stallThresholdUs;
+    uint32_t iterationStartUs;
+    uint32_t iterations;
+    uint32_t maxIterationUs;
+    uint32_t stalls;
+    Stall lastStall;
+    Stall worstStall;
+
+    static uint32_t watchdogTimeoutMs; // 0 while the watchdog is not running
+    static bool resetByWatchdog;
+};
+
+#endif // LOOP_MONITOR_H
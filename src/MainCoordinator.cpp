@@ -1,70 +1,723 @@
 #include <Arduino.h>
+#include <SD.h>
 #include "MainCoordinator.h"
 #include "PianoLedConfig.h"
+#include "PixelKernelsBenchmark.h"
+#include "MidiDispatchBenchmark.h"
+#include "AllocationTracker.h"
+#include "MemoryMap.h"
+#include "EventTrace.h"
 
-MainCoordinator::MainCoordinator()
-    : midiHostManager(), configManager(), keyboardKeyToLed(), ledController()
-{
-    midiHostManager.onNoteOnCallback = [&](uint8_t note, uint8_t velocity)
-    {
-        digitalWrite(LED_BUILTIN, HIGH);
-        std::vector<NeoPixelColor> colors = keyboardKeyToLed.HandleNoteOn(note, velocity);
-        ledController.ChangeIndividualLedColors(colors);
-        // {
-        //     String output = "Notes started: ";
-        //     for (size_t i = 0; i < colors.size(); ++i)
-        //     {
-        //         output += String(static_cast<int>(colors[i].ledNumber)) + " " + String(colors[i].hexColor.c_str()) + " ";
-        //     }
-        //     Serial.println(output);
-        // }
-    };
+namespace
+{
+    bool SameColor(const LedColor &a, const LedColor &b) { return a.r == b.r && a.g == b.g && a.b == b.b; }
 
-    midiHostManager.onNoteOffCallback = [&](uint8_t note, uint8_t velocity)
+    // whether the LEDs of unlit keys look the same with both tables
+    bool SameBackground(const NoteColorTable &a, const NoteColorTable &b)
     {
-        digitalWrite(LED_BUILTIN, LOW);
-        std::vector<NeoPixelColor> colors = keyboardKeyToLed.HandleNoteOff(note, velocity);
-        ledController.ChangeIndividualLedColors(colors);
-    };
+        return SameColor(a.NoteOffColor(), b.NoteOffColor()) && a.NoteOffBrightness() == b.NoteOffBrightness() &&
+               SameColor(a.GuideColor(), b.GuideColor()) && a.GuideBrightness() == b.GuideBrightness();
+    }
+}
 
-    midiHostManager.onControlChangeCallback = [&](uint8_t cc, uint8_t value)
-    {
-        digitalWrite(LED_BUILTIN, LOW);
+MainCoordinator::MainCoordinator()
+#if defined(PIANO_LED_DMA_OUTPUT)
+    : midiHostManager(*this), configManager(), keyboardKeyToLed(), dmaEngine(), ledController(&dmaEngine), serialConsole(),
+      midiFilePlayer(*this), scheduler(micros)
+#else
+    : midiHostManager(*this), configManager(), keyboardKeyToLed(), ledController(), serialConsole(), midiFilePlayer(*this),
+      scheduler(micros)
+#endif
+{
+    addTasks();
 
-        // CC AllNotesOff
-        if (cc == 123)
+    configManager.onConfigChanged = [&](const PianoLedConfig &newConfig, bool firstTimeSetup)
+    {
+        if (!firstTimeSetup && newConfig.HasSameLedHardware(PianoLedConfig::globalConfig))
         {
+            // Only the mapping or the colors changed (e.g. a key span calibration edit): regenerate the key map
+            // and repaint, but keep the LED controller running.
+            PianoLedConfig::globalConfig = newConfig;
+            loopMonitor.configure();
+            midiHostManager.configureThru();
+            keyboardKeyToLed.RebuildKeyMap();
+            noteEventReducer.Reset();
+            buildPresets();
+            ledController.ConfigurePowerBudgets();
+            ledController.ConfigureColorCorrection();
+            const NoteColorTable &colors = keyboardKeyToLed.Colors();
             for (size_t i = 0; i < PianoLedConfig::globalConfig.strips.size(); ++i)
             {
-                auto &strip = PianoLedConfig::globalConfig.strips[i];
-                strip.litLedsTable.clear();
-                ledController.BulkChangeLedColors(0, strip.totalLeds - 1, i, PianoLedConfig::globalConfig.noteOffColor, PianoLedConfig::globalConfig.noteOffColorBrightness);
+                ledController.BulkChangeLedColors(0, PianoLedConfig::globalConfig.strips[i].totalLeds, i, colors.NoteOffColor(), colors.NoteOffBrightness());
             }
+            return;
         }
-    };
 
-    midiHostManager.onHostConnectedCallback = [&](bool connected)
-    {
-        if (connected)
+        if (!firstTimeSetup)
+        {
+            midiFilePlayer.stop();
+            ledController.ShutdownLeds();
+        }
+        PianoLedConfig::globalConfig = newConfig;
+        loopMonitor.configure();
+        midiHostManager.configureThru();
+#if defined(PIANO_LED_DMA_OUTPUT)
+        ledController = DmaLedController(&dmaEngine);
+#else
+        ledController = FastLedController();
+#endif
+        keyboardKeyToLed.RebuildKeyMap();
+        noteEventReducer.Reset();
+        buildPresets();
+        if (!firstTimeSetup)
         {
             ledController.InitializeLeds();
+            // the LEDs start in the note off color of the configuration
+            if (presetBank.Active() >= 0)
+                repaintUnlitLeds();
         }
+    };
+
+    configManager.onRemoteCommand = [&](const String &command, Print &reply)
+    {
+        if (command.startsWith("Record"))
+            handleRecordCommand(command.substring(6), reply);
+        else if (command.startsWith("Play"))
+            handlePlayCommand(command.substring(4), reply);
+        else if (command.startsWith("LedStream"))
+            handleLedStreamCommand(command.substring(9), reply);
+        else if (command.startsWith("Preset"))
+            handlePresetCommand(command.substring(6), reply);
+    };
+
+#if defined(PIANO_LED_DMA_OUTPUT)
+    serialConsole.addCommand("dma", "show DMA output frame counters", [&](Print &out)
+                             { out.printf("DMA frames transmitted: %lu, deferred: %lu\n", (unsigned long)ledController.FramesTransmitted(), (unsigned long)ledController.FramesDeferred()); });
+#endif
+    serialConsole.addCommand("power", "show the estimated LED current draw and power limiting", [&](Print &out)
+                             {
+                                 const PowerLimiter &power = ledController.Power();
+                                 for (size_t i = 0; i < PianoLedConfig::globalConfig.strips.size(); ++i)
+                                 {
+                                     out.printf("strip[%u]: %lu mA (budget %d mA)\n", (unsigned)i, (unsigned long)power.StripMilliamps(i),
+                                                PianoLedConfig::globalConfig.strips[i].maxMilliamps);
+                                 }
+                                 out.printf("total: %lu mA unlimited, %lu mA limited (budget %d mA)\n", (unsigned long)power.TotalMilliamps(),
+                                            (unsigned long)power.LimitedTotalMilliamps(), PianoLedConfig::globalConfig.powerBudgetMilliamps);
+                                 out.printf("scale: %u/255, limited %lu of %lu frames\n", power.LastScale(),
+                                            (unsigned long)power.FramesLimited(), (unsigned long)power.Frames());
+                             });
+    serialConsole.addCommand("velcal", "start velocity calibration, or finish it and apply the learned curve", [&](Print &out)
+                             {
+                                 if (!velocityCalibration.Active())
+                                 {
+                                     velocityCalibration.Start();
+                                     out.printf("Velocity calibration started. Play normally, then run velcal again (at least %lu notes).\n",
+                                                (unsigned long)VelocityCalibration::minimumSamples);
+                                     return;
+                                 }
+
+                                 PianoLedConfig newConfig = PianoLedConfig::globalConfig;
+                                 if (!velocityCalibration.BuildCurve(newConfig.velocityCurve))
+                                 {
+                                     out.printf("Only %lu notes recorded, keep playing.\n", (unsigned long)velocityCalibration.Samples());
+                                     return;
+                                 }
+                                 velocityCalibration.Stop();
+                                 out.printf("Velocity curve learned from %lu notes.\n", (unsigned long)velocityCalibration.Samples());
+                                 configManager.applyConfig(newConfig);
+                             });
+    serialConsole.addCommand("velreset", "remove the learned velocity curve", [&](Print &out)
+                             {
+                                 velocityCalibration.Stop();
+                                 PianoLedConfig newConfig = PianoLedConfig::globalConfig;
+                                 newConfig.velocityCurve.clear();
+                                 configManager.applyConfig(newConfig);
+                                 out.println("Velocity curve removed.");
+                             });
+    serialConsole.addCommand("stats", "show heap usage, allocations in MIDI events and main loop timing, stats reset clears the timing",
+                             [&](Print &out, const char *argument)
+                             {
+                                 if (strcmp(argument, "reset") == 0)
+                                 {
+                                     loopMonitor.resetStats();
+                                     scheduler.resetStats();
+                                     return;
+                                 }
+                                 const AllocationTracker::Counters &totals = AllocationTracker::Totals();
+                                 out.printf("allocations: %lu, frees: %lu, failed: %lu\n", (unsigned long)totals.allocations,
+                                            (unsigned long)totals.frees, (unsigned long)totals.failedAllocations);
+                                 out.printf("heap in use: %lu bytes, peak %lu bytes\n", (unsigned long)totals.currentBytes, (unsigned long)totals.peakBytes);
+                                 AllocationTracker::HeapStats heap = AllocationTracker::Heap();
+                                 out.printf("arena: %lu bytes, free in holes: %lu bytes, free at top: %lu bytes, fragmentation: %u%%\n",
+                                            (unsigned long)heap.arenaBytes, (unsigned long)heap.holeBytes, (unsigned long)heap.topFreeBytes,
+                                            heap.fragmentationPercent);
+                                 out.printf("MIDI events: %lu, allocating: %lu", (unsigned long)AllocationTracker::EventsChecked(),
+                                            (unsigned long)AllocationTracker::EventsAllocated());
+                                 if (AllocationTracker::EventsAllocated() > 0)
+                                 {
+                                     out.printf(" (last: %lu allocations, %lu bytes)", (unsigned long)AllocationTracker::LastEventAllocations(),
+                                                (unsigned long)AllocationTracker::LastEventBytes());
+                                 }
+                                 out.println();
+                                 loopMonitor.printStats(out);
+                                 scheduler.printStats(out);
+                             });
+    serialConsole.addCommand("memory", "show which memory region the buffers of each subsystem are placed in", [](Print &out)
+                             { MemoryMap::Report(out); });
+    serialConsole.addCommand("trace", "dump the event trace for tools/TraceToChrome, trace clear to empty it",
+                             [](Print &out, const char *argument)
+                             {
+                                 if (strcmp(argument, "clear") == 0)
+                                     EventTrace::Clear();
+                                 else
+                                     EventTrace::Dump(out);
+                             });
+    serialConsole.addCommand("rec", "start or stop recording what is played, and show the recorder status", [&](Print &out)
+                             { handleRecordCommand(midiRecorder.recording() ? "stop" : "start", out); });
+    serialConsole.addCommand("play", "play <file> from flash (or sd:<file> from the SD card), play stop, play status",
+                             [&](Print &out, const char *argument)
+                             { handlePlayCommand(argument, out); });
+    serialConsole.addCommand("ledstream", "show the live LED state stream to the ESP32, ledstream start|stop|keyframe",
+                             [&](Print &out, const char *argument)
+                             { handleLedStreamCommand(argument, out); });
+    serialConsole.addCommand("sources", "show the MIDI sources with their event counts and routing, sources reset clears the counts",
+                             [&](Print &out, const char *argument)
+                             { handleSourcesCommand(argument, out); });
+    serialConsole.addCommand("coalesce", "show how many note events were merged per LED frame, coalesce reset clears the counters",
+                             [&](Print &out, const char *argument)
+                             { handleCoalesceCommand(argument, out); });
+    serialConsole.addCommand("preset", "list the presets, preset select <n>|off, preset save <n> <name>, preset delete <n>, preset bench",
+                             [&](Print &out, const char *argument)
+                             { handlePresetCommand(argument, out); });
+    serialConsole.addCommand("thru", "show the MIDI thru routing and its latency, thru reset clears the counters",
+                             [&](Print &out, const char *argument)
+                             { handleThruCommand(argument, out); });
+    serialConsole.addCommand("bench", "benchmark the pixel kernels against the scalar reference", [](Print &out)
+                             { PixelKernelsBenchmark::Run(out); });
+    serialConsole.addCommand("midibench", "benchmark MIDI event dispatch, static sink vs std::function", [](Print &out)
+                             { MidiDispatchBenchmark::Run(out); });
+}
+
+void MainCoordinator::addTasks()
+{
+    using Priority = TaskScheduler::Priority;
+    scheduler.onTaskRun = [&](const TaskScheduler::Task &task, uint32_t durationUs)
+    { loopMonitor.record(task.name, durationUs); };
+
+    // MIDI events only update the key states of the note event reducer, the LED output task maps the net changes
+    // and outputs them as one frame
+    scheduler.addTask("MIDI", Priority::Critical, 0, 200, [&]
+                      { midiHostManager.loop(); });
+    scheduler.addTask("LED output", Priority::High, 0, 500, [&]
+                      {
+                          if (noteEventReducer.Pending() || frameStaged)
+                          {
+                              // mapping and committing the frame are one event, neither may allocate
+                              AllocationTracker::EventScope allocationCheck;
+                              if (noteEventReducer.Pending())
+                                  frameStaged = applyNoteEvents(false) || frameStaged;
+                              if (frameStaged)
+                                  commitFrame();
+                          }
+                          ledController.Update();
+                      });
+    scheduler.addTask("player", Priority::High, 0, 300, [&]
+                      { midiFilePlayer.loop(); });
+    scheduler.addTask("dithering", Priority::Normal, ditherRefreshIntervalMs * 1000, 2000, [&]
+                      {
+                          if (!ledController.DitheringEnabled())
+                              return;
+                          // effects give way to key state while note events storm in
+                          if (noteEventReducer.Overloaded())
+                              noteEventReducer.ShedEffect();
+                          else
+                              ledController.RefreshOutput();
+                      });
+    scheduler.addTask("UART", Priority::Normal, 0, 1000, [&]
+                      { configManager.loop(); });
+    scheduler.addTask("recorder", Priority::Background, 0, 2000, [&]
+                      { midiRecorder.loop(); });
+    // sends lines only while the UART has room and the budget lasts, a cut off update continues in the next run
+    scheduler.addTask("LED stream", Priority::Background, 0, 300, [&]
+                      {
+                          if (ledStateStream.streaming() && noteEventReducer.Overloaded())
+                          {
+                              noteEventReducer.ShedEffect();
+                              return;
+                          }
+                          size_t length;
+                          while (!scheduler.sliceExpired() &&
+                                 (length = ledStateStream.nextLine(millis(), Serial1.availableForWrite(), ledController.FrameData(),
+                                                                   ledController.StripCount(), ledController.LedsPerStrip())) > 0)
+                          {
+                              Serial1.write(reinterpret_cast<const uint8_t *>(ledStateStream.line()), length);
+                          }
+                      });
+    scheduler.addTask("console", Priority::Background, 10000, 1000, [&]
+                      { serialConsole.loop(); });
+}
+
+void MainCoordinator::onChannelMessage(uint8_t status, uint8_t data1, uint8_t data2)
+{
+    EventTrace::Instant(EventTrace::Id::MidiIn, status << 8 | data1);
+    const int recordControlCc = PianoLedConfig::globalConfig.recordControlCc;
+    if ((status & 0xF0) == 0xB0 && data1 == recordControlCc)
+    {
+        if (data2 >= 64)
+            midiRecorder.start();
         else
+            midiRecorder.stop();
+        return;
+    }
+    midiRecorder.record(status, data1, data2);
+}
+
+void MainCoordinator::onNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    if (velocity == 0)
+    {
+        onNoteOff(source, note, velocity);
+        return;
+    }
+    AllocationTracker::EventScope allocationCheck;
+    digitalWrite(LED_BUILTIN, HIGH);
+    // the player's notes were not played on this keyboard, so they say nothing about its velocity range
+    if (source != MidiSources::player)
+        velocityCalibration.Record(velocity);
+    ledStateStream.noteOn(note);
+    if (!noteEventReducer.NoteOn(source, channel, note, velocity))
+    {
+        // more keys changed within this frame than the reducer can track: apply them now, keep the output for the frame
+        frameStaged = applyNoteEvents(true) || frameStaged;
+        noteEventReducer.NoteOn(source, channel, note, velocity);
+    }
+}
+
+void MainCoordinator::onNoteOff(uint8_t source, uint8_t note, uint8_t /* velocity, not shown */)
+{
+    AllocationTracker::EventScope allocationCheck;
+    digitalWrite(LED_BUILTIN, LOW);
+    ledStateStream.noteOff(note);
+    if (!noteEventReducer.NoteOff(source, note))
+    {
+        frameStaged = applyNoteEvents(true) || frameStaged;
+        noteEventReducer.NoteOff(source, note);
+    }
+}
+
+void MainCoordinator::onControlChange(uint8_t cc, uint8_t value)
+{
+    AllocationTracker::EventScope allocationCheck;
+    digitalWrite(LED_BUILTIN, LOW);
+
+    // CC AllNotesOff
+    if (cc == 123)
+    {
+        keyboardKeyToLed.ResetLitLeds();
+        noteEventReducer.Reset();
+        ledStateStream.releaseAllKeys();
+        const NoteColorTable &colors = keyboardKeyToLed.Colors();
+        for (size_t i = 0; i < PianoLedConfig::globalConfig.strips.size(); ++i)
         {
-            ledController.ShutdownLeds();
+            auto &strip = PianoLedConfig::globalConfig.strips[i];
+            ledController.BulkChangeLedColors(0, strip.totalLeds - 1, i, colors.NoteOffColor(), colors.NoteOffBrightness());
         }
-    };
+    }
+}
 
-    configManager.onConfigChanged = [&](const PianoLedConfig &newConfig, bool firstTimeSetup)
+void MainCoordinator::onProgramChange(uint8_t channel, uint8_t program)
+{
+    const int presetChannel = PianoLedConfig::globalConfig.presetChannel;
+    if (presetChannel < 0 || (presetChannel > 0 && presetChannel != channel))
+        return;
+    AllocationTracker::EventScope allocationCheck;
+    selectPreset(program);
+}
+
+void MainCoordinator::onHostConnected(bool connected)
+{
+    if (connected)
     {
-        if (!firstTimeSetup)
-            ledController.ShutdownLeds();
-        PianoLedConfig::globalConfig = newConfig;
-        ledController = FastLedController();
-        keyboardKeyToLed = KeyboardKeyToLed();
-        if (!firstTimeSetup)
-            ledController.InitializeLeds();
+        ledController.InitializeLeds();
+    }
+    else
+    {
+        ledController.ShutdownLeds();
+    }
+}
+
+void MainCoordinator::onGuideOn(uint8_t note)
+{
+    // the guide is an effect: skipped while note events storm in, the note itself still lights up when played
+    if (noteEventReducer.Overloaded())
+    {
+        noteEventReducer.ShedEffect();
+        return;
+    }
+    ledController.StageIndividualLedColors(keyboardKeyToLed.HandleGuideOn(note));
+    frameStaged = true;
+}
+
+void MainCoordinator::onGuideOff(uint8_t note)
+{
+    ledController.StageIndividualLedColors(keyboardKeyToLed.HandleGuideOff(note));
+    frameStaged = true;
+}
+
+bool MainCoordinator::applyNoteEvents(bool force)
+{
+    const uint32_t start = micros();
+    const bool applied = noteEventReducer.Flush(
+        millis(), std::max(PianoLedConfig::globalConfig.minNoteOnMs, 0), force,
+        [&](const NoteEventReducer::Change &change)
+        { ledController.StageIndividualLedColors(keyboardKeyToLed.HandleNoteOn(change.source, change.channel, change.note, change.velocity)); },
+        [&](const NoteEventReducer::Change &change)
+        { ledController.StageIndividualLedColors(keyboardKeyToLed.HandleNoteOff(change.source, change.note, 0)); });
+    noteMappingUs += micros() - start;
+    return applied;
+}
+
+void MainCoordinator::commitFrame()
+{
+    const uint32_t start = micros();
+    frameStaged = false;
+    ledController.Commit();
+    frameOutputUs += micros() - start;
+    ++frameOutputs;
+}
+
+void MainCoordinator::handleCoalesceCommand(const char *argument, Print &out)
+{
+    if (strcmp(argument, "reset") == 0)
+    {
+        noteEventReducer.ResetStats();
+        noteMappingUs = 0;
+        frameOutputUs = 0;
+        frameOutputs = 0;
+    }
+
+    const NoteEventReducer::Stats &stats = noteEventReducer.GetStats();
+    out.printf("%lu note events, %lu applied to the LEDs (%lu collapsed) in %lu frames\n", (unsigned long)stats.events,
+               (unsigned long)stats.applied, (unsigned long)stats.Collapsed(), (unsigned long)stats.frames);
+    out.printf("%lu staccato notes stretched to %d ms, %lu forced flushes, %lu effect updates shed%s\n",
+               (unsigned long)stats.stretched, PianoLedConfig::globalConfig.minNoteOnMs, (unsigned long)stats.overflows,
+               (unsigned long)stats.effectsShed, noteEventReducer.Overloaded() ? " (overloaded now)" : "");
+
+    // without the reducer, every event would have been mapped and output on its own
+    if (stats.applied > 0 && frameOutputs > 0)
+    {
+        const uint64_t mappingUs = noteMappingUs / stats.applied;
+        const uint64_t outputUs = frameOutputUs / frameOutputs;
+        const uint32_t savedOutputs = stats.events > stats.frames ? stats.events - stats.frames : 0;
+        out.printf("about %lu us per applied event and %lu us per frame output, about %lu ms saved\n", (unsigned long)mappingUs,
+                   (unsigned long)outputUs, (unsigned long)((stats.Collapsed() * mappingUs + savedOutputs * outputUs) / 1000));
+    }
+}
+
+void MainCoordinator::loadPresets()
+{
+    for (uint8_t slot = 0; slot < PresetBank::maxPresets; ++slot)
+    {
+        String name;
+        PianoLedConfig look = PianoLedConfig::globalConfig;
+        if (configManager.loadPresetFromFile(slot, name, look))
+            presetBank.Store(slot, name.c_str(), look);
+    }
+    buildPresets();
+}
+
+void MainCoordinator::buildPresets(int slot)
+{
+    const uint32_t start = micros();
+    presetBank.Build(PianoLedConfig::globalConfig, [&](NoteColorTable &table, const PianoLedConfig &config)
+                     { keyboardKeyToLed.BuildColorTable(table, config); }, slot);
+    presetBank.RecordBuild(micros() - start);
+}
+
+bool MainCoordinator::selectPreset(int slot)
+{
+    const NoteColorTable *table = slot >= 0 ? presetBank.Table(slot) : nullptr;
+    if (slot >= 0 && !table)
+        return false;
+
+    const NoteColorTable &previous = keyboardKeyToLed.Colors();
+    const uint32_t start = ARM_DWT_CYCCNT;
+    keyboardKeyToLed.SelectColorTable(table);
+    presetBank.RecordSwitch(ARM_DWT_CYCCNT - start);
+    presetBank.SetActive(slot);
+    if (!SameBackground(previous, keyboardKeyToLed.Colors()))
+        repaintUnlitLeds();
+    return true;
+}
+
+void MainCoordinator::repaintUnlitLeds()
+{
+    // held keys keep their color until they are released, the rest changes with the next frame
+    const auto &strips = PianoLedConfig::globalConfig.strips;
+    for (size_t i = 0; i < strips.size(); ++i)
+    {
+        for (int led = 0; led < strips[i].totalLeds; led += KeyboardKeyToLed::repaintChunkLeds)
+            ledController.StageIndividualLedColors(keyboardKeyToLed.RepaintUnlit(i, led, strips[i].totalLeds - led));
+    }
+    for (uint8_t note = 0; note < KeySpanTable::noteCount; ++note)
+    {
+        if (keyboardKeyToLed.Guided(note))
+            ledController.StageIndividualLedColors(keyboardKeyToLed.HandleGuideOn(note));
+    }
+    frameStaged = true;
+}
+
+void MainCoordinator::handlePresetCommand(const String &argument, Print &out)
+{
+    // <action> [<slot> [<name>]]
+    String text = argument;
+    text.trim();
+    int space = text.indexOf(' ');
+    String action = space < 0 ? text : text.substring(0, space);
+    String rest = space < 0 ? String() : text.substring(space + 1);
+    rest.trim();
+    action.toLowerCase();
+    space = rest.indexOf(' ');
+    const int slot = rest.length() > 0 && rest.charAt(0) >= '0' && rest.charAt(0) <= '9' ? rest.toInt() : -1;
+    String name = space < 0 ? String() : rest.substring(space + 1);
+    name.trim();
+
+    if (action == "bench")
+    {
+        benchmarkPresetSwitch(out);
+        return;
+    }
+    if (action == "select" && rest == "off")
+    {
+        selectPreset(-1);
+    }
+    else if (action == "select" || action == "save" || action == "delete")
+    {
+        if (slot < 0 || slot >= PresetBank::maxPresets)
+        {
+            out.printf("Preset slots are 0-%u\n", PresetBank::maxPresets - 1);
+            return;
+        }
+        if (action == "select" && !selectPreset(slot))
+        {
+            out.printf("Preset %d is empty\n", slot);
+        }
+        else if (action == "save")
+        {
+            // the look of the current configuration, e.g. as just sent by the ESP32
+            if (name.length() == 0)
+                name = "preset" + String(slot);
+            if (!configManager.savePresetToFile(slot, name.c_str(), PianoLedConfig::globalConfig))
+                out.printf("Preset %d could not be saved\n", slot);
+            presetBank.Store(slot, name.c_str(), PianoLedConfig::globalConfig);
+            buildPresets(slot);
+            if (presetBank.Active() == slot)
+                repaintUnlitLeds();
+        }
+        else if (action == "delete")
+        {
+            if (presetBank.Active() == slot)
+                selectPreset(-1);
+            configManager.removePresetFile(slot);
+            presetBank.Remove(slot);
+        }
+    }
+
+    for (uint8_t i = 0; i < PresetBank::maxPresets; ++i)
+    {
+        if (presetBank.Stored(i))
+            out.printf("%u %s%s\n", i, presetBank.Name(i), presetBank.Active() == i ? " (active)" : "");
+    }
+    const PresetBank::Stats &stats = presetBank.GetStats();
+    const uint32_t cyclesPerUs = F_CPU_ACTUAL / 1000000;
+    out.printf("%s, %lu switches (last %lu ns, max %lu ns), compiled in %lu us, Program Change %s\n",
+               presetBank.Active() < 0 ? "configuration colors active" : "preset active", (unsigned long)stats.switches,
+               (unsigned long)(stats.lastSwitchCycles * 1000 / cyclesPerUs), (unsigned long)(stats.maxSwitchCycles * 1000 / cyclesPerUs),
+               (unsigned long)stats.lastBuildUs,
+               PianoLedConfig::globalConfig.presetChannel < 0 ? "ignored"
+               : PianoLedConfig::globalConfig.presetChannel == 0 ? "on any channel"
+                                                                  : "on presetChannel");
+}
+
+void MainCoordinator::benchmarkPresetSwitch(Print &out)
+{
+    constexpr int rounds = 1000;
+    std::vector<const NoteColorTable *> tables{nullptr};
+    for (uint8_t i = 0; i < PresetBank::maxPresets; ++i)
+    {
+        if (presetBank.Stored(i))
+            tables.push_back(presetBank.Table(i));
+    }
+    if (tables.size() < 2)
+    {
+        out.println("Save a preset first (preset save <n> <name>).");
+        return;
+    }
+
+    // the pointer swap alone, then the first note on looked up in the table switched to
+    uint32_t swapCycles = 0;
+    uint32_t maxSwapCycles = 0;
+    uint32_t lookupCycles = 0;
+    uint32_t checksum = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        const NoteColorTable *table = tables[round % tables.size()];
+        uint32_t start = ARM_DWT_CYCCNT;
+        keyboardKeyToLed.SelectColorTable(table);
+        uint32_t cycles = ARM_DWT_CYCCNT - start;
+        swapCycles += cycles;
+        maxSwapCycles = std::max(maxSwapCycles, cycles);
+
+        start = ARM_DWT_CYCCNT;
+        checksum += keyboardKeyToLed.Colors().NoteOnColor(0, 1, 21 + round % 88, 1 + round % 127).r;
+        lookupCycles += ARM_DWT_CYCCNT - start;
+    }
+    keyboardKeyToLed.SelectColorTable(presetBank.Active() >= 0 ? presetBank.Table(presetBank.Active()) : nullptr);
+
+    // what a switch to a preset with other note off colors adds: repainting the unlit LEDs, output with the next frame
+    uint32_t start = micros();
+    repaintUnlitLeds();
+    const uint32_t repaintUs = micros() - start;
+
+    // what a switch would cost if the preset were compiled on demand
+    start = micros();
+    buildPresets();
+    const uint32_t buildUs = micros() - start;
+
+    const uint32_t cyclesPerUs = F_CPU_ACTUAL / 1000000;
+    out.printf("%d switches between %u tables: pointer swap avg %lu ns, max %lu ns, first note lookup avg %lu ns (checksum %lu)\n",
+               rounds, (unsigned)tables.size(), (unsigned long)(swapCycles * 1000ULL / cyclesPerUs / rounds),
+               (unsigned long)(maxSwapCycles * 1000 / cyclesPerUs), (unsigned long)(lookupCycles * 1000ULL / cyclesPerUs / rounds),
+               (unsigned long)checksum);
+    out.printf("repainting the unlit LEDs: %lu us, compiling the %u presets: %lu us\n", (unsigned long)repaintUs,
+               (unsigned)tables.size() - 1, (unsigned long)buildUs);
+}
+
+void MainCoordinator::handlePlayCommand(const String &argument, Print &out)
+{
+    String path = argument;
+    path.trim();
+    if (path == "stop")
+    {
+        midiFilePlayer.stop();
+    }
+    else if (path.length() > 0 && path != "status")
+    {
+        FS *fileSystem = configManager.fileSystem();
+        if (path.startsWith("sd:"))
+        {
+            path = path.substring(3);
+            sdReady = sdReady || SD.begin(BUILTIN_SDCARD);
+            fileSystem = sdReady ? &SD : nullptr;
+        }
+        if (!fileSystem || !midiFilePlayer.play(*fileSystem, path.c_str()))
+            out.printf("Cannot play %s\n", path.c_str());
+    }
+
+    if (midiFilePlayer.playing())
+        out.printf("playing, at %lu ms\n", (unsigned long)midiFilePlayer.positionMs());
+    else
+        out.println("not playing");
+}
+
+void MainCoordinator::handleLedStreamCommand(const String &argument, Print &out)
+{
+    String action = argument;
+    action.trim();
+    action.toLowerCase();
+    if (action == "start")
+        ledStateStream.start();
+    else if (action == "stop")
+        ledStateStream.stop();
+    else if (action == "keyframe")
+        ledStateStream.requestKeyframe();
+
+    const LedStateStream::Stats &stats = ledStateStream.stats();
+    out.printf("LED stream: %s, every %lu ms, %lu updates (%lu keyframes, %lu cut short), %lu lines, %lu bytes\n",
+               ledStateStream.streaming() ? "on" : "off", (unsigned long)ledStateStream.intervalMs(), (unsigned long)stats.updates,
+               (unsigned long)stats.keyframes, (unsigned long)stats.cutShort, (unsigned long)stats.lines, (unsigned long)stats.bytes);
+}
+
+void MainCoordinator::handleSourcesCommand(const char *argument, Print &out)
+{
+    MidiSources &sources = midiHostManager.midiSources();
+    if (strcmp(argument, "reset") == 0)
+        sources.ResetStats();
+
+    auto printList = [&](const std::vector<uint8_t> &list)
+    {
+        if (list.empty())
+            out.print(" all");
+        for (size_t i = 0; i < list.size(); ++i)
+            out.printf(i == 0 ? " %u" : ",%u", list[i]);
     };
+    const auto &routes = PianoLedConfig::globalConfig.sourceRoutes;
+    for (uint8_t source = 0; source < MidiSources::count; ++source)
+    {
+        bool routed = source < routes.size() && (!routes[source].strips.empty() || !routes[source].zones.empty());
+        bool connected = source < MidiSources::hostDeviceCount && midiHostManager.hostDeviceConnected(source);
+        if (!routed && !connected && sources.Events(source) == 0)
+            continue;
+        char name[8];
+        MidiSources::Name(source, name, sizeof(name));
+        out.printf("%2u %-7s %-9s %8lu events, strips", source, name, connected ? "connected" : "",
+                   (unsigned long)sources.Events(source));
+        printList(routed ? routes[source].strips : std::vector<uint8_t>());
+        out.print(", zones");
+        printList(routed ? routes[source].zones : std::vector<uint8_t>());
+        out.println();
+    }
+    for (uint8_t port = 0; port < MidiSources::portCount; ++port)
+    {
+        const MidiSources::PortStats &stats = sources.Port(port);
+        if (stats.polls == 0)
+            continue;
+        char name[8];
+        if (port == MidiSources::devicePort)
+            snprintf(name, sizeof(name), "device");
+        else
+            MidiSources::Name(MidiSources::HostDevice(port), name, sizeof(name));
+        out.printf("port %-7s %lu polls, %lu deferred, at most %lu events per poll\n", name, (unsigned long)stats.polls,
+                   (unsigned long)stats.deferred, (unsigned long)stats.maxEventsPerPoll);
+    }
+}
+
+void MainCoordinator::handleThruCommand(const char *argument, Print &out)
+{
+    MidiThru &thru = midiHostManager.midiThru();
+    if (strcmp(argument, "reset") == 0)
+        thru.ResetStats();
+
+    const PianoLedConfig &config = PianoLedConfig::globalConfig;
+    out.printf("transpose %+d", config.thruTranspose);
+    if (config.thruChannel > 0)
+        out.printf(", all on channel %d", config.thruChannel);
+    if (config.thruSplitNote >= 0)
+        out.printf(", split below note %d to channel %d transposed %+d", config.thruSplitNote, config.thruSplitChannel,
+                   config.thruSplitTranspose);
+    out.printf(", velocity curve %s, LEDs follow the %s notes\n", config.thruVelocityCurve.empty() ? "off" : "on",
+               thru.LedsFollow() ? "routed" : "played");
+
+    const MidiThru::Stats &stats = thru.GetStats();
+    const uint32_t cyclesPerUs = F_CPU_ACTUAL / 1000000;
+    out.printf("%lu messages (%lu dropped, %lu duplicated to the split), latency avg %lu ns, max %lu ns, %lu over the %lu us budget\n",
+               (unsigned long)stats.messages, (unsigned long)stats.dropped, (unsigned long)stats.duplicated,
+               (unsigned long)(stats.messages ? stats.totalCycles * 1000 / cyclesPerUs / stats.messages : 0),
+               (unsigned long)(stats.maxCycles * 1000 / cyclesPerUs), (unsigned long)stats.overruns,
+               (unsigned long)MidiThru::latencyBudgetUs);
+}
+
+void MainCoordinator::handleRecordCommand(const String &argument, Print &out)
+{
+    String action = argument;
+    action.trim();
+    action.toLowerCase();
+    if (action == "start" && !midiRecorder.start())
+        out.println("Recording could not be started.");
+    else if (action == "stop")
+        midiRecorder.stop();
+    midiRecorder.printStatus(out);
 }
 
 void MainCoordinator::begin()
@@ -78,11 +731,26 @@ void MainCoordinator::begin()
     pinMode(LED_BUILTIN, OUTPUT);
 
     configManager.begin();
+    loadPresets();
+    midiRecorder.begin(configManager.fileSystem());
     midiHostManager.begin();
+    // started last, the delays above are part of booting
+    loopMonitor.configure();
 }
 
 void MainCoordinator::loop()
 {
-    midiHostManager.loop();
-    configManager.loop();
+    EventTrace::Poll();
+    loopMonitor.beginIteration();
+    scheduler.runOnce();
+
+#if defined(PIANO_LED_ALLOCATION_CHECK)
+    if (AllocationTracker::EventsAllocated() != reportedAllocatingEvents)
+    {
+        reportedAllocatingEvents = AllocationTracker::EventsAllocated();
+        Serial.printf("ALLOCATION CHECK FAILED: a MIDI event made %lu allocations (%lu bytes), %lu of %lu events allocated\n",
+                      (unsigned long)AllocationTracker::LastEventAllocations(), (unsigned long)AllocationTracker::LastEventBytes(),
+                      (unsigned long)reportedAllocatingEvents, (unsigned long)AllocationTracker::EventsChecked());
+    }
+#endif
 }
\ No newline at end of file
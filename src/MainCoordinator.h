@@ -1,10 +1,24 @@
 #ifndef MAINCOORDINATOR_H
 #define MAINCOORDINATOR_H
 
+#if defined(PIANO_LED_DMA_OUTPUT)
+#include "DmaLedController.h"
+#include "OctoWs2811DmaEngine.h"
+#else
 #include "FastLedController.h"
+#endif
 #include "MidiHostManager.h"
 #include "KeyboardKeyToLed.h"
 #include "ConfigManager.h"
+#include "SerialConsole.h"
+#include "VelocityCalibration.h"
+#include "MidiRecorder.h"
+#include "MidiFilePlayer.h"
+#include "LoopMonitor.h"
+#include "TaskScheduler.h"
+#include "LedStateStream.h"
+#include "NoteEventReducer.h"
+#include "PresetBank.h"
 
 class MainCoordinator
 {
@@ -15,10 +29,67 @@ public:
     void loop();
 
 private:
-    MidiHostManager midiHostManager;
+    // MIDI event sink, see MidiEventSink.h
+    friend class MidiEventDispatcher<MainCoordinator>;
+    friend class MidiFilePlayer<MainCoordinator>;
+    void onChannelMessage(uint8_t status, uint8_t data1, uint8_t data2);
+    void onNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity);
+    void onNoteOff(uint8_t source, uint8_t note, uint8_t velocity);
+    void onControlChange(uint8_t cc, uint8_t value);
+    void onProgramChange(uint8_t channel, uint8_t program);
+    void onHostConnected(bool connected);
+    void onGuideOn(uint8_t note);
+    void onGuideOff(uint8_t note);
+
+    void handleRecordCommand(const String &argument, Print &out);
+    void handlePlayCommand(const String &argument, Print &out);
+    void handleLedStreamCommand(const String &argument, Print &out);
+    void handleThruCommand(const char *argument, Print &out);
+    void handleSourcesCommand(const char *argument, Print &out);
+    void handleCoalesceCommand(const char *argument, Print &out);
+    void handlePresetCommand(const String &argument, Print &out);
+    void loadPresets();
+    void buildPresets(int slot = -1);
+    bool selectPreset(int slot);
+    void repaintUnlitLeds();
+    void benchmarkPresetSwitch(Print &out);
+    bool applyNoteEvents(bool force);
+    void commitFrame();
+    void addTasks();
+
+    /**
+     * How often the LEDs are refreshed while temporal dithering is enabled.
+     */
+    static constexpr uint32_t ditherRefreshIntervalMs = 10;
+
+    MidiHostManager<MainCoordinator> midiHostManager;
     ConfigManager configManager;
     KeyboardKeyToLed keyboardKeyToLed;
+#if defined(PIANO_LED_DMA_OUTPUT)
+    OctoWs2811DmaEngine dmaEngine;
+    DmaLedController ledController;
+#else
     FastLedController ledController;
+#endif
+    SerialConsole serialConsole;
+    VelocityCalibration velocityCalibration;
+    MidiRecorder midiRecorder;
+    MidiFilePlayer<MainCoordinator> midiFilePlayer;
+    LoopMonitor loopMonitor;
+    TaskScheduler scheduler;
+    LedStateStream ledStateStream;
+    NoteEventReducer noteEventReducer;
+    PresetBank presetBank;
+    bool frameStaged = false; // LEDs were drawn but not output yet
+
+    // what applying note events and outputting frames took, for the time saved by the reducer
+    uint64_t noteMappingUs = 0;
+    uint64_t frameOutputUs = 0;
+    uint32_t frameOutputs = 0;
+    bool sdReady = false;
+#if defined(PIANO_LED_ALLOCATION_CHECK)
+    uint32_t reportedAllocatingEvents = 0;
+#endif
 };
 
 #endif // MAINCOORDINATOR_H
\ No newline at end of file
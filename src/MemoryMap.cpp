@@ -0,0 +1,108 @@
+#include "MemoryMap.h"
+
+MemoryMap::Entry MemoryMap::entries[MemoryMap::maxEntries];
+size_t MemoryMap::entryCount = 0;
+
+MemoryMap::Region MemoryMap::RegionOf(const void *address)
+{
+#if defined(__IMXRT1062__)
+    uintptr_t a = reinterpret_cast<uintptr_t>(address);
+    if (a < 0x00080000)
+        return Region::Itcm;
+    if (a >= 0x20000000 && a < 0x20080000)
+        return Region::Dtcm;
+    if (a >= 0x20200000 && a < 0x20280000)
+        return Region::Ocram;
+    if (a >= 0x60000000 && a < 0x70000000)
+        return Region::Flash;
+    if (a >= 0x70000000 && a < 0x80000000)
+        return Region::ExtMem;
+#endif
+    return Region::Unknown;
+}
+
+const char *MemoryMap::RegionName(Region region)
+{
+    switch (region)
+    {
+    case Region::Itcm:
+        return "ITCM";
+    case Region::Dtcm:
+        return "DTCM";
+    case Region::Ocram:
+        return "OCRAM";
+    case Region::ExtMem:
+        return "EXTMEM";
+    case Region::Flash:
+        return "Flash";
+    default:
+        return "unknown";
+    }
+}
+
+void MemoryMap::Record(const char *subsystem, const void *data, size_t capacityBytes, size_t usedBytes)
+{
+    Entry entry{subsystem, RegionOf(data), capacityBytes, usedBytes};
+    for (size_t i = 0; i < entryCount; ++i)
+    {
+        if (entries[i].subsystem == subsystem)
+        {
+            entries[i] = entry;
+            return;
+        }
+    }
+    if (entryCount < maxEntries)
+        entries[entryCount++] = entry;
+}
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+#include "AllocationTracker.h"
+
+#if defined(__IMXRT1062__)
+// Section boundaries from the Teensy 4 linker script
+extern "C" unsigned long _stext;
+extern "C" unsigned long _etext;
+extern "C" unsigned long _sdata;
+extern "C" unsigned long _ebss;
+extern "C" unsigned long _heap_start;
+extern "C" unsigned long _heap_end;
+extern "C" unsigned long _estack;
+#endif
+
+void MemoryMap::Report(Print &out)
+{
+    static const Region regions[] = {Region::Itcm, Region::Dtcm, Region::Ocram, Region::ExtMem, Region::Flash, Region::Unknown};
+    for (Region region : regions)
+    {
+        size_t capacity = 0;
+        size_t used = 0;
+        for (size_t i = 0; i < entryCount; ++i)
+        {
+            if (entries[i].region != region)
+                continue;
+            if (capacity == 0 && used == 0)
+                out.printf("%s:\n", RegionName(region));
+            out.printf("  %-24s %7lu bytes, %7lu used\n", entries[i].subsystem, (unsigned long)entries[i].capacityBytes,
+                       (unsigned long)entries[i].usedBytes);
+            capacity += entries[i].capacityBytes;
+            used += entries[i].usedBytes;
+        }
+        if (capacity > 0 || used > 0)
+            out.printf("  %-24s %7lu bytes, %7lu used\n", "total", (unsigned long)capacity, (unsigned long)used);
+    }
+
+#if defined(__IMXRT1062__)
+    char *stackPointer = (char *)__builtin_frame_address(0);
+    out.printf("ITCM code: %lu bytes\n", (unsigned long)((char *)&_etext - (char *)&_stext));
+    out.printf("DTCM data+bss: %lu bytes, stack: %lu bytes in use, %lu bytes free\n",
+               (unsigned long)((char *)&_ebss - (char *)&_sdata), (unsigned long)((char *)&_estack - stackPointer),
+               (unsigned long)(stackPointer - (char *)&_ebss));
+    out.printf("OCRAM DMAMEM: %lu bytes, heap: %lu of %lu bytes taken by the allocator\n",
+               (unsigned long)((char *)&_heap_start - (char *)0x20200000), (unsigned long)AllocationTracker::Heap().arenaBytes,
+               (unsigned long)((char *)&_heap_end - (char *)&_heap_start));
+#endif
+}
+
+#endif // ARDUINO
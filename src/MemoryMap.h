@@ -0,0 +1,66 @@
+#ifndef MEMORY_MAP_H
+#define MEMORY_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+class Print;
+
+/**
+ * Where the big buffers of the firmware live, for the `memory` console command.
+ *
+ * The Teensy 4.1 has three RAM regions with different trade-offs:
+ * - DTCM (RAM1, default for global and static data): single cycle, never cached, so DMA needs no cache maintenance.
+ *   Used for everything touched per note event or per frame: frame buffers, LUTs, key map and color tables.
+ * - OCRAM (RAM2, DMAMEM and the heap): behind the data cache. Used for DMA buffers that are only touched in bulk
+ *   (the owners flush the cache before starting the DMA) and for configuration data.
+ * - EXTMEM (optional PSRAM): unused.
+ *
+ * Subsystems report their statically sized buffers with \ref Record; the region is derived from the address.
+ * The build-time counterpart is the linker map (firmware.map in the build directory, see platformio.ini).
+ */
+class MemoryMap
+{
+public:
+    enum class Region
+    {
+        Itcm,
+        Dtcm,
+        Ocram,
+        ExtMem,
+        Flash,
+        Unknown, // host builds
+    };
+
+    static constexpr size_t maxEntries = 24;
+
+    static Region RegionOf(const void *address);
+    static const char *RegionName(Region region);
+
+    /**
+     * Reports that \p subsystem owns \p capacityBytes at \p data, \p usedBytes of which the current configuration
+     * needs. Recording the same subsystem again replaces its entry.
+     * @param subsystem string literal, entries are matched by pointer.
+     */
+    static void Record(const char *subsystem, const void *data, size_t capacityBytes, size_t usedBytes);
+
+    /**
+     * Prints the recorded buffers grouped by region, followed by the region totals from the linker.
+     * Only available in Arduino builds.
+     */
+    static void Report(Print &out);
+
+private:
+    struct Entry
+    {
+        const char *subsystem;
+        Region region;
+        size_t capacityBytes;
+        size_t usedBytes;
+    };
+
+    static Entry entries[maxEntries];
+    static size_t entryCount;
+};
+
+#endif // MEMORY_MAP_H
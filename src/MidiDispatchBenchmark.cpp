@@ -0,0 +1,59 @@
+#include "MidiDispatchBenchmark.h"
+#include "MidiEventDispatcher.h"
+#include "MidiEventSink.h"
+#include "PianoLedConfig.h"
+
+namespace
+{
+    constexpr int events = 1024;
+
+    // Does the same small amount of work for both variants, so only the dispatch differs
+    struct CountingSink
+    {
+        uint32_t checksum = 0;
+
+        void onChannelMessage(uint8_t status, uint8_t data1, uint8_t data2) {}
+        void onNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity) { checksum += note ^ velocity ^ channel; }
+        void onNoteOff(uint8_t source, uint8_t note, uint8_t velocity) { checksum += note; }
+        void onControlChange(uint8_t cc, uint8_t value) { checksum += cc ^ value; }
+        void onProgramChange(uint8_t channel, uint8_t program) { checksum += program; }
+        void onHostConnected(bool connected) {}
+    };
+
+    template <typename Sink>
+    uint32_t Measure(Sink &sink, uint8_t channel)
+    {
+        MidiEventDispatcher<Sink> dispatcher(sink);
+        uint32_t start = ARM_DWT_CYCCNT;
+        for (int i = 0; i < events; i += 2)
+        {
+            uint8_t note = 21 + (i >> 1) % 88;
+            dispatcher.noteOn(0, channel, note, 1 + i % 127);
+            dispatcher.noteOff(0, channel, note, 0);
+        }
+        return (ARM_DWT_CYCCNT - start) / events;
+    }
+}
+
+void MidiDispatchBenchmark::Run(Print &out)
+{
+    auto &channels = PianoLedConfig::globalConfig.midiChannelsToListen;
+    uint8_t channel = channels.empty() ? 1 : channels.front();
+
+    CountingSink staticSink;
+    uint32_t staticCycles = Measure(staticSink, channel);
+
+    CountingSink target;
+    FunctionMidiSink functionSink;
+    functionSink.onNoteOnCallback = [&](uint8_t source, uint8_t c, uint8_t note, uint8_t velocity)
+    { target.onNoteOn(source, c, note, velocity); };
+    functionSink.onNoteOffCallback = [&](uint8_t source, uint8_t note, uint8_t velocity)
+    { target.onNoteOff(source, note, velocity); };
+    uint32_t functionCycles = Measure(functionSink, channel);
+
+    out.printf("MIDI dispatch, %d events on channel %u (%u channels listened):\n", events, channel, (unsigned)channels.size());
+    out.printf("  static sink   %4lu cycles/event\n", (unsigned long)staticCycles);
+    out.printf("  std::function %4lu cycles/event\n", (unsigned long)functionCycles);
+    if (staticSink.checksum != target.checksum)
+        out.println("  checksum mismatch!");
+}
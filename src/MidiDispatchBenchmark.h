@@ -0,0 +1,16 @@
+#ifndef MIDI_DISPATCH_BENCHMARK_H
+#define MIDI_DISPATCH_BENCHMARK_H
+
+#include <Arduino.h>
+
+/**
+ * On-device microbenchmark for the MIDI event path: dispatching to a sink known at compile time versus through
+ * the std::function adapter (FunctionMidiSink). Prints cycles per event for both.
+ */
+class MidiDispatchBenchmark
+{
+public:
+    static void Run(Print &out);
+};
+
+#endif // MIDI_DISPATCH_BENCHMARK_H
@@ -0,0 +1,74 @@
+#ifndef MIDI_EVENT_DISPATCHER_H
+#define MIDI_EVENT_DISPATCHER_H
+
+#include <algorithm>
+#include <cstdint>
+#include "PianoLedConfig.h"
+
+/**
+ * Filters incoming MIDI events by PianoLedConfig::midiChannelsToListen and forwards them to \p Sink
+ * (see MidiEventSink.h). Independent of the USB host, so the event path can be driven from tests and benchmarks.
+ */
+template <typename Sink>
+class MidiEventDispatcher
+{
+public:
+    explicit MidiEventDispatcher(Sink &sink) : sink(sink) {}
+
+    /**
+     * @param source MIDI source ID, see MidiSources.h.
+     * @param channel MIDI channel, 1-16.
+     */
+    void noteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)
+    {
+        sink.onChannelMessage(0x90 | ((channel - 1) & 0x0F), note, velocity);
+        if (velocity == 0)
+        {
+            if (listensTo(channel))
+                sink.onNoteOff(source, note, 0);
+            return;
+        }
+        if (listensTo(channel))
+            sink.onNoteOn(source, channel, note, velocity);
+    }
+
+    void noteOff(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)
+    {
+        sink.onChannelMessage(0x80 | ((channel - 1) & 0x0F), note, velocity);
+        if (listensTo(channel))
+            sink.onNoteOff(source, note, velocity);
+    }
+
+    void controlChange(uint8_t channel, uint8_t cc, uint8_t value)
+    {
+        sink.onChannelMessage(0xB0 | ((channel - 1) & 0x0F), cc, value);
+        if (listensTo(channel))
+            sink.onControlChange(cc, value);
+    }
+
+    /**
+     * Program changes select presets on their own channel (PianoLedConfig::presetChannel), so they are passed on
+     * from every channel.
+     */
+    void programChange(uint8_t channel, uint8_t program)
+    {
+        sink.onChannelMessage(0xC0 | ((channel - 1) & 0x0F), program, 0);
+        sink.onProgramChange(channel, program);
+    }
+
+    void hostConnected(bool connected)
+    {
+        sink.onHostConnected(connected);
+    }
+
+private:
+    Sink &sink;
+
+    static bool listensTo(uint8_t channel)
+    {
+        auto &channels = PianoLedConfig::globalConfig.midiChannelsToListen;
+        return std::find(channels.begin(), channels.end(), channel) != channels.end();
+    }
+};
+
+#endif // MIDI_EVENT_DISPATCHER_H
@@ -0,0 +1,69 @@
+#ifndef MIDI_EVENT_SINK_H
+#define MIDI_EVENT_SINK_H
+
+#include <cstdint>
+#include <functional>
+
+/**
+ * MIDI events are delivered to a sink type known at compile time (see \ref MidiEventDispatcher), so the whole chain
+ * from USB MIDI parsing to rendering can be inlined. A sink provides these member functions:
+ *
+ *     void onChannelMessage(uint8_t status, uint8_t data1, uint8_t data2); // every event as received, before filtering
+ *     void onNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity); // channel 1-16, velocity > 0
+ *     void onNoteOff(uint8_t source, uint8_t note, uint8_t velocity);
+ *     void onControlChange(uint8_t cc, uint8_t value);
+ *     void onProgramChange(uint8_t channel, uint8_t program); // channel 1-16, not filtered by channel
+ *     void onHostConnected(bool connected);
+ *
+ * where source is the MIDI source ID of the event (see MidiSources.h).
+ *
+ * FunctionMidiSink adapts the sink to std::function callbacks, for tests and tools where the indirection does not
+ * matter.
+ */
+struct FunctionMidiSink
+{
+    std::function<void(uint8_t status, uint8_t data1, uint8_t data2)> onChannelMessageCallback;
+    std::function<void(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)> onNoteOnCallback;
+    std::function<void(uint8_t source, uint8_t note, uint8_t velocity)> onNoteOffCallback;
+    std::function<void(uint8_t cc, uint8_t value)> onControlChangeCallback;
+    std::function<void(uint8_t channel, uint8_t program)> onProgramChangeCallback;
+    std::function<void(bool connected)> onHostConnectedCallback;
+
+    void onChannelMessage(uint8_t status, uint8_t data1, uint8_t data2)
+    {
+        if (onChannelMessageCallback)
+            onChannelMessageCallback(status, data1, data2);
+    }
+
+    void onNoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)
+    {
+        if (onNoteOnCallback)
+            onNoteOnCallback(source, channel, note, velocity);
+    }
+
+    void onNoteOff(uint8_t source, uint8_t note, uint8_t velocity)
+    {
+        if (onNoteOffCallback)
+            onNoteOffCallback(source, note, velocity);
+    }
+
+    void onControlChange(uint8_t cc, uint8_t value)
+    {
+        if (onControlChangeCallback)
+            onControlChangeCallback(cc, value);
+    }
+
+    void onProgramChange(uint8_t channel, uint8_t program)
+    {
+        if (onProgramChangeCallback)
+            onProgramChangeCallback(channel, program);
+    }
+
+    void onHostConnected(bool connected)
+    {
+        if (onHostConnectedCallback)
+            onHostConnectedCallback(connected);
+    }
+};
+
+#endif // MIDI_EVENT_SINK_H
@@ -0,0 +1,190 @@
+#ifndef MIDI_FILE_PLAYER_H
+#define MIDI_FILE_PLAYER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <algorithm>
+#include <array>
+#include "MemoryMap.h"
+#include "MidiSources.h"
+#include "PianoLedConfig.h"
+#include "SmfReader.h"
+
+/**
+ * SmfSource reading from a file on LittleFS or the SD card.
+ */
+class FileSmfSource : public SmfSource
+{
+public:
+    void SetFile(File file) { this->file = file; }
+    void Close() { file.close(); }
+
+    size_t Read(uint32_t offset, uint8_t *buffer, size_t count) override
+    {
+        if (!file || !file.seek(offset))
+            return 0;
+        int read = file.read(buffer, count);
+        return read > 0 ? read : 0;
+    }
+
+private:
+    File file;
+};
+
+/**
+ * Plays a Standard MIDI File through the same LED pipeline as live MIDI, by delivering its notes to \p Sink.
+ * Besides the MIDI sink methods (see MidiEventSink.h; onChannelMessage and onHostConnected are not used) the sink
+ * provides
+ *
+ *     void onGuideOn(uint8_t note);  // note is played in PianoLedConfig::guideLookaheadMs
+ *     void onGuideOff(uint8_t note); // guide ended without the note being played
+ *
+ * The file is streamed by SmfReader. For the guide, a second reader runs ahead of the playback position by the
+ * lookahead time over the same file.
+ */
+template <typename Sink>
+class MidiFilePlayer
+{
+public:
+    /**
+     * Events delivered per \ref loop call at most, so a dense passage does not hold up the main loop.
+     */
+    static constexpr int maxEventsPerLoop = 64;
+
+    explicit MidiFilePlayer(Sink &sink)
+        : sink(sink), active(false), hasEvent(false), hasGuideEvent(false), positionUs(0), lastMicros(0)
+    {
+    }
+
+    /**
+     * Starts playing \p path from \p fileSystem, stopping a playback in progress.
+     */
+    bool play(FS &fileSystem, const char *path)
+    {
+        stop();
+        File file = fileSystem.open(path, FILE_READ);
+        if (!file)
+            return false;
+        source.SetFile(file);
+        if (!reader.Open(source) || !guideReader.Open(source))
+        {
+            source.Close();
+            return false;
+        }
+
+        heldNotes.fill(0);
+        guidedNotes.fill(false);
+        hasEvent = reader.Next(event);
+        hasGuideEvent = guideReader.Next(guideEvent);
+        positionUs = 0;
+        lastMicros = micros();
+        active = true;
+        MemoryMap::Record("MIDI file player", this, sizeof(*this), sizeof(*this));
+        return true;
+    }
+
+    /**
+     * Stops playing and releases all notes and guides.
+     */
+    void stop()
+    {
+        if (!active)
+            return;
+        active = false;
+        source.Close();
+        for (uint8_t note = 0; note < heldNotes.size(); ++note)
+        {
+            for (; heldNotes[note] > 0; --heldNotes[note])
+                sink.onNoteOff(MidiSources::player, note, 0);
+            if (guidedNotes[note])
+            {
+                guidedNotes[note] = false;
+                sink.onGuideOff(note);
+            }
+        }
+    }
+
+    bool playing() const { return active; }
+    uint64_t positionMs() const { return positionUs / 1000; }
+
+    void loop()
+    {
+        if (!active)
+            return;
+
+        uint32_t now = micros();
+        positionUs += now - lastMicros;
+        lastMicros = now;
+
+        uint64_t lookaheadUs = static_cast<uint64_t>(std::max(PianoLedConfig::globalConfig.guideLookaheadMs, 0)) * 1000;
+        for (int i = 0; lookaheadUs > 0 && hasGuideEvent && guideEvent.timeUs <= positionUs + lookaheadUs && i < maxEventsPerLoop; ++i)
+        {
+            uint8_t note = guideEvent.data1 & 0x7F;
+            if (isNoteOn(guideEvent) && guideEvent.timeUs > positionUs && !guidedNotes[note])
+            {
+                guidedNotes[note] = true;
+                sink.onGuideOn(note);
+            }
+            hasGuideEvent = guideReader.Next(guideEvent);
+        }
+
+        for (int i = 0; hasEvent && event.timeUs <= positionUs && i < maxEventsPerLoop; ++i)
+        {
+            deliver(event);
+            hasEvent = reader.Next(event);
+        }
+
+        if (!hasEvent)
+            stop();
+    }
+
+private:
+    Sink &sink;
+    FileSmfSource source;
+    SmfReader reader;
+    SmfReader guideReader;
+    SmfReader::Event event;
+    SmfReader::Event guideEvent;
+    bool active;
+    bool hasEvent;
+    bool hasGuideEvent;
+    uint64_t positionUs;
+    uint32_t lastMicros;
+    std::array<uint8_t, 128> heldNotes;
+    std::array<bool, 128> guidedNotes;
+
+    static bool isNoteOn(const SmfReader::Event &e) { return (e.status & 0xF0) == 0x90 && e.data2 > 0; }
+
+    void deliver(const SmfReader::Event &e)
+    {
+        uint8_t channel = (e.status & 0x0F) + 1;
+        uint8_t note = e.data1 & 0x7F;
+        switch (e.status & 0xF0)
+        {
+        case 0x90:
+            if (e.data2 > 0)
+            {
+                // the note on replaces the guide
+                guidedNotes[note] = false;
+                ++heldNotes[note];
+                sink.onNoteOn(MidiSources::player, channel, note, e.data2);
+                break;
+            }
+            // fall through: note on with velocity 0 is a note off
+        case 0x80:
+            if (heldNotes[note] > 0)
+            {
+                --heldNotes[note];
+                sink.onNoteOff(MidiSources::player, note, e.data2);
+            }
+            break;
+        case 0xB0:
+            sink.onControlChange(e.data1, e.data2);
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+#endif // MIDI_FILE_PLAYER_H
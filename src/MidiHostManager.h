@@ -1,41 +1,231 @@
 #ifndef MIDIHOSTMANAGER_H
 #define MIDIHOSTMANAGER_H
 
+#include <array>
 #include <Control_Surface.h>
 #include <MIDI_Interfaces/USBHostMIDI_Interface.hpp>
+#include "MidiEventDispatcher.h"
+#include "MidiEventSink.h"
+#include "MidiSources.h"
+#include "MidiThru.h"
 
+/**
+ * Receives MIDI from the USB MIDI devices on the host port (the piano, and more keyboards or controllers through the
+ * hub) and from the cables of the USB device port, and delivers the events to \p Sink tagged with their source ID
+ * (see MidiSources.h). The ports are drained in the fair order of MidiSources.
+ * The sink type is a template parameter, so the calls from Control Surface's callbacks into the sink are resolved
+ * at compile time and can be inlined. Use FunctionMidiSink for std::function callbacks.
+ *
+ * What the host port devices play is forwarded to the USB device port through the MidiThru routing, everything from
+ * the device port goes to the host port devices unchanged.
+ */
+template <typename Sink>
 class MidiHostManager
 {
 public:
-    MidiHostManager();
+    explicit MidiHostManager(Sink &sink)
+        : dispatcher(sink),
+          hub(usb),
+          hostmidi{HostInterface{usb}, HostInterface{usb}, HostInterface{usb}, HostInterface{usb}},
+          hostConnected(false)
+    {
+        static_assert(MidiSources::hostDeviceCount == 4, "hostmidi has one initializer per host device");
+        for (uint8_t i = 0; i < MidiSources::hostDeviceCount; ++i)
+        {
+            hostCallbacks[i].attach(*this, i);
+            thruPipes[i].attach(*this, i);
+        }
+        deviceCallbacks.attach(*this, MidiSources::devicePort);
+    }
+
+    void begin()
+    {
+        usb.begin();
+        for (uint8_t i = 0; i < MidiSources::hostDeviceCount; ++i)
+        {
+            hostmidi[i].setCallbacks(hostCallbacks[i]);
+            hostmidi[i] >> thruPipes[i] >> devicemidi;
+            devicemidi >> returnPipes[i] >> hostmidi[i];
+        }
+        devicemidi.setCallbacks(deviceCallbacks);
+        if (!anyHostDeviceConnected())
+        {
+            delay(1500);
+            dispatcher.hostConnected(false);
+        }
+    }
+
+    void loop()
+    {
+        bool connected = anyHostDeviceConnected();
+        if (connected != hostConnected)
+        {
+            hostConnected = connected;
+            dispatcher.hostConnected(hostConnected);
+        }
+
+        // the cables of the device port are sources of their own, so it is polled without a host port device too
+        sources.Drain([&](uint8_t port)
+                      {
+                          if (port == MidiSources::devicePort)
+                              devicemidi.update();
+                          else if (hostDeviceConnected(port))
+                              hostmidi[port].update();
+                      });
+    }
 
-    std::function<void(uint8_t note, uint8_t velocity)> onNoteOnCallback;
-    std::function<void(uint8_t note, uint8_t velocity)> onNoteOffCallback;
-    std::function<void(uint8_t cc, uint8_t value)> onControlChangeCallback;
-    std::function<void(bool connected)> onHostConnectedCallback;
+    /**
+     * Applies the MIDI thru settings of the global config.
+     */
+    void configureThru() { thru.Build(PianoLedConfig::globalConfig); }
 
-    void begin();
-    void loop();
+    MidiThru &midiThru() { return thru; }
+    MidiSources &midiSources() { return sources; }
+
+    bool hostDeviceConnected(uint8_t index) { return index < MidiSources::hostDeviceCount && hostmidi[index].backend.backend; }
 
 private:
+    using HostInterface = GenericUSBMIDI_Interface<USBHostMIDIBackend<512>>;
+
     struct LedMidiCallbacks : FineGrainedMIDI_Callbacks<LedMidiCallbacks>
     {
-        explicit LedMidiCallbacks(MidiHostManager &owner);
-        void onNoteOn(Channel channel, uint8_t note, uint8_t velocity, Cable cable);
-        void onNoteOff(Channel channel, uint8_t note, uint8_t velocity, Cable cable);
-        void onControlChange(Channel channel, uint8_t cc, uint8_t value, Cable cable);
-        MidiHostManager &owner;
-    } callbacks;
+        /**
+         * @param port Index of the host port device, or MidiSources::devicePort.
+         */
+        void attach(MidiHostManager &manager, uint8_t port)
+        {
+            owner = &manager;
+            this->port = port;
+        }
+
+        uint8_t source(Cable cable) const { return port == MidiSources::devicePort ? MidiSources::DeviceCable(cable.getRaw()) : port; }
+
+        // with PianoLedConfig::ledFollowsThru the host port's events reach the LEDs through the thru pipe instead
+        bool skip(uint8_t source) const
+        {
+            owner->sources.CountEvent(source);
+            return port != MidiSources::devicePort && owner->thru.LedsFollow();
+        }
+
+        void onNoteOn(Channel channel, uint8_t note, uint8_t velocity, Cable cable)
+        {
+            const uint8_t id = source(cable);
+            if (!skip(id))
+                owner->dispatcher.noteOn(id, channel.getOneBased(), note, velocity);
+        }
+
+        void onNoteOff(Channel channel, uint8_t note, uint8_t velocity, Cable cable)
+        {
+            const uint8_t id = source(cable);
+            if (!skip(id))
+                owner->dispatcher.noteOff(id, channel.getOneBased(), note, velocity);
+        }
+
+        void onControlChange(Channel channel, uint8_t cc, uint8_t value, Cable cable)
+        {
+            const uint8_t id = source(cable);
+            if (!skip(id))
+                owner->dispatcher.controlChange(channel.getOneBased(), cc, value);
+        }
+
+        void onProgramChange(Channel channel, uint8_t program, Cable cable)
+        {
+            const uint8_t id = source(cable);
+            if (!skip(id))
+                owner->dispatcher.programChange(channel.getOneBased(), program);
+        }
+
+        MidiHostManager *owner = nullptr;
+        uint8_t port = 0;
+    };
+
+    /**
+     * Routes a host port device's channel messages through \ref thru on their way to the USB device port. The
+     * message is rewritten in place and handed on before the LEDs are updated, so the LED work never delays the
+     * forwarded MIDI.
+     */
+    struct MidiThruPipe : MIDI_Pipe
+    {
+        void attach(MidiHostManager &manager, uint8_t hostDevice)
+        {
+            owner = &manager;
+            source = MidiSources::HostDevice(hostDevice);
+        }
+
+        using MIDI_Pipe::mapForwardMIDI;
 
-    boolean VerifyChannel(Channel *channel);
+        void mapForwardMIDI(ChannelMessage msg) override
+        {
+            const uint32_t start = ARM_DWT_CYCCNT;
+            MidiThru &thru = owner->thru;
+            uint8_t copyStatus = 0;
+            const uint8_t count = thru.Apply(msg.header, msg.data1, msg.data2, copyStatus);
+            const uint8_t status = msg.header;
+            if (count > 0)
+                sourceMIDItoSink(msg);
+            if (count > 1)
+            {
+                msg.header = copyStatus;
+                sourceMIDItoSink(msg);
+            }
+            thru.RecordLatency(ARM_DWT_CYCCNT - start, F_CPU_ACTUAL / 1000000);
+
+            if (!thru.LedsFollow())
+                return;
+            if (count > 0)
+                dispatch(status, msg.data1, msg.data2);
+            if (count > 1)
+                dispatch(copyStatus, msg.data1, msg.data2);
+        }
+
+        void dispatch(uint8_t status, uint8_t data1, uint8_t data2)
+        {
+            const uint8_t channel = (status & 0x0F) + 1;
+            switch (status & 0xF0)
+            {
+            case 0x90:
+                owner->dispatcher.noteOn(source, channel, data1, data2);
+                break;
+            case 0x80:
+                owner->dispatcher.noteOff(source, channel, data1, data2);
+                break;
+            case 0xB0:
+                owner->dispatcher.controlChange(channel, data1, data2);
+                break;
+            case 0xC0:
+                owner->dispatcher.programChange(channel, data1);
+                break;
+            }
+        }
+
+        MidiHostManager *owner = nullptr;
+        uint8_t source = 0;
+    };
+
+    MidiEventDispatcher<Sink> dispatcher;
+    MidiSources sources;
+    std::array<LedMidiCallbacks, MidiSources::hostDeviceCount> hostCallbacks;
+    LedMidiCallbacks deviceCallbacks;
+    MidiThru thru;
+    std::array<MidiThruPipe, MidiSources::hostDeviceCount> thruPipes;
+    std::array<MIDI_Pipe, MidiSources::hostDeviceCount> returnPipes;
 
     USBHost usb;
     USBHub hub;
-    GenericUSBMIDI_Interface<USBHostMIDIBackend<512>> hostmidi{usb};
+    HostInterface hostmidi[MidiSources::hostDeviceCount];
     USBMIDI_Interface devicemidi;
-    BidirectionalMIDI_Pipe p;
 
-    static boolean hostConnected;
+    bool hostConnected;
+
+    bool anyHostDeviceConnected()
+    {
+        for (uint8_t i = 0; i < MidiSources::hostDeviceCount; ++i)
+        {
+            if (hostDeviceConnected(i))
+                return true;
+        }
+        return false;
+    }
 };
 
-#endif // MIDIHOSTMANAGER_H
\ No newline at end of file
+#endif // MIDIHOSTMANAGER_H
@@ -0,0 +1,175 @@
+#include "MidiRecorder.h"
+#include "MemoryMap.h"
+#include "EventTrace.h"
+
+namespace
+{
+    // 500 ticks per quarter note at the default tempo of 500000 us per quarter note: 1 tick = 1 ms
+    constexpr uint16_t ticksPerQuarterNote = 500;
+    constexpr uint32_t tempoUsPerQuarterNote = 500000;
+    constexpr uint32_t usPerTick = tempoUsPerQuarterNote / ticksPerQuarterNote;
+
+    // the track length is patched in when the recording is finished
+    constexpr uint32_t trackLengthOffset = 18;
+
+    size_t WriteVariableLength(uint8_t *out, uint32_t value)
+    {
+        uint8_t bytes[4];
+        size_t count = 0;
+        do
+        {
+            bytes[count++] = value & 0x7F;
+            value >>= 7;
+        } while (value && count < sizeof(bytes));
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = bytes[count - 1 - i] | (i + 1 < count ? 0x80 : 0);
+        }
+        return count;
+    }
+}
+
+MidiRecorder::MidiRecorder()
+    : fileSystem(nullptr), fileName{}, state(State::Idle), head(0), tail(0), lastEventMs(0), lastWrittenUs(0), pendingUs(0), trackBytes(0), recordedEvents(0), droppedEvents(0), writeErrors(0)
+{
+}
+
+void MidiRecorder::begin(FS *fileSystem)
+{
+    this->fileSystem = fileSystem;
+    MemoryMap::Record("MIDI recorder ring", ring.data(), sizeof(ring), sizeof(ring));
+}
+
+bool MidiRecorder::start()
+{
+    if (state != State::Idle || !fileSystem)
+        return false;
+
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        snprintf(fileName, sizeof(fileName), "/rec%03u.mid", i);
+        if (!fileSystem->exists(fileName))
+            break;
+    }
+    // only happens when all names are taken, then the last recording is overwritten
+    fileSystem->remove(fileName);
+    file = fileSystem->open(fileName, FILE_WRITE_BEGIN);
+    if (!file)
+        return false;
+
+    head = 0;
+    tail = 0;
+    pendingUs = 0;
+    trackBytes = 0;
+    recordedEvents = 0;
+    droppedEvents = 0;
+    writeErrors = 0;
+
+    const uint8_t header[] = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6,
+        0, 0, // format 0
+        0, 1, // one track
+        ticksPerQuarterNote >> 8, ticksPerQuarterNote & 0xFF,
+        'M', 'T', 'r', 'k', 0, 0, 0, 0};
+    const uint8_t tempo[] = {0, 0xFF, 0x51, 3, (tempoUsPerQuarterNote >> 16) & 0xFF, (tempoUsPerQuarterNote >> 8) & 0xFF,
+                             tempoUsPerQuarterNote & 0xFF};
+    state = State::Recording;
+    if (!writeBytes(header, sizeof(header)) || !writeBytes(tempo, sizeof(tempo)))
+        return false;
+    trackBytes = sizeof(tempo);
+
+    lastWrittenUs = micros();
+    lastEventMs = millis();
+    return true;
+}
+
+void MidiRecorder::stop()
+{
+    if (state == State::Recording)
+        state = State::Finishing;
+}
+
+void MidiRecorder::loop()
+{
+    if (state == State::Idle)
+        return;
+
+    uint32_t buffered = head - tail;
+    if (buffered > 0 &&
+        (state == State::Finishing || buffered >= ringCapacity / 2 || millis() - lastEventMs >= flushIdleMs))
+    {
+        writeSlice();
+    }
+
+    if (state == State::Finishing && head == tail)
+        finish();
+}
+
+void MidiRecorder::writeSlice()
+{
+    // delta time (at most 4 bytes) + 3 message bytes per event
+    uint8_t buffer[flushSliceEvents * 7];
+    size_t length = 0;
+    for (size_t i = 0; i < flushSliceEvents && tail != head; ++i, ++tail)
+    {
+        const Event &event = ring[tail & (ringCapacity - 1)];
+        pendingUs += event.timeUs - lastWrittenUs;
+        lastWrittenUs = event.timeUs;
+        length += WriteVariableLength(buffer + length, pendingUs / usPerTick);
+        pendingUs %= usPerTick;
+        buffer[length++] = event.status;
+        buffer[length++] = event.data1;
+        buffer[length++] = event.data2;
+        ++recordedEvents;
+    }
+
+    if (writeBytes(buffer, length))
+        trackBytes += length;
+}
+
+void MidiRecorder::finish()
+{
+    const uint8_t endOfTrack[] = {0, 0xFF, 0x2F, 0};
+    if (!writeBytes(endOfTrack, sizeof(endOfTrack)))
+        return;
+    trackBytes += sizeof(endOfTrack);
+
+    const uint8_t length[] = {static_cast<uint8_t>(trackBytes >> 24), static_cast<uint8_t>(trackBytes >> 16),
+                              static_cast<uint8_t>(trackBytes >> 8), static_cast<uint8_t>(trackBytes)};
+    if (!file.seek(trackLengthOffset))
+    {
+        writeFailed();
+        return;
+    }
+    if (!writeBytes(length, sizeof(length)))
+        return;
+    file.close();
+    state = State::Idle;
+}
+
+bool MidiRecorder::writeBytes(const uint8_t *data, size_t count)
+{
+    EventTrace::Scope trace(EventTrace::Id::FlashWrite, count);
+    if (file.write(data, count) == count)
+        return true;
+
+    // the file system is probably full; keep what was written so far
+    writeFailed();
+    return false;
+}
+
+void MidiRecorder::writeFailed()
+{
+    ++writeErrors;
+    file.close();
+    state = State::Idle;
+}
+
+void MidiRecorder::printStatus(Print &out) const
+{
+    const char *stateName = state == State::Recording ? "recording" : state == State::Finishing ? "finishing" : "idle";
+    out.printf("recorder: %s, file %s\n", stateName, fileName[0] ? fileName : "-");
+    out.printf("events written: %lu, buffered: %lu, dropped: %lu, write errors: %lu\n", (unsigned long)recordedEvents,
+               (unsigned long)(head - tail), (unsigned long)droppedEvents, (unsigned long)writeErrors);
+}
@@ -0,0 +1,114 @@
+#ifndef MIDI_RECORDER_H
+#define MIDI_RECORDER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <array>
+#include <cstdint>
+
+/**
+ * Records the played MIDI events into Standard MIDI Files (format 0, 1 tick = 1 ms) on the LittleFS of the
+ * ConfigManager, named /rec000.mid, /rec001.mid, ...
+ *
+ * Events are appended from the MIDI callbacks to a fixed-size ring buffer, which only copies 8 bytes. Writing to
+ * flash stalls the CPU, so \ref loop only writes to the file while the player pauses (or when the ring buffer runs
+ * full), and at most \ref flushSliceEvents events at a time. Events that arrive while the ring buffer is full are
+ * dropped and counted.
+ */
+class MidiRecorder
+{
+public:
+    static constexpr size_t ringCapacity = 1024; // events, power of two
+    static constexpr size_t flushSliceEvents = 64;
+
+    /**
+     * The ring buffer is only written out after this long without events, unless it is half full.
+     */
+    static constexpr uint32_t flushIdleMs = 250;
+
+    MidiRecorder();
+
+    /**
+     * @param fileSystem where the recordings are stored, nullptr if none is available.
+     */
+    void begin(FS *fileSystem);
+
+    /**
+     * Writes buffered events to the file. Call from the main loop.
+     */
+    void loop();
+
+    /**
+     * Starts a new recording. Returns false if no file could be created.
+     */
+    bool start();
+
+    /**
+     * Stops recording. The remaining events are written and the file is closed by the following \ref loop calls.
+     */
+    void stop();
+
+    bool recording() const { return state == State::Recording; }
+
+    /**
+     * Appends a channel message (note on/off, control change) with the current time. Constant time, never blocks.
+     */
+    void record(uint8_t status, uint8_t data1, uint8_t data2)
+    {
+        if (state != State::Recording)
+            return;
+        if (head - tail == ringCapacity)
+        {
+            ++droppedEvents;
+            return;
+        }
+        ring[head & (ringCapacity - 1)] = {micros(), status, data1, data2};
+        ++head;
+        lastEventMs = millis();
+    }
+
+    void printStatus(Print &out) const;
+
+private:
+    enum class State
+    {
+        Idle,
+        Recording,
+        Finishing, // stopped, but buffered events still need to be written
+    };
+
+    struct Event
+    {
+        uint32_t timeUs;
+        uint8_t status;
+        uint8_t data1;
+        uint8_t data2;
+    };
+
+    static_assert((ringCapacity & (ringCapacity - 1)) == 0, "ringCapacity must be a power of two");
+
+    FS *fileSystem;
+    File file;
+    char fileName[16];
+    State state;
+
+    std::array<Event, ringCapacity> ring;
+    uint32_t head; // written by record
+    uint32_t tail; // written by loop
+    uint32_t lastEventMs;
+
+    uint32_t lastWrittenUs;
+    uint32_t pendingUs; // time since the last written event that is not a full tick yet
+    uint32_t trackBytes;
+
+    uint32_t recordedEvents;
+    uint32_t droppedEvents;
+    uint32_t writeErrors;
+
+    void writeSlice();
+    void finish();
+    bool writeBytes(const uint8_t *data, size_t count);
+    void writeFailed();
+};
+
+#endif // MIDI_RECORDER_H
@@ -0,0 +1,136 @@
+#ifndef MIDI_SOURCES_H
+#define MIDI_SOURCES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Where MIDI events come from, as a source ID:
+ *
+ *     0-3   USB MIDI devices on the host port (through the hub), in the order the USB host driver claims them
+ *     4-19  cables 1-16 of the USB device port (the computer)
+ *     20    the MIDI file player
+ *
+ * PianoLedConfig::sourceRoutes decides per source which strips and color zones it drives.
+ *
+ * The USB MIDI interfaces ("ports": each host device, and the device port with all its cables) are polled in a
+ * rotating order by \ref Drain. A port that delivered more than \ref burstEvents in its last poll while another port
+ * had events too is skipped every other pass, so a chatty controller cannot starve the others; its events wait in
+ * the USB buffers (flow controlled, nothing is lost) meanwhile.
+ */
+class MidiSources
+{
+public:
+    static constexpr uint8_t hostDeviceCount = 4;
+    static constexpr uint8_t deviceCableCount = 16;
+    static constexpr uint8_t player = hostDeviceCount + deviceCableCount;
+    static constexpr uint8_t count = player + 1;
+
+    static constexpr uint8_t portCount = hostDeviceCount + 1; // the device port is the last one
+    static constexpr uint8_t devicePort = hostDeviceCount;
+    static constexpr uint32_t burstEvents = 32;
+
+    struct PortStats
+    {
+        uint32_t polls = 0;
+        uint32_t deferred = 0; // polls skipped to let other ports through
+        uint32_t maxEventsPerPoll = 0;
+    };
+
+    static constexpr uint8_t HostDevice(uint8_t index) { return index; }
+    static constexpr uint8_t DeviceCable(uint8_t cable) { return hostDeviceCount + (cable & 0x0F); }
+
+    static uint8_t PortOf(uint8_t source) { return source < hostDeviceCount ? source : devicePort; }
+
+    /**
+     * Writes a short name of \p source ("usb1", "cable3", "player") to \p out.
+     */
+    static void Name(uint8_t source, char *out, size_t size)
+    {
+        if (source < hostDeviceCount)
+            snprintf(out, size, "usb%u", source + 1);
+        else if (source < player)
+            snprintf(out, size, "cable%u", source - hostDeviceCount + 1);
+        else
+            snprintf(out, size, "player");
+    }
+
+    MidiSources()
+        : nextFirstPort(0)
+    {
+        events.fill(0);
+        lastPollEvents.fill(0);
+        deferredLastPass.fill(false);
+    }
+
+    void CountEvent(uint8_t source)
+    {
+        if (source < count)
+            ++events[source];
+    }
+
+    /**
+     * Polls every port once with \p poll(port), in a rotating order, skipping a port that hogs the input (see above).
+     */
+    template <typename Poll>
+    void Drain(Poll &&poll)
+    {
+        uint32_t lastPassEvents = 0;
+        for (uint32_t e : lastPollEvents)
+            lastPassEvents += e;
+
+        const uint8_t first = nextFirstPort;
+        nextFirstPort = (nextFirstPort + 1) % portCount;
+        for (uint8_t i = 0; i < portCount; ++i)
+        {
+            const uint8_t port = (first + i) % portCount;
+            PortStats &stats = ports[port];
+            const bool othersBusy = lastPassEvents > lastPollEvents[port];
+            if (lastPollEvents[port] > burstEvents && othersBusy && !deferredLastPass[port])
+            {
+                deferredLastPass[port] = true;
+                ++stats.deferred;
+                continue;
+            }
+            deferredLastPass[port] = false;
+
+            const uint32_t before = PortEvents(port);
+            poll(port);
+            lastPollEvents[port] = PortEvents(port) - before;
+            ++stats.polls;
+            if (lastPollEvents[port] > stats.maxEventsPerPoll)
+                stats.maxEventsPerPoll = lastPollEvents[port];
+        }
+    }
+
+    uint32_t Events(uint8_t source) const { return source < count ? events[source] : 0; }
+    const PortStats &Port(uint8_t port) const { return ports[port]; }
+
+    void ResetStats()
+    {
+        events.fill(0);
+        lastPollEvents.fill(0);
+        ports = {};
+    }
+
+private:
+    std::array<uint32_t, count> events;
+    std::array<uint32_t, portCount> lastPollEvents;
+    std::array<bool, portCount> deferredLastPass;
+    std::array<PortStats, portCount> ports;
+    uint8_t nextFirstPort;
+
+    uint32_t PortEvents(uint8_t port) const
+    {
+        if (port < hostDeviceCount)
+            return events[port];
+        uint32_t sum = 0;
+        for (uint8_t cable = 0; cable < deviceCableCount; ++cable)
+            sum += events[DeviceCable(cable)];
+        return sum;
+    }
+};
+
+#endif // MIDI_SOURCES_H
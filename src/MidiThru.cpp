@@ -0,0 +1,46 @@
+#include "MidiThru.h"
+#include "MemoryMap.h"
+
+MidiThru::MidiThru()
+    : ledsFollow(false)
+{
+    Build(PianoLedConfig());
+}
+
+void MidiThru::Build(const PianoLedConfig &config)
+{
+    const bool split = config.thruSplitNote >= 0 && config.thruSplitNote < noteCount;
+    const bool remap = config.thruChannel >= 1 && config.thruChannel <= channelCount;
+    const uint8_t lowerChannel = (config.thruSplitChannel - 1) & 0x0F;
+
+    for (int channel = 0; channel < channelCount; ++channel)
+    {
+        const uint8_t upperChannel = remap ? config.thruChannel - 1 : channel;
+        channelRoutes[channel] = upperChannel;
+        splitChannels[channel] = split && lowerChannel != upperChannel ? lowerChannel : noSplit;
+
+        for (int note = 0; note < noteCount; ++note)
+        {
+            const bool lower = split && note < config.thruSplitNote;
+            const int routed = note + (lower ? config.thruSplitTranspose : config.thruTranspose);
+            NoteRoute &route = noteRoutes[channel * noteCount + note];
+            route = NoteRoute();
+            if (routed >= 0 && routed < noteCount)
+            {
+                route.channel = lower ? lowerChannel : upperChannel;
+                route.note = routed;
+            }
+        }
+    }
+
+    const bool curve = config.thruVelocityCurve.size() == static_cast<size_t>(noteCount);
+    for (int velocity = 0; velocity < noteCount; ++velocity)
+    {
+        int mapped = curve ? config.thruVelocityCurve[velocity] : velocity;
+        // a note on with velocity 0 would be a note off
+        velocityMap[velocity] = mapped < 1 ? 1 : mapped > 127 ? 127 : mapped;
+    }
+
+    ledsFollow = config.ledFollowsThru;
+    MemoryMap::Record("MIDI thru routes", this, sizeof(*this), sizeof(*this));
+}
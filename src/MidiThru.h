@@ -0,0 +1,125 @@
+#ifndef MIDI_THRU_H
+#define MIDI_THRU_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "PianoLedConfig.h"
+
+/**
+ * The routing stage between the piano (USB host port) and the computer (USB device port): transpose, channel remap,
+ * keyboard split and velocity curve, configured by the thru* keys of PianoLedConfig.
+ *
+ * All of it is compiled into lookup tables by \ref Build, so \ref Apply is a few array accesses that rewrite the
+ * message in place, whatever is configured. Where a note-on was routed to is remembered until its note-off, so changing
+ * the routing while keys are held never leaves a note hanging on the receiving side.
+ */
+class MidiThru
+{
+public:
+    static constexpr int channelCount = 16;
+    static constexpr int noteCount = 128;
+
+    /**
+     * What a forwarded message may take from its arrival at the pipe until it is handed to the USB device port.
+     * Slower messages are counted as overruns.
+     */
+    static constexpr uint32_t latencyBudgetUs = 20;
+
+    struct Stats
+    {
+        uint32_t messages = 0;
+        uint32_t dropped = 0;     // notes transposed out of the MIDI range
+        uint32_t duplicated = 0;  // controllers sent to both halves of a split
+        uint32_t overruns = 0;    // messages slower than latencyBudgetUs
+        uint32_t maxCycles = 0;
+        uint64_t totalCycles = 0;
+    };
+
+    MidiThru();
+
+    /**
+     * Compiles the routing of \p config. Notes held at that moment keep the routing they were started with.
+     */
+    void Build(const PianoLedConfig &config);
+
+    /**
+     * Routes one channel message, rewriting it in place.
+     * @return 0 to drop the message, 1 to send it, 2 to send it and then a copy with the status \p copyStatus (for
+     * controllers and pressure on a split channel, which apply to both halves).
+     */
+    uint8_t Apply(uint8_t &status, uint8_t &data1, uint8_t &data2, uint8_t &copyStatus)
+    {
+        const uint8_t type = status & 0xF0;
+        const uint8_t channel = status & 0x0F;
+        if (type == 0x80 || type == 0x90 || type == 0xA0)
+        {
+            const size_t index = channel * noteCount + (data1 & 0x7F);
+            const bool noteOn = type == 0x90 && data2 > 0;
+            NoteRoute route = noteOn || !heldRoutes[index].Valid() ? noteRoutes[index] : heldRoutes[index];
+            if (noteOn)
+            {
+                heldRoutes[index] = route;
+                data2 = velocityMap[data2 & 0x7F];
+            }
+            else if (type != 0xA0)
+            {
+                heldRoutes[index] = NoteRoute();
+            }
+            if (!route.Valid())
+            {
+                ++counters.dropped;
+                return 0;
+            }
+            status = type | route.channel;
+            data1 = route.note;
+            return 1;
+        }
+
+        status = type | channelRoutes[channel];
+        if (splitChannels[channel] == noSplit || (type != 0xB0 && type != 0xD0 && type != 0xE0))
+            return 1;
+        copyStatus = type | splitChannels[channel];
+        ++counters.duplicated;
+        return 2;
+    }
+
+    /**
+     * Whether the LEDs show the routed notes (PianoLedConfig::ledFollowsThru) instead of the ones played.
+     */
+    bool LedsFollow() const { return ledsFollow; }
+
+    void RecordLatency(uint32_t cycles, uint32_t cyclesPerUs)
+    {
+        ++counters.messages;
+        counters.totalCycles += cycles;
+        if (cycles > counters.maxCycles)
+            counters.maxCycles = cycles;
+        if (cycles > latencyBudgetUs * cyclesPerUs)
+            ++counters.overruns;
+    }
+
+    const Stats &GetStats() const { return counters; }
+    void ResetStats() { counters = Stats(); }
+
+private:
+    static constexpr uint8_t noSplit = 0xFF;
+
+    struct NoteRoute
+    {
+        uint8_t channel = 0xFF; // 0-15, 0xFF drops the note
+        uint8_t note = 0;
+
+        bool Valid() const { return channel != 0xFF; }
+    };
+
+    std::array<NoteRoute, channelCount * noteCount> noteRoutes;
+    std::array<NoteRoute, channelCount * noteCount> heldRoutes; // where the sounding notes were sent
+    std::array<uint8_t, channelCount> channelRoutes;            // channel of everything but notes
+    std::array<uint8_t, channelCount> splitChannels;            // lower split channel to copy controllers to, or noSplit
+    std::array<uint8_t, noteCount> velocityMap;
+    bool ledsFollow;
+    Stats counters;
+};
+
+#endif // MIDI_THRU_H
@@ -0,0 +1,66 @@
+#ifndef MOCK_LED_DMA_ENGINE_H
+#define MOCK_LED_DMA_ENGINE_H
+
+#include <cstring>
+#include <vector>
+#include "LedDmaEngine.h"
+
+/**
+ * Host stand-in for the DMA hardware, used to exercise the double-buffer handoff of \ref DmaLedController
+ * off-device. A transfer stays "in flight" until \ref CompleteTransfer simulates the DMA completion interrupt.
+ */
+class MockLedDmaEngine : public ILedDmaEngine
+{
+public:
+    bool Begin(size_t ledsPerStrip, const std::vector<uint8_t> &pins) override
+    {
+        frameBytes = ledsPerStrip * pins.size() * 3;
+        inFlight = false;
+        transmitted.clear();
+        brightnesses.clear();
+        return true;
+    }
+
+    bool Busy() override
+    {
+        return inFlight;
+    }
+
+    void Transmit(const uint8_t *rgbFrame, uint8_t brightness) override
+    {
+        // the real engines encode into their own buffer; copy so the caller may keep drawing
+        transmitted.emplace_back(rgbFrame, rgbFrame + frameBytes);
+        brightnesses.push_back(brightness);
+        transmitOverlaps += inFlight ? 1 : 0;
+        inFlight = true;
+    }
+
+    /**
+     * Finishes the transfer in flight, as the DMA completion interrupt would.
+     */
+    void CompleteTransfer()
+    {
+        inFlight = false;
+    }
+
+    /**
+     * Every frame handed to the engine, in order.
+     */
+    std::vector<std::vector<uint8_t>> transmitted;
+
+    /**
+     * Brightness each frame in \ref transmitted was handed over with.
+     */
+    std::vector<uint8_t> brightnesses;
+
+    /**
+     * Transmit calls made while a transfer was still in flight. Must stay 0.
+     */
+    unsigned transmitOverlaps = 0;
+
+private:
+    size_t frameBytes = 0;
+    bool inFlight = false;
+};
+
+#endif // MOCK_LED_DMA_ENGINE_H
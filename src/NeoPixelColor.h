@@ -1,26 +1,18 @@
 #ifndef NEO_PIXEL_COLOR_H
 #define NEO_PIXEL_COLOR_H
 
-#include <string>
-#include <sstream>
-#include <iomanip>
+#include <functional>
 #include "LedColor.h"
 
 struct NeoPixelColor {
     int stripNumber; // The strip number this LED belongs to
     int ledNumber;
-    std::string hexColor;
     LedColor ledColor;
     int brightness;
+    int ledCount; // number of consecutive LEDs, starting at ledNumber, that get this color
 
-    NeoPixelColor(int stripNumber, int ledNumber, const LedColor& ledColor, int brightness = 128)
-        : stripNumber(stripNumber), ledNumber(ledNumber), ledColor(ledColor), brightness(brightness) {
-          std::stringstream ss;
-          ss << std::setw(2) << std::setfill('0') << std::hex << ledColor.r
-            << std::setw(2) << std::setfill('0') << std::hex << ledColor.g
-            << std::setw(2) << std::setfill('0') << std::hex << ledColor.b;
-          hexColor = ss.str();  // Convert to HEX without '#'
-        }
+    NeoPixelColor(int stripNumber, int ledNumber, const LedColor& ledColor, int brightness = 128, int ledCount = 1)
+        : stripNumber(stripNumber), ledNumber(ledNumber), ledColor(ledColor), brightness(brightness), ledCount(ledCount) {}
 
     // Equality comparison
     bool operator==(const NeoPixelColor& other) const {
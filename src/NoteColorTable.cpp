@@ -0,0 +1,117 @@
+#include "NoteColorTable.h"
+#include <algorithm>
+
+namespace
+{
+    uint8_t ToByte(int channel)
+    {
+        return static_cast<uint8_t>(std::min(std::max(channel, 0), 255));
+    }
+}
+
+NoteColorTable::NoteColorTable()
+    : schemeCount(1), noteOffBrightness(0), guideBrightness(0)
+{
+    schemes[0] = Scheme{true, {}};
+    for (auto &index : schemeIndex)
+        index.fill(0);
+    sourceZoneSet.fill(0);
+}
+
+void NoteColorTable::Build(const PianoLedConfig &config, int lowestNote, int highestNote)
+{
+    schemes[0] = Compile(config.colorPalette, config.colorLayout, config.colorCurve, config.colorInterpolation,
+                         config.velocityCurve, lowestNote, highestNote);
+    schemeCount = 1;
+    noteOffColor = config.noteOffColor;
+    noteOffBrightness = config.noteOffColorBrightness;
+    guideColor = config.guideColor;
+    guideBrightness = config.guideColorBrightness;
+
+    size_t zoneCount = std::min(config.colorZones.size(), static_cast<size_t>(PianoLedConfig::maxColorZones));
+    std::array<uint8_t, PianoLedConfig::maxColorZones> zoneScheme{};
+    for (size_t z = 0; z < zoneCount; ++z)
+    {
+        const PianoLedConfig::ColorZone &zone = config.colorZones[z];
+        int low = std::max(zone.lowestNote, 0);
+        int high = std::min(zone.highestNote, noteCount - 1);
+        if (low > high)
+            continue;
+        zoneScheme[z] = schemeCount++;
+        schemes[zoneScheme[z]] = Compile(zone.colorPalette.empty() ? config.colorPalette : zone.colorPalette, zone.colorLayout,
+                                         zone.colorCurve ? zone.colorCurve : config.colorCurve, zone.colorInterpolation,
+                                         config.velocityCurve, std::max(low, lowestNote), std::min(high, highestNote));
+    }
+
+    // the zone subset (bit z for zone z) of every zone set, set 0 being all zones
+    const uint32_t allZones = (1u << PianoLedConfig::maxColorZones) - 1;
+    std::array<uint32_t, maxZoneSets> zoneSets{allZones};
+    size_t zoneSetCount = 1;
+    sourceZoneSet.fill(0);
+    for (size_t source = 0; source < config.sourceRoutes.size() && source < sourceZoneSet.size(); ++source)
+    {
+        const std::vector<uint8_t> &zones = config.sourceRoutes[source].zones;
+        if (zones.empty())
+            continue;
+        uint32_t mask = 0;
+        for (uint8_t z : zones)
+            mask |= z < PianoLedConfig::maxColorZones ? 1u << z : 0;
+        size_t set = std::find(zoneSets.begin(), zoneSets.begin() + zoneSetCount, mask) - zoneSets.begin();
+        if (set == zoneSetCount && zoneSetCount < maxZoneSets)
+            zoneSets[zoneSetCount++] = mask;
+        sourceZoneSet[source] = set < zoneSetCount ? set : 0;
+    }
+
+    for (size_t set = 0; set < zoneSetCount; ++set)
+    {
+        auto &index = schemeIndex[set];
+        index.fill(0);
+        // Later zones are applied first, so that where zones overlap, the first one wins
+        for (size_t z = zoneCount; z-- > 0;)
+        {
+            const PianoLedConfig::ColorZone &zone = config.colorZones[z];
+            if (zoneScheme[z] == 0 || !(zoneSets[set] & 1u << z))
+                continue;
+            int low = std::max(zone.lowestNote, 0);
+            int high = std::min(zone.highestNote, noteCount - 1);
+            for (int channel = 1; channel <= channelCount; ++channel)
+            {
+                if (!zone.midiChannels.empty() &&
+                    std::find(zone.midiChannels.begin(), zone.midiChannels.end(), channel) == zone.midiChannels.end())
+                    continue;
+                for (int key = (channel - 1) * noteCount + low; key <= (channel - 1) * noteCount + high; ++key)
+                {
+                    const int shift = (key & 1) * 4;
+                    index[key / 2] = (index[key / 2] & ~(0x0F << shift)) | zoneScheme[z] << shift;
+                }
+            }
+        }
+    }
+}
+
+NoteColorTable::Scheme NoteColorTable::Compile(const std::vector<LedColor> &palette, PianoLedConfig::LedStripColorLayout layout,
+                                               const std::function<double(double)> &curve, GradientColorMapping::Interpolation interpolation,
+                                               const std::vector<uint8_t> &velocityCurve, int lowestNote, int highestNote)
+{
+    Scheme scheme;
+    scheme.velocityBased = layout == PianoLedConfig::LedStripColorLayout::VelocityBased;
+    auto mapping = curve ? curve : std::function<double(double)>(GradientColorMapping::Linear);
+    for (int i = 0; i < noteCount; ++i)
+    {
+        LedColor color;
+        if (scheme.velocityBased)
+        {
+            int velocity = velocityCurve.size() == static_cast<size_t>(noteCount) ? velocityCurve[i] : i;
+            color = GradientColorMapping::Map(velocity, 128, mapping, palette, interpolation);
+        }
+        else
+        {
+            // position of the note within the key range, clamped so notes outside of it take the end colors
+            int position = std::min(std::max(i, lowestNote), std::max(highestNote, lowestNote + 1)) - lowestNote + 1;
+            int range = std::max(highestNote - lowestNote + 1, 2);
+            color = GradientColorMapping::Map(position, range, mapping, palette, interpolation);
+        }
+        scheme.colors[i] = {ToByte(color.r), ToByte(color.g), ToByte(color.b)};
+    }
+    return scheme;
+}
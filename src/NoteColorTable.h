@@ -0,0 +1,88 @@
+#ifndef NOTE_COLOR_TABLE_H
+#define NOTE_COLOR_TABLE_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "LedColor.h"
+#include "MidiSources.h"
+#include "PianoLedConfig.h"
+
+/**
+ * The note on colors of all color zones, compiled into one table per (MIDI channel, note).
+ *
+ * All gradient math happens in \ref Build, when the configuration is applied. Looking up a color is then three
+ * array accesses, no matter how many zones are configured. The table has a fixed size, so it lives wherever its owner
+ * does (DTCM for the global coordinator). Colors are stored as 3 bytes and the scheme per (channel, note) as 4 bits,
+ * which keeps a table at about 7.5 KB, as a preset bank holds several of them.
+ *
+ * Sources that are routed to a subset of the zones (PianoLedConfig::sourceRoutes) get a zone index of their own;
+ * sources with the same subset share one. Beyond \ref maxZoneSets different subsets, sources use all zones.
+ *
+ * The note off and guide colors are part of the table too, so a table holds everything a preset (see PresetBank.h)
+ * changes.
+ */
+class NoteColorTable
+{
+public:
+    static constexpr int channelCount = 16;
+    static constexpr int noteCount = 128;
+    static constexpr size_t maxZoneSets = 4;
+
+    NoteColorTable();
+
+    /**
+     * Compiles the global color scheme and the color zones of \p config, including its velocity curve.
+     * @param lowestNote, highestNote The notes that have LEDs; NoteBased gradients are spread over these.
+     */
+    void Build(const PianoLedConfig &config, int lowestNote, int highestNote);
+
+    /**
+     * @param source MIDI source ID, see MidiSources.h.
+     * @param channel MIDI channel, 1-16.
+     */
+    LedColor NoteOnColor(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity) const
+    {
+        const auto &index = schemeIndex[source < sourceZoneSet.size() ? sourceZoneSet[source] : 0];
+        const size_t key = ((channel - 1) & 0x0F) * noteCount + (note & 0x7F);
+        const Scheme &scheme = schemes[(index[key / 2] >> (key & 1) * 4) & 0x0F];
+        const PackedColor &color = scheme.colors[(scheme.velocityBased ? velocity : note) & 0x7F];
+        return LedColor(color.r, color.g, color.b);
+    }
+
+    const LedColor &NoteOffColor() const { return noteOffColor; }
+    int NoteOffBrightness() const { return noteOffBrightness; }
+    const LedColor &GuideColor() const { return guideColor; }
+    int GuideBrightness() const { return guideBrightness; }
+
+private:
+    struct PackedColor
+    {
+        uint8_t r, g, b;
+    };
+
+    struct Scheme
+    {
+        bool velocityBased;
+        std::array<PackedColor, noteCount> colors; // per velocity or per note
+    };
+
+    // schemes[0] is the global color scheme, the following ones belong to the color zones
+    std::array<Scheme, 1 + PianoLedConfig::maxColorZones> schemes;
+    static_assert(1 + PianoLedConfig::maxColorZones <= 16, "scheme numbers are stored in 4 bits");
+    size_t schemeCount;
+    // schemeIndex[0] uses all zones, the others the zone subsets some sources are routed to. Two (channel, note) keys
+    // per byte, the even one in the low nibble.
+    std::array<std::array<uint8_t, channelCount * noteCount / 2>, maxZoneSets> schemeIndex;
+    std::array<uint8_t, MidiSources::count> sourceZoneSet;
+    LedColor noteOffColor;
+    int noteOffBrightness;
+    LedColor guideColor;
+    int guideBrightness;
+
+    static Scheme Compile(const std::vector<LedColor> &palette, PianoLedConfig::LedStripColorLayout layout,
+                          const std::function<double(double)> &curve, GradientColorMapping::Interpolation interpolation,
+                          const std::vector<uint8_t> &velocityCurve, int lowestNote, int highestNote);
+};
+
+#endif // NOTE_COLOR_TABLE_H
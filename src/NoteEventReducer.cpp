@@ -0,0 +1,76 @@
+#include "NoteEventReducer.h"
+#include "MemoryMap.h"
+
+NoteEventReducer::NoteEventReducer()
+    : entryCount(0), frameEvents(0), lastFrameEvents(0)
+{
+    held.fill(0);
+    MemoryMap::Record("note event reducer", this, sizeof(*this), sizeof(*this));
+}
+
+bool NoteEventReducer::NoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    Entry *entry = Find(source, note, true);
+    if (!entry)
+        return false;
+    ++counters.events;
+    ++frameEvents;
+    entry->change.channel = channel;
+    entry->change.velocity = velocity;
+    if (entry->target < 255)
+        ++entry->target;
+    entry->sawOn = true;
+    return true;
+}
+
+bool NoteEventReducer::NoteOff(uint8_t source, uint8_t note)
+{
+    Entry *entry = Find(source, note, false);
+    if (!entry)
+    {
+        // a release of a key that is neither held nor pending changes nothing, there is no need to store it
+        if (held[Index(source, note)] == 0)
+        {
+            ++counters.events;
+            return true;
+        }
+        entry = Find(source, note, true);
+        if (!entry)
+            return false;
+    }
+    ++counters.events;
+    ++frameEvents;
+    if (entry->target > 0)
+        --entry->target;
+    entry->sawOff = true;
+    return true;
+}
+
+void NoteEventReducer::Reset()
+{
+    entryCount = 0;
+    held.fill(0);
+}
+
+NoteEventReducer::Entry *NoteEventReducer::Find(uint8_t source, uint8_t note, bool create)
+{
+    for (size_t i = 0; i < entryCount; ++i)
+    {
+        if (entries[i].change.source == source && entries[i].change.note == note)
+            return &entries[i];
+    }
+    if (!create)
+        return nullptr;
+    if (entryCount == capacity)
+    {
+        ++counters.overflows;
+        return nullptr;
+    }
+
+    Entry &entry = entries[entryCount++];
+    entry = Entry();
+    entry.change.source = source;
+    entry.change.note = note;
+    entry.target = held[Index(source, note)];
+    return &entry;
+}
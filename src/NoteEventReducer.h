@@ -0,0 +1,183 @@
+#ifndef NOTE_EVENT_REDUCER_H
+#define NOTE_EVENT_REDUCER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "MidiSources.h"
+
+/**
+ * Collects the note events that arrive between two LED frames and reduces them to the net change per key, so a
+ * glissando, a MIDI file dump or a stuck controller costs one key mapping per changed key and one output per frame
+ * instead of a mapping and an output per event.
+ *
+ * Events only update the target state of their key (\ref NoteOn, \ref NoteOff); \ref Flush then applies the
+ * difference to what the key mapping holds. An on, off, on sequence within a frame becomes a single note on, an on
+ * followed by its off becomes nothing - except that a key is always lit for at least \p minOnMs: a note on whose off
+ * arrives in the same frame is still shown, and releases within \p minOnMs of the key lighting up are held back until
+ * the time is over.
+ *
+ * The key state is never dropped. If more keys change within one frame than \ref capacity, \ref NoteOn and
+ * \ref NoteOff refuse the event; the caller then applies everything with \ref Flush (forced, ignoring the minimum
+ * on-time) and retries. \ref Overloaded tells the caller to shed effect work while events storm in.
+ */
+class NoteEventReducer
+{
+public:
+    static constexpr size_t capacity = 64;
+
+    /**
+     * A frame with at least this many events counts as overloaded.
+     */
+    static constexpr uint32_t stormEvents = 16;
+
+    struct Stats
+    {
+        uint32_t events = 0;
+        uint32_t applied = 0;      // note ons and offs passed on to the key mapping
+        uint32_t frames = 0;       // flushes that applied something
+        uint32_t stretched = 0;    // notes held back or shown to honor the minimum on-time
+        uint32_t overflows = 0;    // forced flushes because more keys changed than capacity
+        uint32_t effectsShed = 0;  // effect updates skipped while overloaded, counted by the caller
+
+        uint32_t Collapsed() const { return events > applied ? events - applied : 0; }
+    };
+
+    /**
+     * A note on or off to apply to the key mapping.
+     */
+    struct Change
+    {
+        uint8_t source;
+        uint8_t channel;
+        uint8_t note;
+        uint8_t velocity;
+    };
+
+    NoteEventReducer();
+
+    /**
+     * @return false if the event could not be stored (see above).
+     */
+    bool NoteOn(uint8_t source, uint8_t channel, uint8_t note, uint8_t velocity);
+    /**
+     * The release velocity is not taken: the key mapping does not use it, and a release may be merged with others.
+     */
+    bool NoteOff(uint8_t source, uint8_t note);
+
+    /**
+     * Applies the net change of every key with \p on(const Change &) and \p off(const Change &), releases that
+     * waited for the minimum on-time included.
+     * @param force apply everything now, ignoring the minimum on-time.
+     * @return whether anything was applied.
+     */
+    template <typename On, typename Off>
+    bool Flush(uint32_t nowMs, uint32_t minOnMs, bool force, On &&on, Off &&off)
+    {
+        lastFrameEvents = frameEvents;
+        frameEvents = 0;
+        bool appliedAny = false;
+        for (size_t i = 0; i < entryCount;)
+        {
+            Entry &entry = entries[i];
+            uint8_t &holds = held[Index(entry.change.source, entry.change.note)];
+            const bool early = !force && entry.lit && nowMs - entry.litSinceMs < minOnMs;
+
+            if (!force && entry.sawOn && entry.target == 0 && holds == 0)
+            {
+                // a staccato note: show it anyway, the release follows once the minimum on-time is over
+                ++counters.stretched;
+                Apply(on, entry, holds, 1);
+                entry.lit = true;
+                entry.litSinceMs = nowMs;
+                appliedAny = true;
+            }
+            else if (entry.target > holds)
+            {
+                Apply(on, entry, holds, entry.target);
+                entry.lit = true;
+                entry.litSinceMs = nowMs;
+                appliedAny = true;
+            }
+            else if (entry.target < holds && !early)
+            {
+                Apply(off, entry, holds, entry.target);
+                appliedAny = true;
+            }
+            else if (entry.target < holds && entry.sawOff)
+            {
+                ++counters.stretched;
+            }
+            entry.sawOn = false;
+            entry.sawOff = false;
+
+            const bool waiting = entry.target != holds;
+            const bool recent = !force && entry.lit && nowMs - entry.litSinceMs < minOnMs;
+            if (waiting || recent)
+            {
+                ++i;
+                continue;
+            }
+            entries[i] = entries[--entryCount];
+        }
+        if (appliedAny)
+            ++counters.frames;
+        return appliedAny;
+    }
+
+    /**
+     * Whether events are storming in: the current or the last frame had at least \ref stormEvents events, or half
+     * of the capacity is in use.
+     */
+    bool Overloaded() const
+    {
+        return frameEvents >= stormEvents || lastFrameEvents >= stormEvents || entryCount >= capacity / 2;
+    }
+
+    bool Pending() const { return entryCount > 0; }
+
+    /**
+     * Forgets all keys, for when the key mapping forgot its lit LEDs (all notes off, new configuration).
+     */
+    void Reset();
+
+    void ShedEffect() { ++counters.effectsShed; }
+    const Stats &GetStats() const { return counters; }
+    void ResetStats() { counters = Stats(); }
+
+private:
+    struct Entry
+    {
+        Change change;         // source and note of the key, channel and velocity of its latest note on
+        uint8_t target;        // holds the key should have after the events so far
+        bool sawOn;            // since the last flush
+        bool sawOff;
+        bool lit;              // lit by a flush, litSinceMs is valid
+        uint32_t litSinceMs;
+    };
+
+    std::array<Entry, capacity> entries;
+    size_t entryCount;
+    uint32_t frameEvents;
+    uint32_t lastFrameEvents;
+    // How many note ons the key mapping holds per (source, note)
+    std::array<uint8_t, MidiSources::count * 128> held;
+    Stats counters;
+
+    static size_t Index(uint8_t source, uint8_t note) { return (source < MidiSources::count ? source : 0) * 128 + (note & 0x7F); }
+
+    Entry *Find(uint8_t source, uint8_t note, bool create);
+
+    template <typename Callback>
+    void Apply(Callback &&applyChange, const Entry &entry, uint8_t &holds, uint8_t target)
+    {
+        while (holds != target)
+        {
+            applyChange(entry.change);
+            holds += holds < target ? 1 : -1;
+            ++counters.applied;
+        }
+    }
+};
+
+#endif // NOTE_EVENT_REDUCER_H
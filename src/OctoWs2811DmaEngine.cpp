@@ -0,0 +1,70 @@
+#if defined(PIANO_LED_DMA_OUTPUT)
+
+#include <Arduino.h>
+#include "OctoWs2811DmaEngine.h"
+#include "PixelKernels.h"
+#include "MemoryMap.h"
+#include "EventTrace.h"
+
+// 3 bytes per LED, OctoWS2811 wants the frame buffer as ints. It is only written in bulk by Transmit, and OctoWS2811
+// flushes the data cache before starting the DMA, so it stays in OCRAM.
+DMAMEM static int displayMemory[OctoWs2811DmaEngine::maxLedsPerStrip * PianoLedConfig::maxStrips * 3 / 4];
+
+OctoWs2811DmaEngine::OctoWs2811DmaEngine()
+    : octo(0, displayMemory, nullptr, WS2811_GRB | WS2811_800kHz, 0, nullptr), ledsPerStrip(0), numPins(0), started(false)
+{
+}
+
+bool OctoWs2811DmaEngine::Begin(size_t ledsPerStrip, const std::vector<uint8_t> &pins)
+{
+    if (pins.empty() || pins.size() > PianoLedConfig::maxStrips || ledsPerStrip > maxLedsPerStrip)
+    {
+        Serial.printf("OctoWs2811DmaEngine: unsupported layout (%u strips, %u LEDs per strip)\n", (unsigned)pins.size(), (unsigned)ledsPerStrip);
+        return false;
+    }
+
+    // never reconfigure underneath a running transfer
+    while (started && octo.busy())
+        ;
+
+    std::copy(pins.begin(), pins.end(), pinList);
+    this->ledsPerStrip = ledsPerStrip;
+    numPins = pins.size();
+    memset(displayMemory, 0, sizeof(displayMemory));
+    octo.begin(ledsPerStrip, displayMemory, nullptr, WS2811_GRB | WS2811_800kHz, numPins, pinList);
+    MemoryMap::Record("DMA display memory", displayMemory, sizeof(displayMemory), ledsPerStrip * numPins * 3);
+    started = true;
+    return true;
+}
+
+bool OctoWs2811DmaEngine::Busy()
+{
+    return started && octo.busy();
+}
+
+void OctoWs2811DmaEngine::Transmit(const uint8_t *rgbFrame, uint8_t brightness)
+{
+    // ends when the DMA is started, the transfer itself runs in the background
+    EventTrace::Scope trace(EventTrace::Id::Show, brightness);
+    size_t totalLeds = ledsPerStrip * numPins;
+    if (brightness == 255)
+    {
+        for (size_t i = 0; i < totalLeds; ++i, rgbFrame += 3)
+        {
+            octo.setPixel(i, rgbFrame[0], rgbFrame[1], rgbFrame[2]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < totalLeds; ++i, rgbFrame += 3)
+        {
+            octo.setPixel(i, PixelKernels::Scalar::ScaleVideo(rgbFrame[0], brightness),
+                          PixelKernels::Scalar::ScaleVideo(rgbFrame[1], brightness),
+                          PixelKernels::Scalar::ScaleVideo(rgbFrame[2], brightness));
+        }
+    }
+    // returns as soon as the DMA is started
+    octo.show();
+}
+
+#endif // PIANO_LED_DMA_OUTPUT
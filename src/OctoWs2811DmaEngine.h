@@ -0,0 +1,34 @@
+#ifndef OCTO_WS2811_DMA_ENGINE_H
+#define OCTO_WS2811_DMA_ENGINE_H
+
+#include <OctoWS2811.h>
+#include "LedDmaEngine.h"
+#include "PianoLedConfig.h"
+
+/**
+ * \ref ILedDmaEngine backed by PJRC's OctoWS2811 library, which on the Teensy 4.1 drives WS2812 strips on any
+ * digital pins using DMA and a timer, without disabling interrupts.
+ *
+ * No separate drawing buffer is given to OctoWS2811: \ref DmaLedController already keeps the CPU side frame, so
+ * Transmit writes straight into the DMA frame buffer, which is safe because it is only called while not busy.
+ */
+class OctoWs2811DmaEngine : public ILedDmaEngine
+{
+public:
+    static const size_t maxLedsPerStrip = PianoLedConfig::maxLedsPerStrip;
+
+    OctoWs2811DmaEngine();
+
+    bool Begin(size_t ledsPerStrip, const std::vector<uint8_t> &pins) override;
+    bool Busy() override;
+    void Transmit(const uint8_t *rgbFrame, uint8_t brightness) override;
+
+private:
+    OctoWS2811 octo;
+    uint8_t pinList[PianoLedConfig::maxStrips];
+    size_t ledsPerStrip;
+    size_t numPins;
+    bool started;
+};
+
+#endif // OCTO_WS2811_DMA_ENGINE_H
@@ -1,4 +1,6 @@
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 #include "PianoLedConfig.h"
 #include <regex>
 
@@ -22,6 +24,34 @@ PianoLedConfig PianoLedConfig::globalConfig = {
 
 const std::vector<uint8_t> PianoLedConfig::allChannels = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
 
+bool PianoLedConfig::HasSameLedHardware(const PianoLedConfig &other) const
+{
+    if (strips.size() != other.strips.size())
+        return false;
+
+    for (size_t i = 0; i < strips.size(); ++i)
+    {
+        if (strips[i].ledPin != other.strips[i].ledPin || strips[i].totalLeds != other.strips[i].totalLeds ||
+            strips[i].ledType != other.strips[i].ledType || strips[i].clockPin != other.strips[i].clockPin ||
+            strips[i].rgbw != other.strips[i].rgbw)
+            return false;
+    }
+    return true;
+}
+
+void PianoLedConfig::CopyLook(const PianoLedConfig &preset)
+{
+    colorPalette = preset.colorPalette;
+    colorLayout = preset.colorLayout;
+    colorCurve = preset.colorCurve;
+    colorInterpolation = preset.colorInterpolation;
+    colorZones = preset.colorZones;
+    noteOffColor = preset.noteOffColor;
+    noteOffColorBrightness = preset.noteOffColorBrightness;
+    guideColor = preset.guideColor;
+    guideColorBrightness = preset.guideColorBrightness;
+}
+
 int PianoLedConfig::NoteToMidi(const std::string &note)
 {
     static const std::unordered_map<std::string, int> noteOffsets = {
@@ -6,6 +6,7 @@
 #include <cctype>
 #include "NoteEvent.h"
 #include "PianoLedStrip.h"
+#include "LedTopology.h"
 #include "NeoPixelColor.h"
 #include "GradientColorMapping.h"
 #include "LedColor.h"
@@ -13,8 +14,23 @@
 struct PianoLedConfig
 {
     static int NoteToMidi(const std::string &note);
-    static const int maxStrips = 5;
-    static const int maxColorPaletteSize = 10;
+
+    /**
+     * True if both configurations drive the same strips and LED types on the same pins, i.e. switching between them does not
+     * require restarting the LED controller.
+     */
+    bool HasSameLedHardware(const PianoLedConfig &other) const;
+
+    /**
+     * Copies the fields that make up a preset (see PresetBank.h) from \p preset: colorPalette, colorLayout, colorCurve,
+     * colorInterpolation, colorZones, noteOffColor, noteOffColorBrightness, guideColor and guideColorBrightness.
+     */
+    void CopyLook(const PianoLedConfig &preset);
+    static constexpr int maxStrips = 5;
+    static constexpr int maxLedsPerStrip = 512; // the frame buffers are statically sized for this
+    static constexpr int maxColorPaletteSize = 10;
+    static constexpr int maxSegments = 16;
+    static constexpr int maxColorZones = 8;
 
     /**
      * @enum LedStripColorLayout
@@ -33,6 +49,45 @@ struct PianoLedConfig
         NoteBased
     };
 
+    /**
+     * A part of the keyboard and/or a set of MIDI channels with a color scheme of its own, e.g. the left hand on
+     * channel 1 and the right hand on channel 2, or a split point at C4.
+     */
+    struct ColorZone
+    {
+        /**
+         * MIDI note range of the zone, inclusive.
+         */
+        int lowestNote = 0;
+        int highestNote = 127;
+
+        /**
+         * MIDI channels (1-16) of the zone. Empty means all channels.
+         */
+        std::vector<uint8_t> midiChannels;
+
+        std::vector<LedColor> colorPalette;
+        LedStripColorLayout colorLayout = LedStripColorLayout::VelocityBased;
+        std::function<double(double)> colorCurve = GradientColorMapping::Linear;
+        GradientColorMapping::Interpolation colorInterpolation = GradientColorMapping::Interpolation::Rgb;
+    };
+
+    /**
+     * The strips and color zones the events of one MIDI source drive (see MidiSources.h for the source IDs).
+     */
+    struct SourceRoute
+    {
+        /**
+         * Strip numbers the source lights up. Empty means all strips.
+         */
+        std::vector<uint8_t> strips;
+
+        /**
+         * Indexes of the color zones that apply to the source's notes. Empty means all zones.
+         */
+        std::vector<uint8_t> zones;
+    };
+
     /**
      * Serial port for the remote ESP32 MCU, used to change the configuration of this program via a webserver running on the ESP32.
      */
@@ -43,6 +98,15 @@ struct PianoLedConfig
      */
     std::vector<PianoLedStrip> strips;
 
+    /**
+     * Optional: an ordered list of strip segments that together form one keyboard, e.g. a serpentine layout or
+     * a keyboard spread over several strips on different pins. Every key then lights up LEDs on exactly one of
+     * the strips, instead of on every strip.
+     * If empty, every strip forms a keyboard on its own, laid out according to its stripOrientation.
+     * The keyboard takes stripToPianoLengthScale and its key span settings from the strip of the first segment.
+     */
+    std::vector<LedSegment> topology;
+
     /**
      * Color palette for the gradient mapping.
      *
@@ -67,6 +131,30 @@ struct PianoLedConfig
      */
     std::function<double(double)> colorCurve;
 
+    /**
+     * Color space the gradient between two colors of the color palette is interpolated in.
+     */
+    GradientColorMapping::Interpolation colorInterpolation = GradientColorMapping::Interpolation::Rgb;
+
+    /**
+     * Optional color zones. A note takes the color scheme of the first zone containing both its note and its
+     * channel; notes outside of all zones use colorPalette, colorLayout, colorCurve and colorInterpolation above.
+     * With NoteBased, the gradient of a zone spans the zone's key range.
+     */
+    std::vector<ColorZone> colorZones;
+
+    /**
+     * Optional routing per MIDI source, indexed by source ID, e.g. two keyboards each lighting their own strip.
+     * Sources without an entry drive all strips and zones.
+     */
+    std::vector<SourceRoute> sourceRoutes;
+
+    /**
+     * Optional velocity remap applied before VelocityBased colors are looked up, as learned by the velocity
+     * calibration. Either empty or 128 entries, velocityCurve[velocity] being the velocity used for the color.
+     */
+    std::vector<uint8_t> velocityCurve;
+
     /**
      * Color for note off event.
      * This color will be used when a note is released or not played at all.
@@ -93,6 +181,86 @@ struct PianoLedConfig
      */
     std::string lowestKey;
 
+    /**
+     * Maximum current in milliamps all strips together may draw, estimated from the pixel colors. If the estimate
+     * is higher, all strips are dimmed. Set this according to your power supply. 0 means no limit.
+     */
+    int powerBudgetMilliamps = 0;
+
+    /**
+     * MIDI file playback lights the keys of upcoming notes this long before they are played, in guideColor with
+     * guideColorBrightness. 0 turns the guide off.
+     */
+    int guideLookaheadMs = 0;
+    LedColor guideColor = LedColor(0, 255, 0);
+    int guideColorBrightness = 64;
+
+    /**
+     * MIDI CC (0-127) that starts (value >= 64) and stops (value < 64) the MIDI recorder, -1 for none.
+     */
+    int recordControlCc = -1;
+
+    /**
+     * A main loop slice of a subsystem taking longer than this is counted as a stall (see the stats command).
+     * 0 disables stall detection.
+     */
+    int stallThresholdMs = 20;
+
+    /**
+     * The hardware watchdog resets the device if the firmware makes no progress for this long (2 s to 128 s).
+     * 0 leaves the watchdog off; once it runs it can only be turned off by a reset.
+     */
+    int watchdogTimeoutMs = 8000;
+
+    /**
+     * Shortest time between two updates of the live LED state sent to the ESP32 while it asks for them (see
+     * LedStateStream.h). The stream slows down on its own if the UART cannot keep up. 0 disables the stream.
+     */
+    int ledStreamIntervalMs = 50;
+
+    /**
+     * Note events are applied to the LEDs once per frame, reduced to the net change per key (see NoteEventReducer.h).
+     * A key stays lit at least this long, so very short staccato notes are still visible. 0 shows only the net change.
+     */
+    int minNoteOnMs = 30;
+
+    /**
+     * MIDI thru: what the piano plays is forwarded to the USB device port (the computer) through MidiThru.
+     * All notes are transposed by this many semitones; notes moved out of 0-127 are dropped.
+     */
+    int thruTranspose = 0;
+
+    /**
+     * MIDI thru: channel (1-16) all messages are sent on, 0 keeps the channel they were played on.
+     */
+    int thruChannel = 0;
+
+    /**
+     * MIDI thru: notes below this MIDI note are the lower part of a keyboard split and are sent on thruSplitChannel,
+     * transposed by thruSplitTranspose instead of thruTranspose. Controllers, pitch bend and channel pressure go to
+     * both parts. -1 disables the split.
+     */
+    int thruSplitNote = -1;
+    int thruSplitChannel = 2;
+    int thruSplitTranspose = 0;
+
+    /**
+     * MIDI thru: either empty or 128 entries, thruVelocityCurve[velocity] being the note on velocity sent.
+     */
+    std::vector<uint8_t> thruVelocityCurve;
+
+    /**
+     * Whether the LEDs show the notes as routed by the MIDI thru (transposed, on the split channels) instead of
+     * the notes as played.
+     */
+    bool ledFollowsThru = false;
+
+    /**
+     * MIDI channel (1-16) whose Program Change messages select the preset with the program number (see
+     * PresetBank.h), 0 for any channel, -1 to ignore Program Change.
+     */
+    int presetChannel = -1;
+
     static const std::vector<uint8_t> allChannels;
     static PianoLedConfig globalConfig;
 };
@@ -1,8 +1,19 @@
 #ifndef PIANO_LED_STRIP_H
 #define PIANO_LED_STRIP_H
 
-#include <unordered_map>
-#include "NeoPixelColor.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "LedColor.h"
+
+/**
+ * A run of LEDs lighting up for one piano key, in logical LED positions (before the strip orientation is applied).
+ */
+struct KeySpan
+{
+    uint16_t startLed;
+    uint16_t ledCount;
+};
 
 struct PianoLedStrip
 {
@@ -31,7 +42,48 @@ struct PianoLedStrip
     };
 
     /**
-     * What Teensy 4.1 pin this LED strip is connected to. Possible values are pins 2-6.
+     * @enum KeySpanMode
+     * @brief Defines how many and which LEDs light up for a single piano key.
+     */
+    enum class KeySpanMode
+    {
+        /**
+         * One LED per key at round(keyIndex * stripToPianoLengthScale). Some LEDs between keys are never used.
+         */
+        SingleLed,
+        /**
+         * Every LED is assigned to the key it sits above, based on the widths of the white and black keys of a
+         * standard piano keyboard. stripToPianoLengthScale still defines how many LEDs there are per semitone.
+         */
+        KeyGeometry,
+        /**
+         * Keys use the spans stored in \ref PianoLedStrip::keySpanCalibration. Keys without a calibrated span fall
+         * back to KeyGeometry.
+         */
+        Calibrated
+    };
+
+    /**
+     * @enum LedType
+     * @brief The type of LEDs on the strip. Selects the FastLED chipset driver as well as the gamma and white
+     * balance tables used for color correction.
+     */
+    enum class LedType
+    {
+        WS2812B,
+        SK6812,
+        WS2811,
+        /**
+         * Clocked (SPI) LEDs, needing a clock pin in addition to the data pin. They can be refreshed much faster
+         * than the clockless types, which matters for long strips.
+         */
+        APA102,
+        SK9822
+    };
+
+    /**
+     * What Teensy 4.1 pin this LED strip is connected to. Clockless LED types can use any pin from 2 to 41 except 13,
+     * clocked LED types use 11 (with clockPin 13) or 26 (with clockPin 27).
      */
     int ledPin;
 
@@ -56,9 +108,55 @@ struct PianoLedStrip
     StripOrientation stripOrientation;
 
     /**
-     * Do not change: used by this program to calculate which LEDs to light up.
+     * Maximum current in milliamps this strip may draw, estimated from the pixel colors. If the estimate is higher,
+     * all strips are dimmed. 0 means no limit.
+     */
+    int maxMilliamps = 0;
+
+    /**
+     * Which LEDs light up for a single key.
+     */
+    KeySpanMode keySpanMode = KeySpanMode::KeyGeometry;
+
+    /**
+     * Calibrated LED span per MIDI note number, used when keySpanMode is Calibrated. Either empty or 128 entries;
+     * entries with a ledCount of 0 are not calibrated.
+     */
+    std::vector<KeySpan> keySpanCalibration;
+
+    /**
+     * The type of LEDs on this strip.
+     */
+    LedType ledType = LedType::WS2812B;
+
+    /**
+     * Clock pin for clocked LED types (APA102, SK9822). Ignored for the other types.
+     */
+    int clockPin = -1;
+
+    /**
+     * The strip has an additional white LED per pixel (SK6812 RGBW). The white part of every color is then shown
+     * with the white LED.
+     */
+    bool rgbw = false;
+
+    /**
+     * Color of the white LED of RGBW strips, e.g. #FFFFFF for a neutral white LED or about #FFB46B for a warm
+     * white (3000K) one. Only the part of a color matching it is moved to the white LED.
+     */
+    LedColor whiteLedColor = LedColor::White;
+
+    /**
+     * Apply the gamma and white balance correction of ledType before the colors are sent to the strip. Colors then
+     * look perceptually even, but low brightness values (e.g. noteOffColorBrightness) get much darker.
+     */
+    bool colorCorrection = false;
+
+    /**
+     * Temporally dither color corrected output, so that levels between two output steps are reproduced by alternating
+     * between them. Requires the LEDs to be refreshed continuously, which is done automatically while enabled.
      */
-    std::unordered_map<NeoPixelColor, int> litLedsTable;
+    bool temporalDithering = false;
 
     // Equality operator: identity determined by ledPin
     bool operator==(const PianoLedStrip &other) const
@@ -0,0 +1,210 @@
+#include "PixelKernels.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_math.h> // CMSIS packed-byte intrinsics (__UQADD8, __USUB8, __SEL, __UXTB16, ...)
+#endif
+
+namespace
+{
+    // 0..255 -> 0..256, so that an amount of 255 yields the source exactly
+    inline uint32_t BlendWeight16(uint8_t amount)
+    {
+        return static_cast<uint32_t>(amount) + (amount >> 7);
+    }
+
+    inline uint32_t LoadWord(const uint8_t *p)
+    {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w)); // compiles to a single (unaligned) LDR on the Cortex-M7
+        return w;
+    }
+
+    inline void StoreWord(uint8_t *p, uint32_t w)
+    {
+        memcpy(p, &w, sizeof(w));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference implementation
+// ---------------------------------------------------------------------------
+
+void PixelKernels::Scalar::Fill(uint8_t *pixels, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b)
+{
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        pixels[i * 3 + 0] = r;
+        pixels[i * 3 + 1] = g;
+        pixels[i * 3 + 2] = b;
+    }
+}
+
+void PixelKernels::Scalar::ScaleVideo(uint8_t *channels, size_t channelCount, uint8_t scale)
+{
+    for (size_t i = 0; i < channelCount; ++i)
+    {
+        channels[i] = ScaleVideo(channels[i], scale);
+    }
+}
+
+void PixelKernels::Scalar::AddSaturate(uint8_t *dst, const uint8_t *src, size_t channelCount)
+{
+    for (size_t i = 0; i < channelCount; ++i)
+    {
+        unsigned sum = dst[i] + src[i];
+        dst[i] = sum > 255 ? 255 : static_cast<uint8_t>(sum);
+    }
+}
+
+void PixelKernels::Scalar::Blend(uint8_t *dst, const uint8_t *src, size_t channelCount, uint8_t amount)
+{
+    uint32_t w = BlendWeight16(amount);
+    for (size_t i = 0; i < channelCount; ++i)
+    {
+        dst[i] = static_cast<uint8_t>((dst[i] * (256 - w) + src[i] * w + 128) >> 8);
+    }
+}
+
+void PixelKernels::Scalar::FadeToward(uint8_t *dst, const uint8_t *target, size_t channelCount, uint8_t step)
+{
+    for (size_t i = 0; i < channelCount; ++i)
+    {
+        int c = dst[i];
+        int t = target[i];
+        if (c < t)
+        {
+            c = std::min(c + step, 255);
+            dst[i] = static_cast<uint8_t>(std::min(c, t));
+        }
+        else
+        {
+            c = std::max(c - step, 0);
+            dst[i] = static_cast<uint8_t>(std::max(c, t));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Dispatching implementation
+// ---------------------------------------------------------------------------
+
+void PixelKernels::Fill(uint8_t *pixels, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b)
+{
+    // Four RGB pixels are exactly three words, so the pattern repeats every 12 bytes.
+    const uint32_t w0 = r | (g << 8) | (b << 16) | (static_cast<uint32_t>(r) << 24);
+    const uint32_t w1 = g | (b << 8) | (r << 16) | (static_cast<uint32_t>(g) << 24);
+    const uint32_t w2 = b | (r << 8) | (g << 16) | (static_cast<uint32_t>(b) << 24);
+
+    size_t i = 0;
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        uint8_t *p = pixels + i * 3;
+        StoreWord(p + 0, w0);
+        StoreWord(p + 4, w1);
+        StoreWord(p + 8, w2);
+    }
+    Scalar::Fill(pixels + i * 3, pixelCount - i, r, g, b);
+}
+
+#if defined(__ARM_FEATURE_DSP)
+
+void PixelKernels::ScaleVideo(uint8_t *channels, size_t channelCount, uint8_t scale)
+{
+    if (scale == 0)
+    {
+        memset(channels, 0, channelCount);
+        return;
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= channelCount; i += 4)
+    {
+        uint32_t c = LoadWord(channels + i);
+        // Two channels per multiply: each halfword product is at most 255 * 255 and cannot carry into its neighbour.
+        uint32_t even = ((__UXTB16(c) * scale) >> 8) & 0x00FF00FF;
+        uint32_t odd = (__UXTB16(__ROR(c, 8)) * scale) & 0xFF00FF00;
+        // nscale8_video keeps lit channels lit: add 1 to every channel that was non-zero
+        uint32_t nonZero = __USUB8(c, __UQSUB8(c, 0x01010101));
+        StoreWord(channels + i, __UQADD8(even | odd, nonZero));
+    }
+    Scalar::ScaleVideo(channels + i, channelCount - i, scale);
+}
+
+void PixelKernels::AddSaturate(uint8_t *dst, const uint8_t *src, size_t channelCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= channelCount; i += 4)
+    {
+        StoreWord(dst + i, __UQADD8(LoadWord(dst + i), LoadWord(src + i)));
+    }
+    Scalar::AddSaturate(dst + i, src + i, channelCount - i);
+}
+
+void PixelKernels::Blend(uint8_t *dst, const uint8_t *src, size_t channelCount, uint8_t amount)
+{
+    const uint32_t w = BlendWeight16(amount);
+    const uint32_t invW = 256 - w;
+
+    size_t i = 0;
+    for (; i + 4 <= channelCount; i += 4)
+    {
+        uint32_t d = LoadWord(dst + i);
+        uint32_t s = LoadWord(src + i);
+        // d * (256 - w) + s * w + 128 <= 65408 per halfword, so two channels share one multiply-accumulate pair
+        uint32_t even = (__UXTB16(d) * invW + __UXTB16(s) * w + 0x00800080) >> 8;
+        uint32_t odd = __UXTB16(__ROR(d, 8)) * invW + __UXTB16(__ROR(s, 8)) * w + 0x00800080;
+        StoreWord(dst + i, (even & 0x00FF00FF) | (odd & 0xFF00FF00));
+    }
+    Scalar::Blend(dst + i, src + i, channelCount - i, amount);
+}
+
+void PixelKernels::FadeToward(uint8_t *dst, const uint8_t *target, size_t channelCount, uint8_t step)
+{
+    const uint32_t steps = step * 0x01010101u;
+
+    size_t i = 0;
+    for (; i + 4 <= channelCount; i += 4)
+    {
+        uint32_t c = LoadWord(dst + i);
+        uint32_t t = LoadWord(target + i);
+
+        // __USUB8 sets the per-byte GE flags that the following __SEL consumes
+        uint32_t up = __UQADD8(c, steps);
+        __USUB8(up, t);
+        up = __SEL(t, up); // min(c + step, t)
+
+        uint32_t down = __UQSUB8(c, steps);
+        __USUB8(down, t);
+        down = __SEL(down, t); // max(c - step, t)
+
+        __USUB8(c, t);
+        StoreWord(dst + i, __SEL(down, up)); // c >= t fades down, everything else fades up
+    }
+    Scalar::FadeToward(dst + i, target + i, channelCount - i, step);
+}
+
+#else
+
+void PixelKernels::ScaleVideo(uint8_t *channels, size_t channelCount, uint8_t scale)
+{
+    Scalar::ScaleVideo(channels, channelCount, scale);
+}
+
+void PixelKernels::AddSaturate(uint8_t *dst, const uint8_t *src, size_t channelCount)
+{
+    Scalar::AddSaturate(dst, src, channelCount);
+}
+
+void PixelKernels::Blend(uint8_t *dst, const uint8_t *src, size_t channelCount, uint8_t amount)
+{
+    Scalar::Blend(dst, src, channelCount, amount);
+}
+
+void PixelKernels::FadeToward(uint8_t *dst, const uint8_t *target, size_t channelCount, uint8_t step)
+{
+    Scalar::FadeToward(dst, target, channelCount, step);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Batch kernels for the per-pixel work of the LED controllers.
+ *
+ * All kernels operate on tightly packed 3-byte RGB pixels (the memory layout of FastLED's CRGB), addressed either
+ * by pixel count or by channel count (pixels * 3). On the Teensy 4.1 (Cortex-M7 with the DSP extension) the kernels
+ * process four channels per instruction using the packed-byte SIMD intrinsics. Every other build uses the scalar
+ * reference implementation in \ref PixelKernels::Scalar, which the SIMD path must match bit for bit.
+ */
+class PixelKernels
+{
+public:
+    /**
+     * Sets \p pixelCount pixels to the same color.
+     */
+    static void Fill(uint8_t *pixels, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b);
+
+    /**
+     * Scales every channel by \p scale / 256, with the same semantics as FastLED's nscale8_video:
+     * a channel that was non-zero stays non-zero unless \p scale is 0.
+     */
+    static void ScaleVideo(uint8_t *channels, size_t channelCount, uint8_t scale);
+
+    /**
+     * Adds \p src to \p dst, saturating every channel at 255.
+     */
+    static void AddSaturate(uint8_t *dst, const uint8_t *src, size_t channelCount);
+
+    /**
+     * Blends \p src over \p dst. An \p amount of 0 keeps \p dst, 255 yields \p src.
+     */
+    static void Blend(uint8_t *dst, const uint8_t *src, size_t channelCount, uint8_t amount);
+
+    /**
+     * Moves every channel of \p dst at most \p step towards the matching channel of \p target.
+     */
+    static void FadeToward(uint8_t *dst, const uint8_t *target, size_t channelCount, uint8_t step);
+
+    /**
+     * Portable reference implementation. Always compiled so the SIMD kernels can be compared against it on the device.
+     */
+    struct Scalar
+    {
+        static void Fill(uint8_t *pixels, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b);
+        static void ScaleVideo(uint8_t *channels, size_t channelCount, uint8_t scale);
+        static void AddSaturate(uint8_t *dst, const uint8_t *src, size_t channelCount);
+        static void Blend(uint8_t *dst, const uint8_t *src, size_t channelCount, uint8_t amount);
+        static void FadeToward(uint8_t *dst, const uint8_t *target, size_t channelCount, uint8_t step);
+
+        static uint8_t ScaleVideo(uint8_t channel, uint8_t scale)
+        {
+            return static_cast<uint8_t>(((channel * scale) >> 8) + ((channel && scale) ? 1 : 0));
+        }
+    };
+
+    /**
+     * True if this build uses the packed-byte SIMD kernels.
+     */
+    static constexpr bool HasSimd()
+    {
+#if defined(__ARM_FEATURE_DSP)
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+#endif // PIXEL_KERNELS_H
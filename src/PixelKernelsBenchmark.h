@@ -0,0 +1,20 @@
+#ifndef PIXEL_KERNELS_BENCHMARK_H
+#define PIXEL_KERNELS_BENCHMARK_H
+
+#include <Arduino.h>
+
+/**
+ * On-device microbenchmark for \ref PixelKernels.
+ * Runs every kernel through both the dispatching and the scalar reference implementation, prints cycles per pixel
+ * and verifies that both produce bit-identical output. Also reports the cost of the RGBW white extraction per frame.
+ */
+class PixelKernelsBenchmark
+{
+public:
+    /**
+     * @return true if every kernel matched the scalar reference.
+     */
+    static bool Run(Print &out);
+};
+
+#endif // PIXEL_KERNELS_BENCHMARK_H
@@ -0,0 +1,93 @@
+#include "PowerLimiter.h"
+#include <algorithm>
+
+PowerLimiter::PowerLimiter()
+    : globalBudget(0), lastScale(255), framesLimited(0), frames(0)
+{
+}
+
+void PowerLimiter::Reset(const std::vector<int> &ledsPerStrip)
+{
+    channelSums.assign(ledsPerStrip.size(), 0);
+    idleMilliamps.clear();
+    for (int leds : ledsPerStrip)
+    {
+        idleMilliamps.push_back(std::max(leds, 0) * idleMilliampsPerLed);
+    }
+    lastScale = 255;
+}
+
+void PowerLimiter::SetBudgets(const std::vector<int> &stripBudgetsMilliamps, int globalBudgetMilliamps)
+{
+    stripBudgets = stripBudgetsMilliamps;
+    globalBudget = globalBudgetMilliamps;
+}
+
+uint8_t PowerLimiter::BeginFrame()
+{
+    uint8_t scale = 255;
+    uint32_t idleTotal = 0;
+    uint32_t activeTotal = 0;
+    for (size_t i = 0; i < channelSums.size(); ++i)
+    {
+        uint32_t active = ActiveMilliamps(channelSums[i]);
+        idleTotal += idleMilliamps[i];
+        activeTotal += active;
+        if (i < stripBudgets.size())
+            scale = std::min(scale, ScaleFor(idleMilliamps[i], active, stripBudgets[i]));
+    }
+    scale = std::min(scale, ScaleFor(idleTotal, activeTotal, globalBudget));
+
+    ++frames;
+    if (scale < 255)
+        ++framesLimited;
+    lastScale = scale;
+    return scale;
+}
+
+uint8_t PowerLimiter::ScaleFor(uint32_t idle, uint32_t active, int budget)
+{
+    if (budget <= 0 || idle + active <= static_cast<uint32_t>(budget))
+        return 255;
+    if (static_cast<uint32_t>(budget) <= idle)
+        return 0;
+    // only the lit part of the draw scales with brightness
+    return static_cast<uint8_t>(std::min<uint32_t>((budget - idle) * 255 / active, 255));
+}
+
+uint32_t PowerLimiter::StripMilliamps(size_t stripNumber) const
+{
+    if (stripNumber >= channelSums.size())
+        return 0;
+    return idleMilliamps[stripNumber] + ActiveMilliamps(channelSums[stripNumber]);
+}
+
+uint32_t PowerLimiter::TotalMilliamps() const
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < channelSums.size(); ++i)
+    {
+        total += StripMilliamps(i);
+    }
+    return total;
+}
+
+uint32_t PowerLimiter::LimitedTotalMilliamps() const
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < channelSums.size(); ++i)
+    {
+        total += idleMilliamps[i] + ActiveMilliamps(channelSums[i]) * lastScale / 255;
+    }
+    return total;
+}
+
+uint32_t PowerLimiter::ChannelSum(const uint8_t *channels, size_t channelCount)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < channelCount; ++i)
+    {
+        sum += channels[i];
+    }
+    return sum;
+}
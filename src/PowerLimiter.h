@@ -0,0 +1,83 @@
+#ifndef POWER_LIMITER_H
+#define POWER_LIMITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Incremental current estimator and budget limiter for the LED strips.
+ *
+ * Instead of summing up every pixel on every frame, the controller reports how much the channel sum of a strip
+ * changed whenever it writes pixels, so the running milliamp estimate costs nothing for pixels that stay the same.
+ * At output time a single global brightness scale is derived that keeps every strip within its own budget and all
+ * strips together within the global budget.
+ */
+class PowerLimiter
+{
+public:
+    /**
+     * Current a WS2812B draws per color channel at full brightness, and with all channels off.
+     */
+    static const uint32_t milliampsPerChannel = 20;
+    static const uint32_t idleMilliampsPerLed = 1;
+
+    PowerLimiter();
+
+    /**
+     * Forgets all estimates and prepares for \p ledsPerStrip.size() strips, all of them black.
+     */
+    void Reset(const std::vector<int> &ledsPerStrip);
+
+    /**
+     * @param stripBudgetsMilliamps per strip budget, 0 for no limit.
+     * @param globalBudgetMilliamps budget of all strips together, 0 for no limit.
+     */
+    void SetBudgets(const std::vector<int> &stripBudgetsMilliamps, int globalBudgetMilliamps);
+
+    /**
+     * Reports that pixels of \p stripNumber changed their channel sum (r + g + b, summed over the pixels)
+     * from \p oldChannelSum to \p newChannelSum.
+     */
+    void PixelsChanged(size_t stripNumber, uint32_t oldChannelSum, uint32_t newChannelSum)
+    {
+        if (stripNumber < channelSums.size())
+            channelSums[stripNumber] += newChannelSum - oldChannelSum;
+    }
+
+    /**
+     * Brightness scale (255 = unlimited) to apply to the next frame. Counts the frame as limited if it is below 255.
+     */
+    uint8_t BeginFrame();
+
+    /**
+     * Estimated draw without limiting.
+     */
+    uint32_t StripMilliamps(size_t stripNumber) const;
+    uint32_t TotalMilliamps() const;
+
+    /**
+     * Estimated draw with the scale of the last frame applied.
+     */
+    uint32_t LimitedTotalMilliamps() const;
+
+    uint8_t LastScale() const { return lastScale; }
+    uint32_t FramesLimited() const { return framesLimited; }
+    uint32_t Frames() const { return frames; }
+
+    static uint32_t ChannelSum(const uint8_t *channels, size_t channelCount);
+
+private:
+    std::vector<uint32_t> channelSums;
+    std::vector<uint32_t> idleMilliamps;
+    std::vector<int> stripBudgets;
+    int globalBudget;
+    uint8_t lastScale;
+    uint32_t framesLimited;
+    uint32_t frames;
+
+    static uint32_t ActiveMilliamps(uint32_t channelSum) { return channelSum * milliampsPerChannel / 255; }
+    static uint8_t ScaleFor(uint32_t idle, uint32_t active, int budget);
+};
+
+#endif // POWER_LIMITER_H
@@ -0,0 +1,46 @@
+#include "PresetBank.h"
+#include "MemoryMap.h"
+#include <cstring>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+// Only read by note events while a preset is shown, so they can live in the slower OCRAM
+DMAMEM static NoteColorTable presetTables[PresetBank::maxPresets];
+#else
+static NoteColorTable presetTables[PresetBank::maxPresets];
+#endif
+
+PresetBank::PresetBank()
+    : tables(presetTables), active(-1)
+{
+    RecordMemory();
+}
+
+void PresetBank::Store(uint8_t slot, const char *name, const PianoLedConfig &preset)
+{
+    if (slot >= maxPresets)
+        return;
+    Preset &stored = presets[slot];
+    strncpy(stored.name.data(), name && name[0] ? name : "preset", maxNameLength);
+    stored.name[maxNameLength] = '\0';
+    stored.look.CopyLook(preset);
+    RecordMemory();
+}
+
+void PresetBank::Remove(uint8_t slot)
+{
+    if (slot >= maxPresets)
+        return;
+    presets[slot] = Preset();
+    if (active == slot)
+        active = -1;
+    RecordMemory();
+}
+
+void PresetBank::RecordMemory()
+{
+    size_t count = 0;
+    for (uint8_t i = 0; i < maxPresets; ++i)
+        count += Stored(i);
+    MemoryMap::Record("preset color tables", tables, sizeof(presetTables), count * sizeof(NoteColorTable));
+}
@@ -0,0 +1,101 @@
+#ifndef PRESET_BANK_H
+#define PRESET_BANK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "NoteColorTable.h"
+#include "PianoLedConfig.h"
+
+/**
+ * Named looks - color palette, layout, curve and interpolation, color zones, note off and guide colors (see
+ * PianoLedConfig::CopyLook) - that can be switched to while playing, by MIDI Program Change or from the ESP32.
+ *
+ * Every stored preset is compiled into a NoteColorTable of its own when it is stored and whenever the key map
+ * changes (\ref Build), so switching to it is a pointer swap (KeyboardKeyToLed::SelectColorTable): nothing is
+ * computed, allocated or written to flash, and the LED controller keeps running. The tables are only read by note
+ * events, so they live in OCRAM; the configuration's own table stays in DTCM.
+ *
+ * The presets are stored on the LittleFS by ConfigManager as /preset<slot>.txt, in the format of the configuration.
+ */
+class PresetBank
+{
+public:
+    static constexpr uint8_t maxPresets = 8;
+    static constexpr size_t maxNameLength = 23;
+
+    struct Stats
+    {
+        uint32_t switches = 0;
+        uint32_t lastSwitchCycles = 0; // the pointer swap, measured around KeyboardKeyToLed::SelectColorTable
+        uint32_t maxSwitchCycles = 0;
+        uint32_t lastBuildUs = 0;      // compiling all presets, e.g. after a config change
+    };
+
+    PresetBank();
+
+    /**
+     * Keeps the look of \p preset (see PianoLedConfig::CopyLook) in \p slot. Call \ref Build for it afterwards.
+     */
+    void Store(uint8_t slot, const char *name, const PianoLedConfig &preset);
+    void Remove(uint8_t slot);
+
+    /**
+     * Compiles the presets for the key map and source routing of \p config, with \p build(table, config) (see
+     * KeyboardKeyToLed::BuildColorTable). Builds only \p slot if it is given.
+     */
+    template <typename BuildTable>
+    void Build(const PianoLedConfig &config, BuildTable &&build, int slot = -1)
+    {
+        PianoLedConfig look = config;
+        for (uint8_t i = 0; i < maxPresets; ++i)
+        {
+            if (!Stored(i) || (slot >= 0 && slot != i))
+                continue;
+            look.CopyLook(presets[i].look);
+            build(tables[i], look);
+        }
+    }
+
+    bool Stored(uint8_t slot) const { return slot < maxPresets && presets[slot].name[0] != '\0'; }
+    const char *Name(uint8_t slot) const { return Stored(slot) ? presets[slot].name.data() : ""; }
+    const PianoLedConfig &Look(uint8_t slot) const { return presets[slot].look; }
+
+    /**
+     * The compiled table of \p slot, nullptr if the slot is empty.
+     */
+    const NoteColorTable *Table(uint8_t slot) const { return Stored(slot) ? &tables[slot] : nullptr; }
+
+    /**
+     * The preset shown, -1 for the configuration's own look.
+     */
+    int Active() const { return active; }
+    void SetActive(int slot) { active = slot; }
+
+    void RecordSwitch(uint32_t cycles)
+    {
+        ++counters.switches;
+        counters.lastSwitchCycles = cycles;
+        if (cycles > counters.maxSwitchCycles)
+            counters.maxSwitchCycles = cycles;
+    }
+    void RecordBuild(uint32_t us) { counters.lastBuildUs = us; }
+
+    const Stats &GetStats() const { return counters; }
+
+private:
+    struct Preset
+    {
+        std::array<char, maxNameLength + 1> name{}; // empty for a free slot
+        PianoLedConfig look;
+    };
+
+    std::array<Preset, maxPresets> presets;
+    NoteColorTable *tables; // maxPresets tables, in OCRAM
+    int active;
+    Stats counters;
+
+    void RecordMemory();
+};
+
+#endif // PRESET_BANK_H
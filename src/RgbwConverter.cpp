@@ -0,0 +1,33 @@
+#include "RgbwConverter.h"
+#include <algorithm>
+
+RgbwConverter::RgbwConverter()
+{
+    SetWhiteLedColor(LedColor::White);
+}
+
+void RgbwConverter::SetWhiteLedColor(const LedColor &whiteLedColor)
+{
+    const int white[3] = {std::max(whiteLedColor.r, 1), std::max(whiteLedColor.g, 1), std::max(whiteLedColor.b, 1)};
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int v = 0; v < 256; ++v)
+        {
+            // rounding down in both directions guarantees fromWhite[c][toWhite[c][v]] <= v, so no channel underflows
+            toWhite[c][v] = std::min(v * 255 / white[c], 255);
+            fromWhite[c][v] = v * white[c] / 255;
+        }
+    }
+}
+
+void RgbwConverter::Convert(const uint8_t *rgb, uint8_t *grbw, size_t pixelCount) const
+{
+    for (size_t i = 0; i < pixelCount; ++i, rgb += 3, grbw += 4)
+    {
+        uint8_t w = std::min({toWhite[0][rgb[0]], toWhite[1][rgb[1]], toWhite[2][rgb[2]]});
+        grbw[0] = rgb[1] - fromWhite[1][w];
+        grbw[1] = rgb[0] - fromWhite[0][w];
+        grbw[2] = rgb[2] - fromWhite[2][w];
+        grbw[3] = w;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef RGBW_CONVERTER_H
+#define RGBW_CONVERTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "LedColor.h"
+
+/**
+ * White channel extraction for RGBW strips, run in the output pass.
+ *
+ * The part of a color that the white LED can produce is moved from the RGB channels to the white channel. With a
+ * pure white LED (#FFFFFF) this is the classic min(r, g, b) extraction; with the color of a warm or cool white LED
+ * the extraction respects its color temperature, so the mixed color stays the same. Both directions are table
+ * lookups, so a pixel costs six lookups, a min and three subtractions.
+ */
+class RgbwConverter
+{
+public:
+    RgbwConverter();
+
+    /**
+     * Sets the color the white LED produces, relative to full red, green and blue (e.g. #FFB46B for 3000K).
+     */
+    void SetWhiteLedColor(const LedColor &whiteLedColor);
+
+    /**
+     * Converts \p pixelCount RGB pixels into 4-byte pixels in SK6812 RGBW wire order (G, R, B, W).
+     */
+    void Convert(const uint8_t *rgb, uint8_t *grbw, size_t pixelCount) const;
+
+private:
+    // toWhite[c][v]: white level needed to produce v on channel c; fromWhite[c][w]: channel c produced by white level w
+    std::array<std::array<uint8_t, 256>, 3> toWhite;
+    std::array<std::array<uint8_t, 256>, 3> fromWhite;
+};
+
+#endif // RGBW_CONVERTER_H
@@ -0,0 +1,75 @@
+#include "SerialConsole.h"
+
+SerialConsole::SerialConsole()
+    : lineLength(0)
+{
+    line[0] = '\0';
+}
+
+void SerialConsole::addCommand(const char *name, const char *description, std::function<void(Print &out)> handler)
+{
+    commands.push_back({name, description, [handler](Print &out, const char *)
+                        { handler(out); }});
+}
+
+void SerialConsole::addCommand(const char *name, const char *description, std::function<void(Print &out, const char *argument)> handler)
+{
+    commands.push_back({name, description, handler});
+}
+
+void SerialConsole::loop()
+{
+    while (Serial.available())
+    {
+        char c = Serial.read();
+        if (c == '\r' || c == '\n')
+        {
+            if (lineLength > 0)
+            {
+                line[lineLength] = '\0';
+                dispatch();
+                lineLength = 0;
+            }
+        }
+        else if (lineLength < maxLineLength)
+        {
+            line[lineLength++] = c;
+        }
+    }
+}
+
+void SerialConsole::dispatch()
+{
+    const char *argument = "";
+    char *space = strchr(line, ' ');
+    if (space)
+    {
+        *space = '\0';
+        argument = space + 1;
+    }
+
+    for (auto &command : commands)
+    {
+        if (strcmp(command.name, line) == 0)
+        {
+            command.handler(Serial, argument);
+            return;
+        }
+    }
+
+    if (strcmp(line, "help") != 0)
+    {
+        Serial.print("Unknown command: ");
+        Serial.println(line);
+    }
+    printHelp();
+}
+
+void SerialConsole::printHelp()
+{
+    Serial.println("Available commands:");
+    for (auto &command : commands)
+    {
+        Serial.printf("  %-10s %s\n", command.name, command.description);
+    }
+}
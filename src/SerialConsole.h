@@ -0,0 +1,42 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+/**
+ * Line based diagnostics console on the USB serial port.
+ * Other modules register named commands; typing the name followed by Enter runs the handler. Anything after the
+ * name and a space is passed to handlers that take an argument. Input is read without blocking so the console never
+ * holds up MIDI handling.
+ */
+class SerialConsole
+{
+public:
+    SerialConsole();
+
+    void loop();
+
+    void addCommand(const char *name, const char *description, std::function<void(Print &out)> handler);
+    void addCommand(const char *name, const char *description, std::function<void(Print &out, const char *argument)> handler);
+
+private:
+    struct Command
+    {
+        const char *name;
+        const char *description;
+        std::function<void(Print &out, const char *argument)> handler;
+    };
+
+    static const size_t maxLineLength = 64;
+
+    std::vector<Command> commands;
+    char line[maxLineLength + 1];
+    size_t lineLength;
+
+    void dispatch();
+    void printHelp();
+};
+
+#endif // SERIAL_CONSOLE_H
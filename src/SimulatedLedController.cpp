@@ -0,0 +1,292 @@
+#if !defined(ARDUINO)
+
+#include "SimulatedLedController.h"
+#include "PianoLedConfig.h"
+#include "PixelKernels.h"
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+    // Binary frame log:
+    //   header: "PLFL", version (u8), strip count (u8), LEDs per strip (u16 LE)
+    //   frame:  time since previous frame in us (u32 LE), changed pixel count (u16 LE),
+    //           then per changed pixel its index (u16 LE) and r, g, b.
+    //           A count of 0xFFFF marks a key frame followed by all pixels.
+    const uint8_t frameLogVersion = 1;
+    const uint16_t keyFrameMarker = 0xFFFF;
+
+    void WriteU16(FILE *f, uint16_t v)
+    {
+        uint8_t b[2] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8)};
+        fwrite(b, 1, sizeof(b), f);
+    }
+
+    void WriteU32(FILE *f, uint32_t v)
+    {
+        uint8_t b[4] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24)};
+        fwrite(b, 1, sizeof(b), f);
+    }
+
+    void AppendU32BE(std::vector<uint8_t> &out, uint32_t v)
+    {
+        out.push_back(v >> 24);
+        out.push_back(v >> 16);
+        out.push_back(v >> 8);
+        out.push_back(v);
+    }
+
+    uint32_t Crc32(const uint8_t *data, size_t length, uint32_t crc = 0)
+    {
+        static uint32_t table[256];
+        if (!table[1])
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[i] = c;
+            }
+        }
+        crc = ~crc;
+        for (size_t i = 0; i < length; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void WritePngChunk(FILE *f, const char *type, const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> chunk(type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        std::vector<uint8_t> length;
+        AppendU32BE(length, data.size());
+        std::vector<uint8_t> crc;
+        AppendU32BE(crc, Crc32(chunk.data(), chunk.size()));
+        fwrite(length.data(), 1, length.size(), f);
+        fwrite(chunk.data(), 1, chunk.size(), f);
+        fwrite(crc.data(), 1, crc.size(), f);
+    }
+
+    // zlib stream made of uncompressed ("stored") deflate blocks, so no compression library is needed
+    std::vector<uint8_t> ZlibStore(const std::vector<uint8_t> &raw)
+    {
+        std::vector<uint8_t> out = {0x78, 0x01};
+        size_t offset = 0;
+        do
+        {
+            size_t blockLength = std::min<size_t>(raw.size() - offset, 0xFFFF);
+            bool last = offset + blockLength == raw.size();
+            out.push_back(last ? 1 : 0);
+            out.push_back(blockLength & 0xFF);
+            out.push_back(blockLength >> 8);
+            out.push_back(~blockLength & 0xFF);
+            out.push_back((~blockLength >> 8) & 0xFF);
+            out.insert(out.end(), raw.begin() + offset, raw.begin() + offset + blockLength);
+            offset += blockLength;
+        } while (offset < raw.size());
+
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : raw)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        AppendU32BE(out, (b << 16) | a);
+        return out;
+    }
+}
+
+SimulatedLedController::SimulatedLedController(std::function<uint64_t()> clock)
+    : clock(clock), terminal(nullptr), terminalHasFrame(false)
+{
+    if (!this->clock)
+    {
+        this->clock = []()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now().time_since_epoch())
+                                             .count());
+        };
+    }
+    AllocateFrame();
+}
+
+void SimulatedLedController::SetTerminalOutput(FILE *terminal)
+{
+    this->terminal = terminal;
+    terminalHasFrame = false;
+}
+
+void SimulatedLedController::Flush()
+{
+    RenderOutput();
+    frames.push_back({clock(), std::vector<uint8_t>(output, output + FrameBytes())});
+    // record what the strips would show, i.e. after color correction and power limiting
+    uint8_t brightness = OutputBrightness();
+    if (brightness < 255)
+    {
+        PixelKernels::ScaleVideo(frames.back().pixels.data(), frames.back().pixels.size(), brightness);
+    }
+    if (terminal)
+    {
+        DrawToTerminal(frames.back());
+    }
+}
+
+double SimulatedLedController::FramesPerSecond() const
+{
+    if (frames.size() < 2)
+        return 0.0;
+    uint64_t spanUs = frames.back().timestampUs - frames.front().timestampUs;
+    return spanUs ? (frames.size() - 1) * 1e6 / spanUs : 0.0;
+}
+
+uint64_t SimulatedLedController::WireBytes() const
+{
+    uint64_t bytesPerFrame = 0;
+    for (auto &strip : PianoLedConfig::globalConfig.strips)
+    {
+        bytesPerFrame += strip.totalLeds * (strip.rgbw ? 4 : 3);
+    }
+    return bytesPerFrame * frames.size();
+}
+
+void SimulatedLedController::DrawToTerminal(const Frame &frame)
+{
+    if (terminalHasFrame)
+    {
+        fprintf(terminal, "\x1b[%zuA", stripCount); // move back up and redraw in place
+    }
+    for (size_t strip = 0; strip < stripCount; ++strip)
+    {
+        const uint8_t *pixel = frame.pixels.data() + strip * ledsPerStrip * 3;
+        for (size_t led = 0; led < ledsPerStrip; ++led, pixel += 3)
+        {
+            fprintf(terminal, "\x1b[48;2;%u;%u;%um ", pixel[0], pixel[1], pixel[2]);
+        }
+        fprintf(terminal, "\x1b[0m\n");
+    }
+    fflush(terminal);
+    terminalHasFrame = true;
+}
+
+bool SimulatedLedController::WriteFrameLog(const char *path) const
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    fwrite("PLFL", 1, 4, f);
+    fputc(frameLogVersion, f);
+    fputc(static_cast<int>(stripCount), f);
+    WriteU16(f, static_cast<uint16_t>(ledsPerStrip));
+
+    const size_t pixelCount = stripCount * ledsPerStrip;
+    const std::vector<uint8_t> *previous = nullptr;
+    uint64_t previousTimestamp = frames.empty() ? 0 : frames.front().timestampUs;
+    for (auto &frame : frames)
+    {
+        WriteU32(f, static_cast<uint32_t>(frame.timestampUs - previousTimestamp));
+        previousTimestamp = frame.timestampUs;
+
+        std::vector<uint16_t> changed;
+        if (previous && previous->size() == frame.pixels.size())
+        {
+            for (size_t i = 0; i < pixelCount; ++i)
+            {
+                if (memcmp(previous->data() + i * 3, frame.pixels.data() + i * 3, 3) != 0)
+                    changed.push_back(static_cast<uint16_t>(i));
+            }
+        }
+
+        // a key frame is smaller as soon as more than 3 out of 5 pixels changed
+        if (!previous || previous->size() != frame.pixels.size() || changed.size() * 5 >= pixelCount * 3)
+        {
+            WriteU16(f, keyFrameMarker);
+            fwrite(frame.pixels.data(), 1, frame.pixels.size(), f);
+        }
+        else
+        {
+            WriteU16(f, static_cast<uint16_t>(changed.size()));
+            for (uint16_t i : changed)
+            {
+                WriteU16(f, i);
+                fwrite(frame.pixels.data() + i * 3, 1, 3, f);
+            }
+        }
+        previous = &frame.pixels;
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+std::vector<uint8_t> SimulatedLedController::RenderImage(size_t &width, size_t &height) const
+{
+    // strips side by side, one row per frame
+    width = stripCount * ledsPerStrip;
+    height = frames.size();
+    std::vector<uint8_t> image;
+    image.reserve(width * height * 3);
+    for (auto &frame : frames)
+    {
+        image.insert(image.end(), frame.pixels.begin(), frame.pixels.end());
+    }
+    return image;
+}
+
+bool SimulatedLedController::WritePpm(const char *path) const
+{
+    size_t width, height;
+    std::vector<uint8_t> image = RenderImage(width, height);
+    if (width == 0 || height == 0)
+        return false;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+    fprintf(f, "P6\n%zu %zu\n255\n", width, height);
+    fwrite(image.data(), 1, image.size(), f);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+bool SimulatedLedController::WritePng(const char *path) const
+{
+    size_t width, height;
+    std::vector<uint8_t> image = RenderImage(width, height);
+    if (width == 0 || height == 0)
+        return false;
+
+    // every scanline starts with filter type 0 (none)
+    std::vector<uint8_t> raw;
+    raw.reserve(height * (width * 3 + 1));
+    for (size_t y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.begin() + y * width * 3, image.begin() + (y + 1) * width * 3);
+    }
+
+    std::vector<uint8_t> header;
+    AppendU32BE(header, width);
+    AppendU32BE(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit, truecolor, deflate, no filter, no interlace
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, sizeof(signature), f);
+    WritePngChunk(f, "IHDR", header);
+    WritePngChunk(f, "IDAT", ZlibStore(raw));
+    WritePngChunk(f, "IEND", {});
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+#endif // !ARDUINO
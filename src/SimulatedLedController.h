@@ -0,0 +1,69 @@
+#ifndef SIMULATED_LED_CONTROLLER_H
+#define SIMULATED_LED_CONTROLLER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "FrameBufferLedController.h"
+
+/**
+ * Host-only LED controller that shows what the strips would display without any hardware attached.
+ *
+ * Every flushed frame is recorded together with a timestamp. The recording can be written out as a compact binary
+ * frame log, or as a PPM/PNG image with one row per frame (time runs downwards) and the strips side by side.
+ * Optionally every frame is also drawn live to a terminal using ANSI truecolor escape codes.
+ *
+ * Only compiled for non-Arduino builds.
+ */
+class SimulatedLedController : public FrameBufferLedController
+{
+public:
+    struct Frame
+    {
+        uint64_t timestampUs;
+        std::vector<uint8_t> pixels;
+    };
+
+    /**
+     * @param clock returns the current time in microseconds. Defaults to a monotonic wall clock; pass a simulated
+     * clock to get reproducible recordings for golden-image comparisons.
+     */
+    explicit SimulatedLedController(std::function<uint64_t()> clock = nullptr);
+
+    /**
+     * Draws every flushed frame to \p terminal (e.g. stdout), redrawing in place. Pass nullptr to stop.
+     */
+    void SetTerminalOutput(FILE *terminal);
+
+    const std::vector<Frame> &Frames() const { return frames; }
+    void ClearFrames() { frames.clear(); }
+
+    /**
+     * Frames per second over the recorded time span.
+     */
+    double FramesPerSecond() const;
+
+    /**
+     * Bytes the recorded frames would have put on the data lines. Every show() clocks out all LEDs of every strip.
+     */
+    uint64_t WireBytes() const;
+
+    bool WriteFrameLog(const char *path) const;
+    bool WritePpm(const char *path) const;
+    bool WritePng(const char *path) const;
+
+protected:
+    void Flush() override;
+
+private:
+    std::function<uint64_t()> clock;
+    std::vector<Frame> frames;
+    FILE *terminal;
+    bool terminalHasFrame;
+
+    void DrawToTerminal(const Frame &frame);
+    std::vector<uint8_t> RenderImage(size_t &width, size_t &height) const;
+};
+
+#endif // SIMULATED_LED_CONTROLLER_H
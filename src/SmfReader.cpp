@@ -0,0 +1,245 @@
+#include "SmfReader.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr uint8_t tempoStatus = 0xFF;
+    constexpr uint32_t defaultTempoUsPerQuarterNote = 500000;
+
+    uint32_t ReadBigEndian(const uint8_t *bytes, size_t count)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            value = value << 8 | bytes[i];
+        }
+        return value;
+    }
+}
+
+SmfReader::SmfReader()
+    : source(nullptr), format(0), division(0), trackCount(0), heapSize(0), tempoTick(0), tempoTimeUs(0),
+      tempoUsPerQuarterNote(defaultTempoUsPerQuarterNote)
+{
+}
+
+bool SmfReader::Open(SmfSource &source)
+{
+    this->source = &source;
+    trackCount = 0;
+    heapSize = 0;
+    tempoTick = 0;
+    tempoTimeUs = 0;
+    tempoUsPerQuarterNote = defaultTempoUsPerQuarterNote;
+
+    uint8_t header[14];
+    if (source.Read(0, header, sizeof(header)) != sizeof(header) || !std::equal(header, header + 4, "MThd"))
+        return false;
+    uint32_t headerLength = ReadBigEndian(header + 4, 4);
+    format = ReadBigEndian(header + 8, 2);
+    division = static_cast<int16_t>(ReadBigEndian(header + 12, 2));
+    // SMPTE timing needs ticks per frame, TickToUs divides by them
+    if (headerLength < 6 || format > 1 || division == 0 || (division < 0 && (division & 0xFF) == 0))
+        return false;
+
+    uint32_t offset = 8 + headerLength;
+    uint8_t chunk[8];
+    while (trackCount < maxTracks && source.Read(offset, chunk, sizeof(chunk)) == sizeof(chunk))
+    {
+        uint32_t length = ReadBigEndian(chunk + 4, 4);
+        offset += sizeof(chunk);
+        if (std::equal(chunk, chunk + 4, "MTrk"))
+        {
+            TrackCursor &track = tracks[trackCount];
+            track.position = offset;
+            track.end = offset + length;
+            track.bufferOffset = 0;
+            track.bufferLength = 0;
+            track.runningStatus = 0;
+            track.tick = 0;
+            if (ParseNextEvent(track))
+                HeapPush(trackCount);
+            ++trackCount;
+        }
+        offset += length;
+    }
+    return trackCount > 0;
+}
+
+bool SmfReader::Next(Event &event)
+{
+    while (heapSize > 0)
+    {
+        uint8_t index = HeapPop();
+        TrackCursor &track = tracks[index];
+        uint64_t timeUs = TickToUs(track.tick);
+        bool isTempo = track.status == tempoStatus;
+        if (isTempo)
+        {
+            tempoTick = track.tick;
+            tempoTimeUs = timeUs;
+            tempoUsPerQuarterNote = track.tempo;
+        }
+        else
+        {
+            event = {timeUs, track.status, track.data1, track.data2, index};
+        }
+
+        if (ParseNextEvent(track))
+            HeapPush(index);
+        if (!isTempo)
+            return true;
+    }
+    return false;
+}
+
+bool SmfReader::ReadByte(TrackCursor &track, uint8_t &out)
+{
+    if (track.position >= track.end)
+        return false;
+
+    if (track.position - track.bufferOffset >= track.bufferLength)
+    {
+        size_t count = std::min(static_cast<size_t>(track.end - track.position), trackBufferSize);
+        track.bufferOffset = track.position;
+        track.bufferLength = source->Read(track.position, track.buffer.data(), count);
+        if (track.bufferLength == 0)
+            return false;
+    }
+    out = track.buffer[track.position++ - track.bufferOffset];
+    return true;
+}
+
+bool SmfReader::ReadVariableLength(TrackCursor &track, uint32_t &out)
+{
+    out = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        uint8_t byte;
+        if (!ReadByte(track, byte))
+            return false;
+        out = out << 7 | (byte & 0x7F);
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool SmfReader::ParseNextEvent(TrackCursor &track)
+{
+    for (;;)
+    {
+        uint32_t delta;
+        uint8_t byte;
+        if (!ReadVariableLength(track, delta) || !ReadByte(track, byte))
+            return false;
+        track.tick += delta;
+
+        if (byte == 0xFF)
+        {
+            uint8_t type;
+            uint32_t length;
+            if (!ReadByte(track, type) || !ReadVariableLength(track, length))
+                return false;
+            track.runningStatus = 0;
+            if (type == 0x2F)
+                return false; // end of track
+            if (type == 0x51 && length == 3)
+            {
+                uint8_t tempo[3];
+                if (!ReadByte(track, tempo[0]) || !ReadByte(track, tempo[1]) || !ReadByte(track, tempo[2]))
+                    return false;
+                track.status = tempoStatus;
+                track.tempo = ReadBigEndian(tempo, 3);
+                return track.tempo > 0 || ParseNextEvent(track);
+            }
+            track.position += length;
+            continue;
+        }
+
+        if (byte == 0xF0 || byte == 0xF7)
+        {
+            uint32_t length;
+            if (!ReadVariableLength(track, length))
+                return false;
+            track.runningStatus = 0;
+            track.position += length;
+            continue;
+        }
+
+        if (byte >= 0xF0)
+            return false; // system messages other than sysex are not valid in a file
+
+        uint8_t status = byte;
+        bool haveData1 = false;
+        if (byte < 0x80)
+        {
+            // running status: the byte is the first data byte
+            if (track.runningStatus == 0)
+                return false;
+            status = track.runningStatus;
+            track.data1 = byte;
+            haveData1 = true;
+        }
+        track.runningStatus = status;
+        track.status = status;
+        if (!haveData1 && !ReadByte(track, track.data1))
+            return false;
+        track.data2 = 0;
+        uint8_t kind = status & 0xF0;
+        if (kind != 0xC0 && kind != 0xD0 && !ReadByte(track, track.data2))
+            return false;
+        return true;
+    }
+}
+
+uint64_t SmfReader::TickToUs(uint64_t tick) const
+{
+    if (division < 0)
+    {
+        // SMPTE: frames per second (negative) in the high byte, ticks per frame in the low byte
+        uint32_t framesPerSecond = -static_cast<int8_t>(division >> 8);
+        uint32_t ticksPerFrame = division & 0xFF;
+        if (framesPerSecond == 29)
+            return tick * 1001000000ULL / (30000ULL * ticksPerFrame); // 29.97 drop frame
+        return tick * 1000000ULL / (framesPerSecond * ticksPerFrame);
+    }
+    return tempoTimeUs + (tick - tempoTick) * tempoUsPerQuarterNote / division;
+}
+
+bool SmfReader::Earlier(uint8_t a, uint8_t b) const
+{
+    return tracks[a].tick < tracks[b].tick || (tracks[a].tick == tracks[b].tick && a < b);
+}
+
+void SmfReader::HeapPush(uint8_t track)
+{
+    size_t i = heapSize++;
+    heap[i] = track;
+    while (i > 0 && Earlier(heap[i], heap[(i - 1) / 2]))
+    {
+        std::swap(heap[i], heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+}
+
+uint8_t SmfReader::HeapPop()
+{
+    uint8_t top = heap[0];
+    heap[0] = heap[--heapSize];
+    size_t i = 0;
+    for (;;)
+    {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < heapSize && Earlier(heap[left], heap[smallest]))
+            smallest = left;
+        if (right < heapSize && Earlier(heap[right], heap[smallest]))
+            smallest = right;
+        if (smallest == i)
+            return top;
+        std::swap(heap[i], heap[smallest]);
+        i = smallest;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef SMF_READER_H
+#define SMF_READER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Random access byte source of a Standard MIDI File, e.g. a file on LittleFS or the SD card.
+ */
+class SmfSource
+{
+public:
+    virtual ~SmfSource() = default;
+
+    /**
+     * Reads up to \p count bytes at \p offset. Returns the number of bytes read, 0 at the end of the file.
+     */
+    virtual size_t Read(uint32_t offset, uint8_t *buffer, size_t count) = 0;
+};
+
+/**
+ * Streaming Standard MIDI File (format 0 and 1) parser.
+ *
+ * The file is never loaded as a whole: every track has a cursor with a small read buffer that is refilled from the
+ * \ref SmfSource as the track is consumed, and sysex and meta events other than tempo changes are skipped without
+ * reading them. The tracks are merged in time order through a min-heap of the cursors, ordered by the tick of their
+ * next event, so each event costs O(log tracks). Tick times are converted to microseconds using the tempo map.
+ *
+ * Does not allocate; the memory use is fixed by \ref maxTracks and \ref trackBufferSize.
+ */
+class SmfReader
+{
+public:
+    static constexpr size_t maxTracks = 32;
+    static constexpr size_t trackBufferSize = 32;
+
+    struct Event
+    {
+        uint64_t timeUs; // since the start of the file
+        uint8_t status;  // channel voice message, 0x80-0xEF
+        uint8_t data1;
+        uint8_t data2;   // 0 for messages with one data byte
+        uint8_t track;
+    };
+
+    SmfReader();
+
+    /**
+     * Parses the header and locates the tracks. Tracks beyond \ref maxTracks are ignored.
+     * @return false if \p source is not a Standard MIDI File.
+     */
+    bool Open(SmfSource &source);
+
+    /**
+     * Reads the next channel voice event of all tracks in time order.
+     * @return false at the end of the file or on a read error.
+     */
+    bool Next(Event &event);
+
+    size_t TrackCount() const { return trackCount; }
+    uint16_t Format() const { return format; }
+
+private:
+    struct TrackCursor
+    {
+        uint32_t position; // of the next byte to parse
+        uint32_t end;
+        uint32_t bufferOffset;
+        uint8_t bufferLength;
+        uint8_t runningStatus;
+        std::array<uint8_t, trackBufferSize> buffer;
+
+        // the next event, parsed ahead so the cursor can be ordered by its tick
+        uint64_t tick;
+        uint8_t status; // 0xFF for tempo changes
+        uint8_t data1;
+        uint8_t data2;
+        uint32_t tempo;
+    };
+
+    SmfSource *source;
+    uint16_t format;
+    int16_t division; // ticks per quarter note, or negative SMPTE frames per second in the high byte
+    std::array<TrackCursor, maxTracks> tracks;
+    size_t trackCount;
+
+    // min-heap of track indices by (tick, track)
+    std::array<uint8_t, maxTracks> heap;
+    size_t heapSize;
+
+    // the tempo map is applied incrementally: tick times after tempoTick use tempoUsPerQuarterNote
+    uint64_t tempoTick;
+    uint64_t tempoTimeUs;
+    uint32_t tempoUsPerQuarterNote;
+
+    bool ReadByte(TrackCursor &track, uint8_t &out);
+    bool ReadVariableLength(TrackCursor &track, uint32_t &out);
+    bool ParseNextEvent(TrackCursor &track);
+    uint64_t TickToUs(uint64_t tick) const;
+
+    bool Earlier(uint8_t a, uint8_t b) const;
+    void HeapPush(uint8_t track);
+    uint8_t HeapPop();
+};
+
+#endif // SMF_READER_H
@@ -0,0 +1,113 @@
+#include "TaskScheduler.h"
+#include <algorithm>
+
+TaskScheduler::TaskScheduler(Clock clock)
+    : onTaskRun(nullptr), clock(clock), running(nullptr), runningStartUs(0), lastPassUs(clock()), elapsedUs(0)
+{
+}
+
+void TaskScheduler::addTask(const char *name, Priority priority, uint32_t periodUs, uint32_t budgetUs, std::function<void()> run)
+{
+    // after the tasks of the same priority, so ties keep the order they were added in
+    auto position = std::upper_bound(taskList.begin(), taskList.end(), priority, [](Priority p, const Task &task)
+                                     { return p < task.priority; });
+    taskList.insert(position, Task{name, priority, periodUs, budgetUs, run, clock(), TaskStats()});
+}
+
+void TaskScheduler::runOnce()
+{
+    uint32_t now = clock();
+    elapsedUs += now - lastPassUs;
+    lastPassUs = now;
+
+    runCritical();
+    for (Task &task : taskList)
+    {
+        if (task.priority == Priority::Critical || !due(task, clock()))
+            continue;
+        run(task);
+        runCritical();
+    }
+}
+
+void TaskScheduler::runCritical()
+{
+    for (Task &task : taskList)
+    {
+        if (task.priority != Priority::Critical)
+            break;
+        if (due(task, clock()))
+            run(task);
+    }
+}
+
+bool TaskScheduler::due(const Task &task, uint32_t now) const
+{
+    return task.periodUs == 0 || static_cast<int32_t>(now - task.nextRunUs) >= 0;
+}
+
+void TaskScheduler::run(Task &task)
+{
+    running = &task;
+    runningStartUs = clock();
+    task.run();
+    uint32_t end = clock();
+    running = nullptr;
+
+    uint32_t durationUs = end - runningStartUs;
+    TaskStats &stats = task.stats;
+    ++stats.runs;
+    stats.totalUs += durationUs;
+    stats.lastUs = durationUs;
+    stats.maxUs = std::max(stats.maxUs, durationUs);
+    if (durationUs > task.budgetUs)
+        ++stats.overruns;
+
+    if (task.periodUs > 0)
+    {
+        // keep the phase, but do not make up missed runs
+        task.nextRunUs += task.periodUs;
+        if (static_cast<int32_t>(end - task.nextRunUs) >= 0)
+            task.nextRunUs = runningStartUs + task.periodUs;
+    }
+
+    if (onTaskRun)
+        onTaskRun(task, durationUs);
+}
+
+bool TaskScheduler::sliceExpired() const
+{
+    return running && clock() - runningStartUs >= running->budgetUs;
+}
+
+float TaskScheduler::cpuShare(const Task &task) const
+{
+    return elapsedUs > 0 ? 100.0f * task.stats.totalUs / elapsedUs : 0.0f;
+}
+
+void TaskScheduler::resetStats()
+{
+    for (Task &task : taskList)
+        task.stats = TaskStats();
+    elapsedUs = 0;
+}
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+
+void TaskScheduler::printStats(Print &out) const
+{
+    float idle = 100.0f;
+    for (const Task &task : taskList)
+    {
+        float share = cpuShare(task);
+        idle -= share;
+        out.printf("  %-12s %5.1f%% CPU, %lu runs, last %lu us, max %lu us, budget %lu us, %lu overruns\n", task.name,
+                   share, (unsigned long)task.stats.runs, (unsigned long)task.stats.lastUs,
+                   (unsigned long)task.stats.maxUs, (unsigned long)task.budgetUs, (unsigned long)task.stats.overruns);
+    }
+    out.printf("  %-12s %5.1f%% CPU\n", "other", std::max(idle, 0.0f));
+}
+
+#endif // ARDUINO
@@ -0,0 +1,108 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class Print;
+
+/**
+ * Cooperative scheduler for the main loop.
+ *
+ * Tasks run to completion; each has a priority, a period (0: whenever the scheduler runs) and a time budget per run.
+ * A pass of \ref runOnce runs the due tasks in priority order, ties in the order they were added, and runs the due
+ * \ref Priority::Critical tasks (MIDI input) before the pass and again after every other task, so latency critical
+ * work never waits for more than one background slice. A task that misses its period runs once as soon as it can,
+ * runs are not made up.
+ *
+ * The budget is not enforced: runs that take longer are counted as overruns, and long running tasks can check
+ * \ref sliceExpired to stop early. The clock is passed in, so the scheduler behaves the same on the host with a
+ * simulated clock (see tools/TaskSchedulerSimulation.cpp).
+ */
+class TaskScheduler
+{
+public:
+    using Clock = uint32_t (*)(); // microseconds, may wrap
+
+    enum class Priority : uint8_t
+    {
+        Critical, // also runs between all other tasks
+        High,
+        Normal,
+        Background,
+    };
+
+    struct TaskStats
+    {
+        uint32_t runs = 0;
+        uint64_t totalUs = 0;
+        uint32_t lastUs = 0;
+        uint32_t maxUs = 0;
+        uint32_t overruns = 0; // runs longer than the budget
+    };
+
+    struct Task
+    {
+        const char *name;
+        Priority priority;
+        uint32_t periodUs;
+        uint32_t budgetUs;
+        std::function<void()> run;
+
+        uint32_t nextRunUs;
+        TaskStats stats;
+    };
+
+    /**
+     * Called after every task run with its duration, e.g. for stall detection.
+     */
+    std::function<void(const Task &task, uint32_t durationUs)> onTaskRun;
+
+    explicit TaskScheduler(Clock clock);
+
+    /**
+     * Adds a task; tasks are meant to be added once at startup. \p name must be a string literal.
+     */
+    void addTask(const char *name, Priority priority, uint32_t periodUs, uint32_t budgetUs, std::function<void()> run);
+
+    /**
+     * Runs one pass over the due tasks.
+     */
+    void runOnce();
+
+    /**
+     * True if the running task has used up its budget. Tasks doing work in chunks can stop early and continue in
+     * their next run.
+     */
+    bool sliceExpired() const;
+
+    const std::vector<Task> &tasks() const { return taskList; }
+
+    /**
+     * Share of the time since the last \ref resetStats that \p task ran, in percent, as of the last pass.
+     */
+    float cpuShare(const Task &task) const;
+
+    void resetStats();
+
+    /**
+     * Prints the statistics of every task. Only available in Arduino builds.
+     */
+    void printStats(Print &out) const;
+
+private:
+    Clock clock;
+    std::vector<Task> taskList; // in priority order
+    Task *running;
+    uint32_t runningStartUs;
+    uint32_t lastPassUs;
+    uint64_t elapsedUs; // since the last resetStats, up to the last pass
+
+    bool due(const Task &task, uint32_t now) const;
+    void run(Task &task);
+    void runCritical();
+};
+
+#endif // TASK_SCHEDULER_H
@@ -0,0 +1,36 @@
+#include "VelocityCalibration.h"
+
+VelocityCalibration::VelocityCalibration()
+    : samples(0), active(false)
+{
+    histogram.fill(0);
+}
+
+void VelocityCalibration::Start()
+{
+    histogram.fill(0);
+    samples = 0;
+    active = true;
+}
+
+bool VelocityCalibration::BuildCurve(std::vector<uint8_t> &curve) const
+{
+    if (samples < minimumSamples)
+        return false;
+
+    // Every velocity gets a small share of the range even if it was never played, so the curve keeps rising outside
+    // of the recorded distribution. All of these shares together weigh about 1/8 of the samples.
+    const uint64_t prior = samples / (8 * (velocityCount - 1)) + 1;
+    const uint64_t total = samples + prior * (velocityCount - 1);
+
+    curve.assign(velocityCount, 0);
+    uint64_t below = 0;
+    for (size_t velocity = 1; velocity < velocityCount; ++velocity)
+    {
+        uint64_t weight = histogram[velocity] + prior;
+        // midpoint of this velocity's share of the cumulative distribution, mapped onto 1..127
+        curve[velocity] = static_cast<uint8_t>(1 + (126 * (2 * below + weight) + total) / (2 * total));
+        below += weight;
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef VELOCITY_CALIBRATION_H
+#define VELOCITY_CALIBRATION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Learns how a keyboard's velocities are distributed while it is played and derives a velocity remap curve that
+ * spreads them over the whole 1-127 range (histogram equalization), so VelocityBased colors use the whole palette.
+ *
+ * Recording is a single counter increment per note on; the curve is only computed when calibration is finished.
+ */
+class VelocityCalibration
+{
+public:
+    static constexpr size_t velocityCount = 128;
+
+    /**
+     * Minimum number of recorded notes for \ref BuildCurve to produce a curve.
+     */
+    static constexpr uint32_t minimumSamples = 100;
+
+    VelocityCalibration();
+
+    /**
+     * Clears the histogram and starts recording.
+     */
+    void Start();
+    void Stop() { active = false; }
+    bool Active() const { return active; }
+
+    void Record(uint8_t velocity)
+    {
+        if (active && velocity > 0 && velocity < velocityCount)
+        {
+            ++histogram[velocity];
+            ++samples;
+        }
+    }
+
+    uint32_t Samples() const { return samples; }
+
+    /**
+     * Derives the remap curve from the recorded velocities.
+     * @param curve Receives 128 entries, curve[velocity] being the velocity used for the color. Unchanged on failure.
+     * @return false if fewer than \ref minimumSamples notes were recorded.
+     */
+    bool BuildCurve(std::vector<uint8_t> &curve) const;
+
+private:
+    std::array<uint32_t, velocityCount> histogram;
+    uint32_t samples;
+    bool active;
+};
+
+#endif // VELOCITY_CALIBRATION_H
@@ -0,0 +1,145 @@
+// Drives the non-blocking LED controller (src/DmaLedController.cpp) against the host stand-in of the DMA hardware
+// (src/MockLedDmaEngine.h) and checks the double-buffer handoff. The output is the same on every run.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/DmaHandoffCheck.cpp src/DmaLedController.cpp src/FrameBufferLedController.cpp src/PianoLedConfig.cpp src/ColorCorrection.cpp src/PixelKernels.cpp src/PowerLimiter.cpp src/RgbwConverter.cpp src/MemoryMap.cpp -o dma_check
+//   ./dma_check
+//
+// Checks that commits made while a transfer is in flight are deferred and not handed to the engine, that the engine is
+// never handed a frame while it is busy, and that once the transfer completes Update hands over exactly the latest
+// frame, with the brightness the power limiter gives for it. Then plays random frames with random completion times.
+
+#include <cstdio>
+#include <vector>
+#include "DmaLedController.h"
+#include "MockLedDmaEngine.h"
+
+namespace
+{
+    constexpr int stripLeds = 148;
+    constexpr int budgetMilliamps = 1000;
+
+    uint32_t seed = 12345;
+
+    uint32_t Random(uint32_t range)
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    }
+
+    int failures = 0;
+
+    void Check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            printf("FAILED: %s\n", what);
+            ++failures;
+        }
+    }
+
+    // exposes the frame the controller draws into, to compare it with what the engine was handed
+    class Controller : public DmaLedController
+    {
+    public:
+        using DmaLedController::DmaLedController;
+
+        std::vector<uint8_t> Frame() const { return std::vector<uint8_t>(FrameData(), FrameData() + FrameBytes()); }
+    };
+
+    // the brightness the power limiter has to give \p frame, from a limiter of its own
+    uint8_t ExpectedBrightness(const std::vector<uint8_t> &frame)
+    {
+        PowerLimiter limiter;
+        limiter.Reset({stripLeds});
+        limiter.SetBudgets({budgetMilliamps}, 0);
+        limiter.PixelsChanged(0, 0, PowerLimiter::ChannelSum(frame.data(), frame.size()));
+        return limiter.BeginFrame();
+    }
+
+    void Draw(Controller &controller, int led, int ledCount, const LedColor &color)
+    {
+        controller.StageIndividualLedColors({NeoPixelColor(0, led, color, 255, ledCount)});
+        controller.Commit();
+    }
+}
+
+int main()
+{
+    // one strip without color correction, so the engine gets the frame as drawn
+    PianoLedConfig::globalConfig.strips.resize(1);
+    PianoLedConfig::globalConfig.strips[0].totalLeds = stripLeds;
+    PianoLedConfig::globalConfig.strips[0].colorCorrection = false;
+    PianoLedConfig::globalConfig.strips[0].maxMilliamps = budgetMilliamps;
+    PianoLedConfig::globalConfig.powerBudgetMilliamps = 0;
+
+    MockLedDmaEngine engine;
+    Controller controller(&engine);
+
+    // the first frame goes out right away and keeps the engine busy
+    Draw(controller, 0, 1, LedColor(255, 0, 0));
+    Check(engine.transmitted.size() == 1, "a commit to an idle engine was not transmitted");
+    Check(controller.FramesTransmitted() == 1, "FramesTransmitted does not count the first frame");
+    Check(engine.Busy(), "the engine is not busy after a transmit");
+
+    // commits while the transfer is in flight: the first waits, every further one is merged into it
+    Draw(controller, 10, 5, LedColor(0, 255, 0));
+    Check(controller.FramesDeferred() == 0, "the first commit during a transfer counted as deferred");
+    Draw(controller, 20, 5, LedColor(0, 0, 255));
+    Check(controller.FramesDeferred() == 1, "FramesDeferred did not count a commit merged into the pending frame");
+    Draw(controller, 0, stripLeds, LedColor(255, 255, 255)); // draws more than the budget allows
+    Check(controller.FramesDeferred() == 2, "FramesDeferred did not count a commit merged into the pending frame");
+    controller.Update();
+    Check(engine.transmitted.size() == 1, "a frame was handed to the busy engine");
+    Check(controller.FramesTransmitted() == 1, "FramesTransmitted counted a frame the engine did not get");
+
+    // the completion interrupt; the next Update hands over the latest frame only
+    const std::vector<uint8_t> latest = controller.Frame();
+    engine.CompleteTransfer();
+    controller.Update();
+    Check(engine.transmitted.size() == 2, "the pending frame was not transmitted after the transfer completed");
+    Check(engine.transmitted.back() == latest, "the transmitted frame is not the latest one");
+    Check(engine.brightnesses.back() == ExpectedBrightness(latest), "the latest frame went out with the wrong brightness");
+    Check(engine.brightnesses.back() < 255, "the full white frame was not limited");
+    Check(engine.brightnesses.front() == 255, "the single LED frame was limited");
+    controller.Update();
+    Check(engine.transmitted.size() == 2, "a frame was transmitted twice");
+
+    // random commits and completions
+    uint32_t commits = 0;
+    for (int step = 0; step < 20000; ++step)
+    {
+        switch (Random(4))
+        {
+        case 0:
+            engine.CompleteTransfer();
+            break;
+        case 1:
+            controller.Update();
+            break;
+        default:
+        {
+            const int led = Random(stripLeds);
+            const int count = 1 + Random(stripLeds - led);
+            Draw(controller, led, count, LedColor(Random(256), Random(256), Random(256)));
+            ++commits;
+            break;
+        }
+        }
+    }
+    engine.CompleteTransfer();
+    controller.Update();
+    const std::vector<uint8_t> last = controller.Frame();
+    Check(engine.transmitted.back() == last, "the last frame never went out");
+    Check(engine.brightnesses.back() == ExpectedBrightness(last), "the last frame went out with the wrong brightness");
+    Check(engine.transmitOverlaps == 0, "a frame was handed to the engine during a transfer");
+    // every commit is either transmitted, or deferred into a frame that is transmitted
+    Check(controller.FramesTransmitted() + controller.FramesDeferred() == commits + 4,
+          "commits neither transmitted nor deferred");
+    Check(controller.Power().Frames() == controller.FramesTransmitted(), "the power limiter ran for frames not sent");
+
+    printf("%u commits, %u frames transmitted, %u deferred, %u limited\n", commits + 4, controller.FramesTransmitted(),
+           controller.FramesDeferred(), controller.Power().FramesLimited());
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+// Checks the color tables compiled by NoteColorTable (src/NoteColorTable.cpp, through src/GradientColorMapping.cpp)
+// against a reference implementation of the gradient color spaces in double precision. The output is the same on
+// every run.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/GradientInterpolationCheck.cpp src/NoteColorTable.cpp src/GradientColorMapping.cpp -o gradient_check
+//   ./gradient_check
+//
+// For every interpolation (Rgb, HsvShortHue, HsvLongHue, OkLab) and a set of palettes - hue wrap-arounds, grays,
+// black and white, several stops - every entry of a VelocityBased and a NoteBased table must be within 1 LSB per
+// channel of the reference.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "NoteColorTable.h"
+
+namespace
+{
+    using Interpolation = GradientColorMapping::Interpolation;
+
+    struct Rgb
+    {
+        double r, g, b; // 0-1
+    };
+
+    int failures = 0;
+
+    Rgb FromLed(const LedColor &c) { return {c.r / 255.0, c.g / 255.0, c.b / 255.0}; }
+
+    // hue in degrees, saturation and value 0-1
+    void RgbToHsv(const Rgb &c, double &h, double &s, double &v)
+    {
+        const double max = std::max({c.r, c.g, c.b});
+        const double min = std::min({c.r, c.g, c.b});
+        const double chroma = max - min;
+        v = max;
+        s = max > 0 ? chroma / max : 0;
+        if (chroma == 0)
+            h = 0;
+        else if (max == c.r)
+            h = 60 * std::fmod((c.g - c.b) / chroma + 6, 6);
+        else if (max == c.g)
+            h = 60 * ((c.b - c.r) / chroma + 2);
+        else
+            h = 60 * ((c.r - c.g) / chroma + 4);
+    }
+
+    Rgb HsvToRgb(double h, double s, double v)
+    {
+        h = std::fmod(std::fmod(h, 360) + 360, 360);
+        // the standard formula per channel: f(n) = v - v s max(0, min(k, 4 - k, 1)), k = (n + h / 60) mod 6
+        auto f = [&](double n)
+        {
+            const double k = std::fmod(n + h / 60, 6);
+            return v - v * s * std::max(0.0, std::min({k, 4 - k, 1.0}));
+        };
+        return {f(5), f(3), f(1)};
+    }
+
+    double Decode(double c) { return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4); }
+    double Encode(double c) { return c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1 / 2.4) - 0.055; }
+
+    // OKLab as published by Björn Ottosson, as matrices
+    const double toLms[3][3] = {{0.4122214708, 0.5363325363, 0.0514459929},
+                                {0.2119034982, 0.6806995451, 0.1073969566},
+                                {0.0883024619, 0.2817188376, 0.6299787005}};
+    const double lmsToLab[3][3] = {{0.2104542553, 0.7936177850, -0.0040720468},
+                                   {1.9779984951, -2.4285922050, 0.4505937099},
+                                   {0.0259040371, 0.7827717662, -0.8086757660}};
+    const double labToLms[3][3] = {{1, 0.3963377774, 0.2158037573},
+                                   {1, -0.1055613458, -0.0638541728},
+                                   {1, -0.0894841775, -1.2914855480}};
+    const double fromLms[3][3] = {{4.0767416621, -3.3077115913, 0.2309699292},
+                                  {-1.2684380046, 2.6097574011, -0.3413193965},
+                                  {-0.0041960863, -0.7034186147, 1.7076147010}};
+
+    void Multiply(const double m[3][3], const double in[3], double out[3])
+    {
+        for (int row = 0; row < 3; ++row)
+            out[row] = m[row][0] * in[0] + m[row][1] * in[1] + m[row][2] * in[2];
+    }
+
+    void RgbToOkLab(const Rgb &c, double lab[3])
+    {
+        const double linear[3] = {Decode(c.r), Decode(c.g), Decode(c.b)};
+        double lms[3];
+        Multiply(toLms, linear, lms);
+        for (double &x : lms)
+            x = std::cbrt(x);
+        Multiply(lmsToLab, lms, lab);
+    }
+
+    Rgb OkLabToRgb(const double lab[3])
+    {
+        double lms[3];
+        Multiply(labToLms, lab, lms);
+        for (double &x : lms)
+            x = x * x * x;
+        double linear[3];
+        Multiply(fromLms, lms, linear);
+        return {Encode(linear[0]), Encode(linear[1]), Encode(linear[2])};
+    }
+
+    Rgb Mix(const Rgb &a, const Rgb &b, double t)
+    {
+        return {a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t};
+    }
+
+    Rgb Reference(const LedColor &start, const LedColor &end, double t, Interpolation interpolation)
+    {
+        const Rgb a = FromLed(start);
+        const Rgb b = FromLed(end);
+        switch (interpolation)
+        {
+        case Interpolation::HsvShortHue:
+        case Interpolation::HsvLongHue:
+        {
+            double ha, sa, va, hb, sb, vb;
+            RgbToHsv(a, ha, sa, va);
+            RgbToHsv(b, hb, sb, vb);
+            // a gray takes the hue of the other color, so only the saturation fades
+            if (sa == 0)
+                ha = hb;
+            if (sb == 0)
+                hb = ha;
+            double delta = hb - ha;
+            if (delta > 180)
+                delta -= 360;
+            else if (delta < -180)
+                delta += 360;
+            // delta is now the short way; the long way goes around the other side
+            if (interpolation == Interpolation::HsvLongHue && delta != 0)
+                delta += delta > 0 ? -360 : 360;
+            return HsvToRgb(ha + delta * t, sa + (sb - sa) * t, va + (vb - va) * t);
+        }
+        case Interpolation::OkLab:
+        {
+            double la[3], lb[3], lab[3];
+            RgbToOkLab(a, la);
+            RgbToOkLab(b, lb);
+            for (int i = 0; i < 3; ++i)
+                lab[i] = la[i] + (lb[i] - la[i]) * t;
+            return OkLabToRgb(lab);
+        }
+        case Interpolation::Rgb:
+        default:
+            return Mix(a, b, t);
+        }
+    }
+
+    // the palette color at position x in [0, 1] of the whole gradient
+    Rgb ReferenceGradient(const std::vector<LedColor> &palette, double x, Interpolation interpolation)
+    {
+        x = std::max(0.0, std::min(1.0, x));
+        const int segments = static_cast<int>(palette.size()) - 1;
+        if (segments == 0 || x >= 1)
+            return FromLed(palette.back());
+        const double scaled = x * segments;
+        const int index = static_cast<int>(std::floor(scaled));
+        return Reference(palette[index], palette[index + 1], scaled - index, interpolation);
+    }
+
+    int Channel(double value) { return static_cast<int>(std::lround(std::max(0.0, std::min(1.0, value)) * 255)); }
+
+    const char *Name(Interpolation interpolation)
+    {
+        switch (interpolation)
+        {
+        case Interpolation::HsvShortHue:
+            return "HsvShortHue";
+        case Interpolation::HsvLongHue:
+            return "HsvLongHue";
+        case Interpolation::OkLab:
+            return "OkLab";
+        default:
+            return "Rgb";
+        }
+    }
+
+    // returns the largest deviation in LSB
+    int Check(const std::vector<LedColor> &palette, Interpolation interpolation, PianoLedConfig::LedStripColorLayout layout)
+    {
+        constexpr int lowestNote = 21;
+        constexpr int highestNote = 108;
+        PianoLedConfig config;
+        config.colorPalette = palette;
+        config.colorLayout = layout;
+        config.colorCurve = GradientColorMapping::Linear;
+        config.colorInterpolation = interpolation;
+        config.noteOffColorBrightness = 0;
+        static NoteColorTable table; // too big for the stack
+        table.Build(config, lowestNote, highestNote);
+
+        const bool velocityBased = layout == PianoLedConfig::LedStripColorLayout::VelocityBased;
+        int worst = 0;
+        for (int i = 0; i < NoteColorTable::noteCount; ++i)
+        {
+            // the table spreads velocities 1-128 and the notes lowestNote-highestNote over the gradient
+            double x;
+            if (velocityBased)
+            {
+                x = (i - 1) / 127.0;
+            }
+            else
+            {
+                const int note = std::min(std::max(i, lowestNote), highestNote);
+                x = static_cast<double>(note - lowestNote) / (highestNote - lowestNote);
+            }
+            const LedColor got = table.NoteOnColor(0, 1, velocityBased ? 60 : i, velocityBased ? i : 100);
+            const Rgb expected = ReferenceGradient(palette, x, interpolation);
+            const int deviation = std::max({std::abs(got.r - Channel(expected.r)), std::abs(got.g - Channel(expected.g)),
+                                            std::abs(got.b - Channel(expected.b))});
+            if (deviation > 1 && failures < 20)
+                printf("FAILED: %s %s entry %d: %d,%d,%d, reference %d,%d,%d\n", Name(interpolation),
+                       velocityBased ? "VelocityBased" : "NoteBased", i, got.r, got.g, got.b, Channel(expected.r),
+                       Channel(expected.g), Channel(expected.b));
+            failures += deviation > 1;
+            worst = std::max(worst, deviation);
+        }
+        return worst;
+    }
+}
+
+int main()
+{
+    const std::vector<std::vector<LedColor>> palettes = {
+        {LedColor::Blue, LedColor::Red},
+        {LedColor::Red, LedColor::Blue},
+        {LedColor(255, 0, 40), LedColor(255, 40, 0)},    // across hue 0
+        {LedColor(0, 255, 0), LedColor(255, 0, 255)},    // opposite hues
+        {LedColor::Black, LedColor::White},
+        {LedColor(128, 128, 128), LedColor(0, 200, 255)}, // gray to color
+        {LedColor::Yellow, LedColor(0, 0, 0)},
+        {LedColor::Blue, LedColor::Green, LedColor::Yellow, LedColor::Red, LedColor(255, 0, 255)},
+        {LedColor(255, 180, 107), LedColor(10, 20, 30), LedColor(200, 5, 90)},
+    };
+    const Interpolation interpolations[] = {Interpolation::Rgb, Interpolation::HsvShortHue, Interpolation::HsvLongHue,
+                                            Interpolation::OkLab};
+    const PianoLedConfig::LedStripColorLayout layouts[] = {PianoLedConfig::LedStripColorLayout::VelocityBased,
+                                                          PianoLedConfig::LedStripColorLayout::NoteBased};
+
+    for (Interpolation interpolation : interpolations)
+    {
+        int worst = 0;
+        for (const auto &palette : palettes)
+        {
+            for (auto layout : layouts)
+                worst = std::max(worst, Check(palette, interpolation, layout));
+        }
+        printf("%-12s %u palettes, largest deviation %d LSB\n", Name(interpolation), (unsigned)palettes.size(), worst);
+    }
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks FAILED");
+    return failures == 0 ? 0 : 1;
+}
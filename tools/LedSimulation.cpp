@@ -0,0 +1,160 @@
+// Plays a fixed piece through the key to LED mapping (src/KeyboardKeyToLed.cpp) into the host-only LED controller
+// (src/SimulatedLedController.cpp), writes what the strips would show as an image and a frame log, and reports the
+// frame rate and the bytes that went over the data lines. The output is the same on every run.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/LedSimulation.cpp src/SimulatedLedController.cpp src/KeyboardKeyToLed.cpp src/KeySpanTable.cpp src/NoteColorTable.cpp src/GradientColorMapping.cpp src/LedTopology.cpp src/PianoLedConfig.cpp src/FrameBufferLedController.cpp src/ColorCorrection.cpp src/PixelKernels.cpp src/PowerLimiter.cpp src/RgbwConverter.cpp src/MemoryMap.cpp -o led_sim
+//   ./led_sim [image.ppm [frames.log]]     defaults to led_sim.ppm and led_sim.log
+//   ./led_sim --terminal                   also draws every frame to the terminal
+//
+// The image has one row per frame (time runs downwards) and the strips side by side; the frame log is the binary
+// format described in src/SimulatedLedController.cpp. Like the LED output task, the note events of every 2 ms are
+// mapped and then committed as one frame. Checks that the LEDs of every played key are lit in the frame that follows
+// it, and that the strip is back to the note off color once every key is released.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "KeyboardKeyToLed.h"
+#include "SimulatedLedController.h"
+
+namespace
+{
+    constexpr uint32_t frameUs = 2000; // how often the LED output task commits
+
+    int failures = 0;
+
+    void Check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            printf("FAILED: %s\n", what);
+            ++failures;
+        }
+    }
+
+    struct Event
+    {
+        uint32_t us;
+        uint8_t note;
+        uint8_t velocity; // 0 releases the note
+    };
+
+    // a C major scale with rising velocity, three chords, a fast glissando and a held low octave
+    std::vector<Event> Piece()
+    {
+        std::vector<Event> events;
+        const uint8_t scale[] = {60, 62, 64, 65, 67, 69, 71, 72};
+        uint32_t us = 0;
+        for (int i = 0; i < 8; ++i, us += 150000)
+        {
+            events.push_back({us, scale[i], static_cast<uint8_t>(20 + i * 15)});
+            events.push_back({us + 120000, scale[i], 0});
+        }
+        const uint8_t chords[][3] = {{48, 52, 55}, {53, 57, 60}, {55, 59, 62}};
+        for (auto &chord : chords)
+        {
+            for (uint8_t note : chord)
+            {
+                events.push_back({us, note, 90});
+                events.push_back({us + 400000, note, 0});
+            }
+            us += 500000;
+        }
+        events.push_back({us, 24, 70});
+        events.push_back({us, 36, 70});
+        for (uint8_t note = 60; note <= 96; ++note, us += 3000)
+        {
+            events.push_back({us, note, 110});
+            events.push_back({us + 20000, note, 0});
+        }
+        events.push_back({us + 300000, 24, 0});
+        events.push_back({us + 300000, 36, 0});
+        return events;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool terminal = false;
+    const char *paths[2] = {"led_sim.ppm", "led_sim.log"};
+    int pathCount = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--terminal") == 0)
+            terminal = true;
+        else if (pathCount < 2)
+            paths[pathCount++] = argv[i];
+    }
+
+    uint64_t nowUs = 0;
+    SimulatedLedController controller([&] { return nowUs; });
+    KeyboardKeyToLed keyboardKeyToLed;
+    if (terminal)
+        controller.SetTerminalOutput(stdout);
+    controller.InitializeLeds();
+    const std::vector<uint8_t> unlit = controller.Frames().back().pixels;
+
+    std::vector<Event> events = Piece();
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.us < b.us; });
+
+    const uint8_t source = MidiSources::HostDevice(0);
+    const size_t ledsPerStrip = controller.LedsPerStrip();
+    uint32_t litRuns = 0;
+    uint32_t unlitKeys = 0;
+    size_t next = 0;
+    for (uint32_t frame = 0; next < events.size(); frame += frameUs)
+    {
+        std::vector<NeoPixelColor> lit;
+        bool staged = false;
+        for (; next < events.size() && events[next].us < frame + frameUs; ++next)
+        {
+            const Event &event = events[next];
+            if (event.velocity > 0)
+            {
+                const std::vector<NeoPixelColor> &changes = keyboardKeyToLed.HandleNoteOn(source, 1, event.note, event.velocity);
+                controller.StageIndividualLedColors(changes);
+                lit.insert(lit.end(), changes.begin(), changes.end());
+            }
+            else
+            {
+                controller.StageIndividualLedColors(keyboardKeyToLed.HandleNoteOff(source, event.note, 0));
+            }
+            staged = true;
+        }
+        if (!staged)
+            continue;
+        nowUs = frame + frameUs;
+        controller.Commit();
+
+        // no key of the piece is released in the frame it is played in
+        const std::vector<uint8_t> &pixels = controller.Frames().back().pixels;
+        for (const NeoPixelColor &run : lit)
+        {
+            const size_t offset = (run.stripNumber * ledsPerStrip + run.ledNumber) * 3;
+            bool changed = false;
+            for (size_t i = offset; i < offset + run.ledCount * 3 && i < pixels.size(); ++i)
+                changed = changed || pixels[i] != unlit[i];
+            unlitKeys += !changed;
+            ++litRuns;
+        }
+    }
+
+    Check(litRuns > 0, "no note on lit any LED");
+    Check(unlitKeys == 0, "a played key was not lit in the following frame");
+    Check(controller.Frames().back().pixels == unlit, "LEDs still lit after every key was released");
+    Check(controller.WireBytes() == controller.Frames().size() * ledsPerStrip * 3 * controller.StripCount(),
+          "WireBytes does not match the recorded frames");
+
+    const bool written = controller.WritePpm(paths[0]) && controller.WriteFrameLog(paths[1]);
+    Check(written, "could not write the image and the frame log");
+
+    printf("%zu events in %zu frames over %.2f s: %.1f FPS, %llu bytes on the data lines\n", events.size(),
+           controller.Frames().size(), (controller.Frames().back().timestampUs - controller.Frames().front().timestampUs) / 1e6,
+           controller.FramesPerSecond(), static_cast<unsigned long long>(controller.WireBytes()));
+    if (written)
+        printf("wrote %s and %s\n", paths[0], paths[1]);
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks FAILED");
+    return failures == 0 ? 0 : 1;
+}
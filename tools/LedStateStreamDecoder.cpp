@@ -0,0 +1,232 @@
+// Host stand-in for the ESP32 side of the live LED state stream (src/LedStateStream.h): decodes "LedState" lines and
+// checks them.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/LedStateStreamDecoder.cpp src/LedStateStream.cpp src/MemoryMap.cpp -o led_stream
+//   ./led_stream                 simulates playing through a 115200 baud UART and checks the decoded state
+//   ./led_stream capture.txt     decodes the LedState lines of a capture of the config UART and checks them
+//
+// The simulation checks that after every complete update the decoded keys and LEDs equal the firmware's, including
+// while a full-strip animation overloads the UART and the stream has to slow down.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "LedStateStream.h"
+
+PianoLedConfig PianoLedConfig::globalConfig;
+
+namespace
+{
+    class Decoder
+    {
+    public:
+        std::vector<uint8_t> frame;
+        uint8_t keys[16] = {};
+        size_t ledsPerStrip;
+        uint32_t lines = 0;
+        uint32_t updates = 0;
+        uint32_t keyframes = 0;
+        uint32_t errors = 0;
+
+        Decoder(size_t stripCount, size_t ledsPerStrip) : frame(stripCount * ledsPerStrip * 3), ledsPerStrip(ledsPerStrip) {}
+
+        /**
+         * Applies one line. Returns true if it ended an update.
+         */
+        bool Apply(const char *line)
+        {
+            std::vector<uint8_t> payload;
+            if (strncmp(line, "LedState ", 9) != 0 || !DecodeBase64(line + 9, payload) || payload.size() < 2)
+                return Error("malformed line");
+            ++lines;
+
+            uint8_t flags = payload[0];
+            if (haveSequence && payload[1] != static_cast<uint8_t>(sequence + 1))
+                Error("sequence gap");
+            sequence = payload[1];
+            haveSequence = true;
+
+            size_t position = 2;
+            if (flags & LedStateStream::flagKeys)
+            {
+                if (payload.size() < position + 16)
+                    return Error("truncated keys");
+                for (int i = 0; i < 16; ++i)
+                    keys[i] = (flags & LedStateStream::flagKeyframe) ? payload[position + i] : keys[i] ^ payload[position + i];
+                position += 16;
+            }
+            if (flags & LedStateStream::flagKeyframe)
+                ++keyframes;
+
+            while (position < payload.size())
+            {
+                uint32_t strip = payload[position++];
+                uint32_t first, count;
+                if (!ReadVarint(payload, position, first) || !ReadVarint(payload, position, count) || position + 3 > payload.size())
+                    return Error("truncated run");
+                if (first + count > ledsPerStrip || (strip + 1) * ledsPerStrip * 3 > frame.size() || count == 0)
+                    return Error("run out of range");
+                for (uint32_t led = 0; led < count; ++led)
+                    memcpy(&frame[((strip * ledsPerStrip) + first + led) * 3], &payload[position], 3);
+                position += 3;
+            }
+
+            if (flags & LedStateStream::flagEnd)
+                ++updates;
+            return flags & LedStateStream::flagEnd;
+        }
+
+    private:
+        uint8_t sequence = 0;
+        bool haveSequence = false;
+
+        bool Error(const char *what)
+        {
+            if (errors++ < 10)
+                printf("ERROR: %s\n", what);
+            return false;
+        }
+
+        static bool ReadVarint(const std::vector<uint8_t> &data, size_t &position, uint32_t &value)
+        {
+            value = 0;
+            for (int shift = 0; position < data.size() && shift < 32; shift += 7)
+            {
+                uint8_t byte = data[position++];
+                value |= (byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        static bool DecodeBase64(const char *text, std::vector<uint8_t> &out)
+        {
+            uint32_t group = 0;
+            int bits = 0;
+            for (; *text && *text != '\n' && *text != '\r' && *text != '='; ++text)
+            {
+                const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+                const char *found = strchr(alphabet, *text);
+                if (!found)
+                    return false;
+                group = group << 6 | (found - alphabet);
+                bits += 6;
+                if (bits >= 8)
+                {
+                    bits -= 8;
+                    out.push_back(group >> bits & 0xFF);
+                }
+            }
+            return true;
+        }
+    };
+
+    int DecodeCapture(const char *path)
+    {
+        FILE *file = fopen(path, "r");
+        if (!file)
+        {
+            printf("%s: cannot open\n", path);
+            return 1;
+        }
+        // the layout is not part of the stream; allow the largest one
+        Decoder decoder(PianoLedConfig::maxStrips, PianoLedConfig::maxLedsPerStrip);
+        char line[512];
+        while (fgets(line, sizeof(line), file))
+        {
+            const char *start = strstr(line, "LedState ");
+            if (start)
+                decoder.Apply(start);
+        }
+        fclose(file);
+        printf("%u lines, %u updates, %u keyframes, %u errors\n", decoder.lines, decoder.updates, decoder.keyframes, decoder.errors);
+        return decoder.errors ? 1 : 0;
+    }
+
+    int Simulate()
+    {
+        const size_t stripCount = 2;
+        const size_t ledsPerStrip = 148;
+        const size_t uartBufferBytes = 4096 + 64; // Serial1 with the memory added by ConfigManager
+        const double uartBytesPerMs = 115200 / 10 / 1000.0;
+
+        PianoLedConfig::globalConfig.ledStreamIntervalMs = 50;
+        std::vector<uint8_t> frame(stripCount * ledsPerStrip * 3, 0);
+        LedStateStream stream;
+        Decoder decoder(stripCount, ledsPerStrip);
+        uint8_t keys[16] = {};
+        stream.start();
+
+        double queuedBytes = 0;
+        uint32_t mismatches = 0;
+        uint32_t random = 12345;
+        auto next = [&](uint32_t range)
+        {
+            random = random * 1103515245 + 12345;
+            return (random >> 16) % range;
+        };
+
+        for (uint32_t ms = 0; ms < 60000; ++ms)
+        {
+            // 0-20 s playing, 20-40 s a full-strip animation that overloads the UART, 40-60 s playing again
+            bool animation = ms >= 20000 && ms < 40000;
+            if (animation)
+            {
+                for (size_t i = 0; i < frame.size(); ++i)
+                    frame[i] = static_cast<uint8_t>(i * 7 + ms);
+            }
+            else if (next(20) == 0)
+            {
+                uint8_t note = 21 + next(88);
+                bool on = next(2);
+                keys[note >> 3] = on ? keys[note >> 3] | 1 << (note & 7) : keys[note >> 3] & ~(1 << (note & 7));
+                if (on)
+                    stream.noteOn(note);
+                else
+                    stream.noteOff(note);
+                size_t led = (note - 21) * 3 % ledsPerStrip;
+                for (size_t strip = 0; strip < stripCount; ++strip)
+                {
+                    for (size_t i = led; i < led + 3 && i < ledsPerStrip; ++i)
+                    {
+                        uint8_t *pixel = &frame[(strip * ledsPerStrip + i) * 3];
+                        pixel[0] = on ? note * 2 : 1;
+                        pixel[1] = on ? 255 - note : 1;
+                        pixel[2] = on ? 40 : 1;
+                    }
+                }
+            }
+
+            queuedBytes = queuedBytes > uartBytesPerMs ? queuedBytes - uartBytesPerMs : 0;
+            size_t length;
+            while ((length = stream.nextLine(ms, uartBufferBytes - static_cast<size_t>(queuedBytes), frame.data(), stripCount, ledsPerStrip)) > 0)
+            {
+                queuedBytes += length;
+                if (decoder.Apply(stream.line()) && (decoder.frame != frame || memcmp(decoder.keys, keys, sizeof(keys)) != 0))
+                    ++mismatches;
+            }
+
+            if (ms % 10000 == 9999)
+            {
+                const LedStateStream::Stats &stats = stream.stats();
+                printf("%2u s: %s, interval %4lu ms, %5u updates, %4u cut short, %7u bytes, UART queue %4.0f bytes\n",
+                       (ms + 1) / 1000, animation ? "animation" : "playing  ", (unsigned long)stream.intervalMs(), stats.updates,
+                       stats.cutShort, stats.bytes, queuedBytes);
+            }
+        }
+
+        printf("decoded %u lines, %u updates, %u keyframes; %u errors, %u mismatches\n", decoder.lines, decoder.updates,
+               decoder.keyframes, decoder.errors, mismatches);
+        bool ok = decoder.errors == 0 && mismatches == 0 && decoder.updates == stream.stats().updates;
+        printf(ok ? "all checks passed\n" : "checks FAILED\n");
+        return ok ? 0 : 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    return argc > 1 ? DecodeCapture(argv[1]) : Simulate();
+}
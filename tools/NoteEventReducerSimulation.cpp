@@ -0,0 +1,182 @@
+// Feeds the note event reducer (src/NoteEventReducer.cpp) with simulated playing - normal notes, staccato runs, event
+// storms from several sources - and checks it against applying every event directly. The output is the same on
+// every run.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/NoteEventReducerSimulation.cpp src/NoteEventReducer.cpp src/MemoryMap.cpp -o reducer_sim
+//   ./reducer_sim
+//
+// Checks that the keys end up lit exactly as without the reducer, that no key is released before it was lit for
+// minOnMs (unless a forced flush dropped it to make room), that no release is applied to a key that is not held, and that
+// the reducer passes on fewer events than it receives, then prints its counters.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "NoteEventReducer.h"
+
+namespace
+{
+    constexpr uint32_t minOnMs = 30;
+    constexpr uint32_t frameUs = 2000; // how often the LED output task flushes
+
+    uint32_t seed = 12345;
+
+    uint32_t Random(uint32_t range)
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    }
+
+    int failures = 0;
+
+    void Check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            printf("FAILED: %s\n", what);
+            ++failures;
+        }
+    }
+
+    struct Key
+    {
+        int direct = 0;  // holds when applying every event as it arrives
+        int reduced = 0; // holds applied by the reducer
+        uint32_t litSinceMs = 0;
+        uint32_t litBeforeFlush = 0; // forced flushes before the key was lit
+    };
+
+    struct Event
+    {
+        uint32_t us;
+        uint8_t source;
+        uint8_t note;
+        bool on;
+    };
+}
+
+int main()
+{
+    NoteEventReducer reducer;
+    std::vector<Key> keys(MidiSources::count * 128);
+    auto key = [&](uint8_t source, uint8_t note) -> Key & { return keys[source * 128 + note]; };
+
+    // one minute of playing: a pianist on the first keyboard, a fast staccato run on the second keyboard, and every
+    // ten seconds a storm of 400 events from a MIDI dump on the device port
+    std::vector<Event> events;
+    for (uint32_t us = 0; us < 60000000; us += 20000 + Random(200000))
+    {
+        uint8_t note = 21 + Random(88);
+        uint32_t length = 50000 + Random(1000000);
+        events.push_back({us, MidiSources::HostDevice(0), note, true});
+        events.push_back({us + length, MidiSources::HostDevice(0), note, false});
+    }
+    for (uint32_t us = 0; us < 60000000; us += 3000 + Random(4000))
+    {
+        uint8_t note = 48 + Random(24);
+        events.push_back({us, MidiSources::HostDevice(1), note, true});
+        events.push_back({us + 200 + Random(1500), MidiSources::HostDevice(1), note, false});
+    }
+    for (uint32_t storm = 5000000; storm < 60000000; storm += 10000000)
+    {
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            uint8_t source = MidiSources::DeviceCable(Random(3));
+            uint8_t note = Random(128);
+            uint32_t us = storm + i * 20;
+            events.push_back({us, source, note, true});
+            events.push_back({us + Random(8000), source, note, false});
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.us < b.us; });
+
+    uint32_t eventCount = 0;
+    uint32_t earlyReleases = 0;
+    uint32_t overloadedFrames = 0;
+    bool forced = false;
+    uint32_t forcedFlushes = 0;
+    uint32_t nowMs = 0;
+
+    auto on = [&](const NoteEventReducer::Change &change)
+    {
+        Key &k = key(change.source, change.note);
+        if (k.reduced++ == 0)
+        {
+            k.litSinceMs = nowMs;
+            k.litBeforeFlush = forcedFlushes;
+        }
+    };
+    auto off = [&](const NoteEventReducer::Change &change)
+    {
+        Key &k = key(change.source, change.note);
+        Check(k.reduced > 0, "release applied to a key that is not held");
+        // a forced flush forgets when the keys it applied were lit
+        if (!forced && k.litBeforeFlush == forcedFlushes && nowMs - k.litSinceMs < minOnMs)
+            ++earlyReleases;
+        --k.reduced;
+    };
+    auto flush = [&](uint32_t us, bool force)
+    {
+        nowMs = us / 1000;
+        forced = force;
+        reducer.Flush(nowMs, minOnMs, force, on, off);
+        forcedFlushes += force;
+    };
+
+    size_t next = 0;
+    for (uint32_t frame = 0; next < events.size(); frame += frameUs)
+    {
+        for (; next < events.size() && events[next].us < frame + frameUs; ++next)
+        {
+            const Event &event = events[next];
+            Key &k = key(event.source, event.note);
+            ++eventCount;
+            if (event.on)
+            {
+                ++k.direct;
+                if (!reducer.NoteOn(event.source, 0, event.note, 100))
+                {
+                    flush(event.us, true);
+                    Check(reducer.NoteOn(event.source, 0, event.note, 100), "note on refused after a forced flush");
+                }
+            }
+            else
+            {
+                if (k.direct > 0)
+                    --k.direct;
+                if (!reducer.NoteOff(event.source, event.note))
+                {
+                    flush(event.us, true);
+                    Check(reducer.NoteOff(event.source, event.note), "note off refused after a forced flush");
+                }
+            }
+        }
+        if (reducer.Overloaded())
+            ++overloadedFrames;
+        flush(frame + frameUs, false);
+    }
+
+    // let the held back releases run out
+    for (uint32_t i = 0; i < minOnMs * 1000 / frameUs + 2; ++i)
+        flush((events.back().us / frameUs + 2 + i) * frameUs, false);
+
+    Check(!reducer.Pending(), "keys still pending after the minimum on-time");
+    size_t mismatches = 0;
+    for (const Key &k : keys)
+        mismatches += k.direct != k.reduced;
+    Check(mismatches == 0, "keys lit differently than without the reducer");
+    Check(earlyReleases == 0, "key released before minOnMs");
+
+    const NoteEventReducer::Stats &stats = reducer.GetStats();
+    Check(stats.events == eventCount, "not every event counted");
+    Check(stats.applied < stats.events, "nothing coalesced");
+    Check(stats.overflows > 0, "the storms never filled the reducer");
+
+    printf("%u events, %u applied (%u collapsed) in %u frames\n", stats.events, stats.applied, stats.Collapsed(),
+           stats.frames);
+    printf("%u notes stretched to %u ms, %u forced flushes, %u overloaded frames\n", stats.stretched, minOnMs,
+           stats.overflows, overloadedFrames);
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+// Host benchmark of the streaming SMF parser used for playback (src/SmfReader.cpp).
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/SmfReaderBenchmark.cpp src/SmfReader.cpp src/AllocationTracker.cpp -o smf_bench
+//   ./smf_bench [file.mid ...]
+//
+// Without arguments it generates large multi-track files. For every file it reports the events per second parsed
+// from memory and from disk, the reader's memory footprint and the heap it allocated (expected: none).
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "AllocationTracker.h"
+#include "SmfReader.h"
+
+namespace
+{
+    class MemorySource : public SmfSource
+    {
+    public:
+        explicit MemorySource(const std::vector<uint8_t> &data) : data(data) {}
+
+        size_t Read(uint32_t offset, uint8_t *buffer, size_t count) override
+        {
+            if (offset >= data.size())
+                return 0;
+            count = std::min(count, data.size() - offset);
+            memcpy(buffer, data.data() + offset, count);
+            return count;
+        }
+
+    private:
+        const std::vector<uint8_t> &data;
+    };
+
+    class FileSource : public SmfSource
+    {
+    public:
+        explicit FileSource(FILE *file) : file(file) {}
+
+        size_t Read(uint32_t offset, uint8_t *buffer, size_t count) override
+        {
+            if (fseek(file, offset, SEEK_SET) != 0)
+                return 0;
+            return fread(buffer, 1, count, file);
+        }
+
+    private:
+        FILE *file;
+    };
+
+    void WriteU32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(value >> shift);
+    }
+
+    void WriteVariableLength(std::vector<uint8_t> &out, uint32_t value)
+    {
+        uint8_t bytes[4];
+        int count = 0;
+        do
+        {
+            bytes[count++] = value & 0x7F;
+            value >>= 7;
+        } while (value);
+        while (count-- > 0)
+            out.push_back(bytes[count] | (count > 0 ? 0x80 : 0));
+    }
+
+    // Format 1 file: a conductor track with tempo changes and a sysex, and note tracks using running status
+    std::vector<uint8_t> GenerateFile(int noteTracks, int notesPerTrack)
+    {
+        std::vector<uint8_t> file = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1};
+        file.push_back((noteTracks + 1) >> 8);
+        file.push_back((noteTracks + 1) & 0xFF);
+        file.push_back(480 >> 8);
+        file.push_back(480 & 0xFF);
+
+        for (int t = 0; t <= noteTracks; ++t)
+        {
+            std::vector<uint8_t> track;
+            if (t == 0)
+            {
+                const uint8_t sysex[] = {0, 0xF0, 5, 0x7E, 0x7F, 0x09, 0x01, 0xF7};
+                track.insert(track.end(), sysex, sysex + sizeof(sysex));
+                for (int i = 0; i < notesPerTrack / 64; ++i)
+                {
+                    uint32_t tempo = 400000 + (i % 8) * 25000;
+                    const uint8_t event[] = {0xFF, 0x51, 3, uint8_t(tempo >> 16), uint8_t(tempo >> 8), uint8_t(tempo)};
+                    WriteVariableLength(track, 480 * 16);
+                    track.insert(track.end(), event, event + sizeof(event));
+                }
+            }
+            else
+            {
+                uint8_t channel = (t - 1) % 16;
+                track.push_back(0);
+                track.push_back(0xC0 | channel);
+                track.push_back(t % 128);
+                for (int i = 0; i < notesPerTrack; ++i)
+                {
+                    uint8_t note = 21 + (i * 7 + t * 5) % 88;
+                    // note on and note off (as note on with velocity 0), both with running status after the first
+                    WriteVariableLength(track, 60 + (i * 13 + t) % 180);
+                    if (i == 0)
+                        track.push_back(0x90 | channel);
+                    track.push_back(note);
+                    track.push_back(1 + (i * 31) % 127);
+                    WriteVariableLength(track, 30 + (i * 7) % 90);
+                    track.push_back(note);
+                    track.push_back(0);
+                }
+            }
+            const uint8_t endOfTrack[] = {0, 0xFF, 0x2F, 0};
+            track.insert(track.end(), endOfTrack, endOfTrack + sizeof(endOfTrack));
+
+            file.insert(file.end(), {'M', 'T', 'r', 'k'});
+            WriteU32(file, track.size());
+            file.insert(file.end(), track.begin(), track.end());
+        }
+        return file;
+    }
+
+    struct Result
+    {
+        bool ok;
+        size_t tracks;
+        uint64_t events;
+        uint64_t lastTimeUs;
+        bool ordered;
+        double seconds;
+    };
+
+    Result Parse(SmfSource &source)
+    {
+        Result result{};
+        SmfReader reader;
+        auto start = std::chrono::steady_clock::now();
+        result.ok = reader.Open(source);
+        result.tracks = reader.TrackCount();
+        result.ordered = true;
+        SmfReader::Event event;
+        while (result.ok && reader.Next(event))
+        {
+            result.ordered = result.ordered && event.timeUs >= result.lastTimeUs;
+            result.lastTimeUs = event.timeUs;
+            ++result.events;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    void Report(const char *name, const char *medium, const Result &result, uint32_t allocations)
+    {
+        if (!result.ok)
+        {
+            printf("%-28s %-7s not a Standard MIDI File\n", name, medium);
+            return;
+        }
+        printf("%-28s %-7s %2zu tracks %9llu events %7.1f s song %6.2f M events/s %s%s\n", name, medium, result.tracks,
+               (unsigned long long)result.events, result.lastTimeUs / 1e6, result.events / result.seconds / 1e6,
+               result.ordered ? "" : " OUT OF ORDER", allocations ? " ALLOCATED" : "");
+    }
+
+    void Benchmark(const char *name, const std::vector<uint8_t> &data)
+    {
+        AllocationTracker::Scope memoryScope;
+        MemorySource memory(data);
+        Result fromMemory = Parse(memory);
+        uint32_t memoryAllocations = memoryScope.Allocations();
+        Report(name, "memory", fromMemory, memoryAllocations);
+
+        std::string path = std::string("/tmp/smf_bench_") + std::to_string(data.size()) + ".mid";
+        FILE *file = fopen(path.c_str(), "w+b");
+        if (!file)
+            return;
+        fwrite(data.data(), 1, data.size(), file);
+        AllocationTracker::Scope fileScope;
+        FileSource disk(file);
+        Report(name, "file", Parse(disk), fileScope.Allocations());
+        fclose(file);
+        remove(path.c_str());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    printf("SmfReader: %zu bytes (%zu tracks, %zu byte buffers), no heap\n", sizeof(SmfReader), SmfReader::maxTracks,
+           SmfReader::trackBufferSize);
+
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            FILE *file = fopen(argv[i], "rb");
+            if (!file)
+            {
+                printf("%s: cannot open\n", argv[i]);
+                continue;
+            }
+            std::vector<uint8_t> data;
+            uint8_t chunk[4096];
+            size_t count;
+            while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+                data.insert(data.end(), chunk, chunk + count);
+            fclose(file);
+            Benchmark(argv[i], data);
+        }
+        return 0;
+    }
+
+    const int sizes[][2] = {{4, 10000}, {16, 50000}, {31, 100000}};
+    for (auto &size : sizes)
+    {
+        std::vector<uint8_t> data = GenerateFile(size[0], size[1]);
+        char name[64];
+        snprintf(name, sizeof(name), "%d tracks x %d notes", size[0], size[1]);
+        Benchmark(name, data);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Runs the main loop scheduler (src/TaskScheduler.cpp) on the host against a simulated clock, with tasks that take
+// fixed amounts of time, and checks its guarantees. The output is the same on every run.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -Isrc tools/TaskSchedulerSimulation.cpp src/TaskScheduler.cpp -o scheduler_sim
+//   ./scheduler_sim
+//
+// Checks that the MIDI task never waits for more than the longest other task run, that periodic tasks keep their
+// period, and that the CPU shares add up, then prints the per task statistics.
+
+#include <cstdio>
+#include "TaskScheduler.h"
+
+namespace
+{
+    uint32_t simulatedUs = 0xFFFF0000; // wraps early in the simulation
+
+    uint32_t SimulatedClock() { return simulatedUs; }
+
+    int failures = 0;
+
+    void Check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            printf("FAILED: %s\n", what);
+            ++failures;
+        }
+    }
+}
+
+int main()
+{
+    using Priority = TaskScheduler::Priority;
+    TaskScheduler scheduler(SimulatedClock);
+
+    uint32_t lastMidiUs = simulatedUs;
+    uint32_t longestMidiGapUs = 0;
+    uint32_t flashRuns = 0;
+    uint32_t ditherRuns = 0;
+    uint32_t consoleRuns = 0;
+
+    // MIDI: 5 us to poll, 40 us when an event arrives (every 7th poll)
+    uint32_t midiPolls = 0;
+    scheduler.addTask("MIDI", Priority::Critical, 0, 200, [&]
+                      {
+                          uint32_t gap = simulatedUs - lastMidiUs;
+                          longestMidiGapUs = gap > longestMidiGapUs ? gap : longestMidiGapUs;
+                          simulatedUs += ++midiPolls % 7 == 0 ? 40 : 5;
+                          lastMidiUs = simulatedUs;
+                      });
+    scheduler.addTask("LED output", Priority::High, 0, 500, [&]
+                      { simulatedUs += 3; });
+    scheduler.addTask("dithering", Priority::Normal, 10000, 2000, [&]
+                      {
+                          ++ditherRuns;
+                          simulatedUs += 600;
+                      });
+    // the recorder writes a flash slice every 50th run; one of them stalls for 30 ms
+    scheduler.addTask("recorder", Priority::Background, 0, 2000, [&]
+                      {
+                          ++flashRuns;
+                          simulatedUs += flashRuns == 500 ? 30000 : flashRuns % 50 == 0 ? 1500 : 2;
+                      });
+    scheduler.addTask("console", Priority::Background, 10000, 1000, [&]
+                      {
+                          ++consoleRuns;
+                          simulatedUs += 20;
+                      });
+
+    uint32_t stalls = 0;
+    scheduler.onTaskRun = [&](const TaskScheduler::Task &, uint32_t durationUs)
+    {
+        stalls += durationUs > 20000;
+    };
+
+    const uint32_t simulatedSeconds = 10;
+    uint32_t startUs = simulatedUs;
+    while (simulatedUs - startUs < simulatedSeconds * 1000000)
+    {
+        simulatedUs += 1; // loop overhead
+        scheduler.runOnce();
+    }
+
+    // a background run of at most 30 ms plus one MIDI run with an event can delay the next MIDI poll
+    Check(longestMidiGapUs <= 30000 + 40, "MIDI waits for at most one other task run");
+    Check(ditherRuns >= simulatedSeconds * 100 - 4 && ditherRuns <= simulatedSeconds * 100 + 1, "dithering runs every 10 ms");
+    Check(consoleRuns >= simulatedSeconds * 100 - 4 && consoleRuns <= simulatedSeconds * 100 + 1, "console runs every 10 ms");
+    Check(stalls == 1, "the 30 ms recorder run is the only stall");
+
+    float totalShare = 0;
+    printf("%-12s %7s %8s %8s %8s %8s\n", "task", "CPU", "runs", "max us", "budget", "overruns");
+    for (const TaskScheduler::Task &task : scheduler.tasks())
+    {
+        float share = scheduler.cpuShare(task);
+        totalShare += share;
+        printf("%-12s %6.2f%% %8lu %8lu %8lu %8lu\n", task.name, share, (unsigned long)task.stats.runs,
+               (unsigned long)task.stats.maxUs, (unsigned long)task.budgetUs, (unsigned long)task.stats.overruns);
+    }
+    printf("longest wait for MIDI: %lu us\n", (unsigned long)longestMidiGapUs);
+    Check(totalShare > 95 && totalShare <= 100.5f, "CPU shares add up");
+
+    printf(failures ? "%d checks FAILED\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
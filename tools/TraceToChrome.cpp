@@ -0,0 +1,132 @@
+// Converts an event trace dumped by the `trace` console command (src/EventTrace.h) into Chrome trace_event JSON,
+// which chrome://tracing and ui.perfetto.dev display as a timeline.
+//
+// Build from the repository root, capture the dump and convert it:
+//   g++ -std=c++17 -O2 -Isrc tools/TraceToChrome.cpp src/EventTrace.cpp -o trace_to_chrome
+//   ./trace_to_chrome capture.txt > trace.json
+//
+// The capture can be any serial log containing the dump; other lines are ignored. If it contains several dumps, the
+// last one is converted. Without a file argument the capture is read from stdin.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "EventTrace.h"
+
+namespace
+{
+    struct Dump
+    {
+        unsigned long cyclesPerSecond = 0;
+        std::vector<EventTrace::Record> records;
+    };
+
+    bool ReadDump(FILE *in, Dump &dump)
+    {
+        bool found = false;
+        bool inDump = false;
+        char line[256];
+        while (fgets(line, sizeof(line), in))
+        {
+            unsigned long cyclesPerSecond, count;
+            if (sscanf(line, "trace begin %lu %lu", &cyclesPerSecond, &count) == 2)
+            {
+                dump.cyclesPerSecond = cyclesPerSecond;
+                dump.records.clear();
+                dump.records.reserve(count);
+                inDump = true;
+                found = true;
+                continue;
+            }
+            if (!inDump)
+                continue;
+            if (strncmp(line, "trace end", 9) == 0)
+            {
+                inDump = false;
+                continue;
+            }
+
+            unsigned long cycles;
+            unsigned id, phase, arg;
+            if (strlen(line) >= 16 && sscanf(line, "%8lx%2x%2x%4x", &cycles, &id, &phase, &arg) == 4)
+            {
+                dump.records.push_back({static_cast<uint32_t>(cycles), static_cast<EventTrace::Id>(id),
+                                        static_cast<EventTrace::Phase>(phase), static_cast<uint16_t>(arg)});
+            }
+        }
+        return found && dump.cyclesPerSecond > 0;
+    }
+
+    void WriteArgs(FILE *out, const EventTrace::Record &record)
+    {
+        if (record.id == EventTrace::Id::MidiIn)
+            fprintf(out, "\"args\":{\"status\":\"0x%02X\",\"data1\":%u}", record.arg >> 8, record.arg & 0xFF);
+        else
+            fprintf(out, "\"args\":{\"arg\":%u}", record.arg);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = argc > 1 ? fopen(argv[1], "r") : stdin;
+    if (!in)
+    {
+        fprintf(stderr, "%s: cannot open\n", argv[1]);
+        return 1;
+    }
+    Dump dump;
+    bool ok = ReadDump(in, dump);
+    if (in != stdin)
+        fclose(in);
+    if (!ok)
+    {
+        fprintf(stderr, "no trace dump found\n");
+        return 1;
+    }
+
+    // Begin records whose End is still open, per id; Ends of Begins that were overwritten in the ring are dropped
+    int open[static_cast<size_t>(EventTrace::Id::Count)] = {};
+    uint64_t cycles = 0;
+    uint32_t lastCycles = dump.records.empty() ? 0 : dump.records.front().cycles;
+    bool first = true;
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (const EventTrace::Record &record : dump.records)
+    {
+        // the 32-bit counter wraps; consecutive records are less than a wrap apart (see EventTrace::Poll)
+        cycles += record.cycles - lastCycles;
+        lastCycles = record.cycles;
+        size_t id = static_cast<size_t>(record.id);
+        if (record.id == EventTrace::Id::Clock || id >= static_cast<size_t>(EventTrace::Id::Count))
+            continue;
+
+        const char *phase;
+        switch (record.phase)
+        {
+        case EventTrace::Phase::Begin:
+            ++open[id];
+            phase = "\"ph\":\"B\"";
+            break;
+        case EventTrace::Phase::End:
+            if (open[id] == 0)
+                continue;
+            --open[id];
+            phase = "\"ph\":\"E\"";
+            break;
+        default:
+            phase = "\"ph\":\"i\",\"s\":\"t\"";
+            break;
+        }
+
+        printf("%s{\"name\":\"%s\",%s,\"ts\":%.3f,\"pid\":1,\"tid\":1,", first ? "" : ",\n",
+               EventTrace::IdName(record.id), phase, cycles * 1e6 / dump.cyclesPerSecond);
+        WriteArgs(stdout, record);
+        printf("}");
+        first = false;
+    }
+    printf("\n]}\n");
+
+    fprintf(stderr, "%zu records, %.3f s\n", dump.records.size(), cycles / static_cast<double>(dump.cyclesPerSecond));
+    return 0;
+}